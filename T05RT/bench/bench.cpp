@@ -0,0 +1,1109 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : bench.cpp
+ * PURPOSE     : Raytracing project.
+ *               Headless render benchmark module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : Usage:
+ *                 T05RTBENCH [-w W] [-h H] [-t Threads] [-r Reps] [-u WarmUps]
+ *                            [-m Model.g3dm] [-b Baseline.json] [-o Out.json]
+ *                            [-x ThresholdPercent] [-s Scene] [-l Scene.gsnp]
+ *                            [-f 1 (typed shape arrays)] [-k 1 (kernel microbenchmarks)]
+ *                            [-d 1 (denoise frames)] [-p 1 (pin threads)]
+ *                            [-n 1 (NUMA aware pool)] [-c 1 (thread scaling 1, 2, 4, ...)]
+ *                            [-z CloudSpheres] [-q 1 (quantized mesh normals)]
+ *                            [-v 1 (rasterized primary visibility)]
+ *                            [-y QueryRays (batched query API throughput)]
+ *                            [-g RefSamples (path tracing convergence, CSV per scene)]
+ *                            [-e Photons (caustics photon map)]
+ *                            [-i 1 (irradiance cache), 2 (kept between renders)]
+ *                            [-a Frames (animated sphere clouds BVH refit)]
+ *                            [-j BudgetMB (memory report, scenes over budget
+ *                                          are skipped; 0 for no budget)]
+ *               Exit code is 1 if any scene is slower than baseline
+ *               by more than threshold.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#include "gort.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <functional>
+#include <bit>
+#include <random>
+#include <memory>
+#include <psapi.h>
+
+#include "ray/rt_scene.h"
+#include "ray/scenes.h"
+#include "ray/snapshot.h"
+#include "ray/query.h"
+
+#pragma comment(lib, "psapi")
+
+using namespace gort;
+
+/* Benchmark settings */
+struct bench_cfg
+{
+  INT W = 640, H = 360;                                  // Frame size
+  INT Threads = max((INT)std::thread::hardware_concurrency(), 1); // Render threads
+  INT Reps = 5, WarmUps = 1;                             // Measured and warm-up renders
+  DBL Threshold = 5;                                     // Regression threshold in percents
+  std::string Model = "bin/models/cow.g3dm";             // Dense mesh scene model
+  std::string Baseline = "bench/baseline.json";          // Baseline results
+  std::string Out = "bench/result.json";                 // Results
+  std::string Only;                                      // Single scene name to run
+  std::string Snapshot;                                  // Snapshot scene file
+  BOOL IsFlat = FALSE;                                   // Use typed shape arrays
+  BOOL IsKernels = FALSE;                                // Run kernel microbenchmarks
+  BOOL IsDenoise = FALSE;                                // Denoise each frame (included in time)
+  BOOL IsPinned = FALSE;                                 // Pin render threads to processors
+  BOOL IsNuma = FALSE;                                   // NUMA aware render pool
+  BOOL IsScaling = FALSE;                                // Run each scene with 1, 2, 4, ... threads
+  INT CloudCount = 1000000;                              // Sphere cloud scene spheres count
+  BOOL IsQuantized = FALSE;                              // Quantize mesh normals
+  BOOL IsRaster = FALSE;                                 // Rasterize primary visibility
+  INT QueryCount = 0;                                    // Batched query rays count (0 to skip)
+  INT PathRefSamples = 0;                                // Path tracing reference samples (0 to skip)
+  INT CausticPhotons = 0;                                // Caustics emitted photons count (0 for no caustics)
+  INT IrrCache = 0;                                      // Irradiance cache mode (0 - off, 1 - per frame, 2 - kept)
+  INT AnimFrames = 0;                                    // Animated frames count (0 to skip)
+  DBL MemoryBudget = -1;                                 // Scene memory budget in megabytes (0 for no budget, -1 for no report)
+}; /* End of 'bench_cfg' structure */
+
+/* Benchmark scene result */
+struct bench_result
+{
+  std::string Name;   // Scene name
+  DBL Time;           // Median wall time in seconds
+  DBL MinTime;        // Best wall time in seconds
+  DBL RaysPerSec;     // Traced rays per second (median of repetitions)
+  DBL PeakRSS;        // Scene peak working set growth in megabytes (see 'rss_meter')
+}; /* End of 'bench_result' structure */
+
+/* Benchmark scene description */
+struct bench_scene
+{
+  const CHAR *Name;                                   // Scene name
+  BOOL (*Build)( rt::scene &Scene, camera &Cam, const bench_cfg &Cfg ); // Scene builder
+}; /* End of 'bench_scene' structure */
+
+/* Sphere field scene build function.
+ * ARGUMENTS:
+ *   - scene to fill:
+ *       rt::scene &Scene;
+ *   - camera to setup:
+ *       camera &Cam;
+ *   - benchmark settings:
+ *       const bench_cfg &Cfg;
+ * RETURNS:
+ *   (BOOL) TRUE if scene is built, FALSE otherwise.
+ */
+static BOOL BuildSpheres( rt::scene &Scene, camera &Cam, const bench_cfg &Cfg )
+{
+  surface mtl;
+
+  Scene.AmbientColor = vec3(0.1);
+  Scene << new plane(vec3(0), vec3(0, 1, 0), Scene.Mtls.Add(mtl));
+  for (INT z = 0; z < 24; z++)
+    for (INT x = 0; x < 24; x++)
+    {
+      scn::SetMtl(mtl, x + z);
+      Scene << new sphere(vec3(x - 11.5, 0.4, z - 11.5) * 2, 0.8, Scene.Mtls.Add(mtl));
+    }
+  Scene << new lght::point(vec3(0, 20, 0), 100, vec3(1, 1, 1));
+  Scene << new lght::direction(vec3(-1, -3, -2), vec3(0.5, 0.5, 0.5));
+  Cam.SetLocAtUp(vec3(0, 18, 30), vec3(0, 0, 0), vec3(0, 1, 0));
+  return TRUE;
+} /* End of 'BuildSpheres' function */
+
+/* Default box/plane scene build function.
+ * ARGUMENTS:
+ *   - scene to fill:
+ *       rt::scene &Scene;
+ *   - camera to setup:
+ *       camera &Cam;
+ *   - benchmark settings:
+ *       const bench_cfg &Cfg;
+ * RETURNS:
+ *   (BOOL) TRUE if scene is built, FALSE otherwise.
+ */
+static BOOL BuildDefault( rt::scene &Scene, camera &Cam, const bench_cfg &Cfg )
+{
+  scn::Default(Scene, Cam);
+  Cam.SetLocAtUp(vec3(0, 17, -20), vec3(0, 0, 0), vec3(0, 1, 0));
+  return TRUE;
+} /* End of 'BuildDefault' function */
+
+/* Dense g3dm mesh scene build function.
+ * ARGUMENTS:
+ *   - scene to fill:
+ *       rt::scene &Scene;
+ *   - camera to setup:
+ *       camera &Cam;
+ *   - benchmark settings:
+ *       const bench_cfg &Cfg;
+ * RETURNS:
+ *   (BOOL) TRUE if scene is built, FALSE otherwise.
+ */
+static BOOL BuildMesh( rt::scene &Scene, camera &Cam, const bench_cfg &Cfg )
+{
+  surface mtl;
+
+  scn::SetMtl(mtl, 5);
+  g3dm *Mesh = new g3dm(Cfg.Model.c_str(), Scene.Mtls.Add(mtl), Cfg.IsQuantized);
+  if (Mesh->Prims.size() == 0)
+  {
+    delete Mesh;
+    return FALSE;
+  }
+  std::cout << "mesh: " << Mesh->TriangleCount() << " triangles, " << std::setprecision(1) << std::fixed <<
+    (DBL)Mesh->Memory() / Mesh->TriangleCount() << " bytes per triangle (expanded 'triangle' shapes: " <<
+    sizeof(triangle) << ")" << std::endl;
+  Scene.AmbientColor = vec3(0.1);
+  Scene << Mesh;
+  Scene << new plane(vec3(0), vec3(0, 1, 0));
+  Scene << new lght::point(vec3(5, 10, 5), 60, vec3(1, 1, 1));
+  Cam.SetLocAtUp(vec3(4, 3, 6), vec3(0, 1, 0), vec3(0, 1, 0));
+  return TRUE;
+} /* End of 'BuildMesh' function */
+
+/* Scene snapshot file build function.
+ * ARGUMENTS:
+ *   - scene to fill:
+ *       rt::scene &Scene;
+ *   - camera to setup:
+ *       camera &Cam;
+ *   - benchmark settings:
+ *       const bench_cfg &Cfg;
+ * RETURNS:
+ *   (BOOL) TRUE if scene is built, FALSE otherwise.
+ */
+static BOOL BuildSnapshot( rt::scene &Scene, camera &Cam, const bench_cfg &Cfg )
+{
+  if (Cfg.Snapshot.empty())
+    return FALSE;
+
+  auto t0 = std::chrono::steady_clock::now();
+  if (!snapshot::Load(Scene, Cam, Cfg.Snapshot, Cfg.IsFlat))
+    return FALSE;
+  auto t1 = std::chrono::steady_clock::now();
+  std::cout << "snapshot: " << Scene.Shapes.size() << " shapes loaded in " <<
+    std::chrono::duration<DBL, std::milli>(t1 - t0).count() << " ms" << std::endl;
+  return TRUE;
+} /* End of 'BuildSnapshot' function */
+
+/* Nested CSG scene build function.
+ * ARGUMENTS:
+ *   - scene to fill:
+ *       rt::scene &Scene;
+ *   - camera to setup:
+ *       camera &Cam;
+ *   - benchmark settings:
+ *       const bench_cfg &Cfg;
+ * RETURNS:
+ *   (BOOL) TRUE if scene is built, FALSE otherwise.
+ */
+static BOOL BuildCSG( rt::scene &Scene, camera &Cam, const bench_cfg &Cfg )
+{
+  surface mtl;
+
+  Scene.AmbientColor = vec3(0.1);
+  Scene << new plane(vec3(0), vec3(0, 1, 0), Scene.Mtls.Add(mtl));
+  for (INT i = 0; i < 9; i++)
+  {
+    vec3 C = vec3(i % 3 - 1, 0, i / 3 - 1) * 5 + vec3(0, 2, 0);
+
+    scn::SetMtl(mtl, i);
+    DWORD m = Scene.Mtls.Add(mtl);
+    // (box & sphere) - (sphere | sphere)
+    shape *Rounded = new csg(new box(C - vec3(1.5), C + vec3(1.5), m), new sphere(C, 2, m), 1);
+    shape *Holes = new csg(new sphere(C + vec3(0, 1.5, 0), 1, m), new sphere(C + vec3(1.5, 0, 0), 1, m), 0);
+    Scene << new csg(Rounded, Holes, 2);
+  }
+  Scene << new lght::point(vec3(0, 15, 10), 80, vec3(1, 1, 1));
+  Cam.SetLocAtUp(vec3(0, 12, 16), vec3(0, 1, 0), vec3(0, 1, 0));
+  return TRUE;
+} /* End of 'BuildCSG' function */
+
+/* Heavy reflection and refraction scene build function.
+ * ARGUMENTS:
+ *   - scene to fill:
+ *       rt::scene &Scene;
+ *   - camera to setup:
+ *       camera &Cam;
+ *   - benchmark settings:
+ *       const bench_cfg &Cfg;
+ * RETURNS:
+ *   (BOOL) TRUE if scene is built, FALSE otherwise.
+ */
+static BOOL BuildGlass( rt::scene &Scene, camera &Cam, const bench_cfg &Cfg )
+{
+  surface mtl;
+
+  Scene.AmbientColor = vec3(0.1);
+  Scene.RecMaxLevel = 8;
+  mtl.Kr = coef(0.3);
+  Scene << new plane(vec3(0), vec3(0, 1, 0), Scene.Mtls.Add(mtl));
+  for (INT i = 0; i < 25; i++)
+  {
+    scn::SetMtl(mtl, i);
+    mtl.Kr = coef(0.5);
+    mtl.Kt = coef(i % 2 == 0 ? 0.9 : 0.0);
+    Scene << new sphere(vec3(i % 5 - 2, 0.5, i / 5 - 2) * 3 + vec3(0, 1, 0), 1.3, Scene.Mtls.Add(mtl, envi {1.5, 0.05}));
+  }
+  Scene << new lght::point(vec3(0, 12, 0), 80, vec3(1, 1, 1));
+  Scene << new lght::direction(vec3(1, -2, -1), vec3(0.4, 0.4, 0.4));
+  Cam.SetLocAtUp(vec3(0, 10, 15), vec3(0, 0, 0), vec3(0, 1, 0));
+  return TRUE;
+} /* End of 'BuildGlass' function */
+
+/* Area lights soft shadow scene build function.
+ * ARGUMENTS:
+ *   - scene to fill:
+ *       rt::scene &Scene;
+ *   - camera to setup:
+ *       camera &Cam;
+ *   - benchmark settings:
+ *       const bench_cfg &Cfg;
+ * RETURNS:
+ *   (BOOL) TRUE if scene is built, FALSE otherwise.
+ */
+static BOOL BuildSoft( rt::scene &Scene, camera &Cam, const bench_cfg &Cfg )
+{
+  surface mtl;
+
+  Scene.AmbientColor = vec3(0.1);
+  Scene << new plane(vec3(0), vec3(0, 1, 0), Scene.Mtls.Add(mtl));
+  for (INT i = 0; i < 16; i++)
+  {
+    scn::SetMtl(mtl, i);
+    if (i % 2 == 0)
+      Scene << new sphere(vec3(i % 4 - 1.5, 0.5, i / 4 - 1.5) * 4 + vec3(0, 0.5, 0), 1, Scene.Mtls.Add(mtl));
+    else
+    {
+      vec3 C = vec3(i % 4 - 1.5, 0.5, i / 4 - 1.5) * 4 + vec3(0, 0.5, 0);
+      Scene << new box(C - vec3(0.8), C + vec3(0.8), Scene.Mtls.Add(mtl));
+    }
+  }
+  Scene << new lght::rect(vec3(-3, 12, -3), vec3(6, 0, 0), vec3(0, 0, 6), 80, vec3(1, 1, 1), 6);
+  Scene << new lght::sphere(vec3(10, 6, 8), 1.5, 30, vec3(1, 0.8, 0.6), 4);
+  Cam.SetLocAtUp(vec3(0, 14, 18), vec3(0, 0, 0), vec3(0, 1, 0));
+  return TRUE;
+} /* End of 'BuildSoft' function */
+
+/* Particles sphere cloud scene build function.
+ * ARGUMENTS:
+ *   - scene to fill:
+ *       rt::scene &Scene;
+ *   - camera to setup:
+ *       camera &Cam;
+ *   - benchmark settings:
+ *       const bench_cfg &Cfg;
+ * RETURNS:
+ *   (BOOL) TRUE if scene is built, FALSE otherwise.
+ */
+static BOOL BuildCloud( rt::scene &Scene, camera &Cam, const bench_cfg &Cfg )
+{
+  surface mtl;
+  sphere_cloud *Cloud = new sphere_cloud;
+  std::mt19937 rnd(30);
+  std::uniform_real_distribution<DBL> u(0, 1);
+
+  Scene.AmbientColor = vec3(0.1);
+  Scene << new plane(vec3(0, -2, 0), vec3(0, 1, 0), Scene.Mtls.Add(mtl));
+  for (INT i = 0; i < 8; i++)
+  {
+    scn::SetMtl(mtl, i);
+    Cloud->AddMtl(Scene.Mtls.Add(mtl));
+  }
+  // Spiral galaxy like disk
+  Cloud->Reserve(Cfg.CloudCount);
+  for (INT i = 0; i < Cfg.CloudCount; i++)
+  {
+    DBL
+      r = 12 * sqrt(u(rnd)),
+      a = u(rnd) * 2 * PI + r * 0.4,
+      h = (u(rnd) - 0.5) * (2.5 - r * 0.15);
+
+    Cloud->Add(vec3(r * cos(a), h + 2, r * sin(a)), 0.01 + 0.03 * u(rnd), (WORD)(i % 8));
+  }
+  auto t0 = std::chrono::steady_clock::now();
+  Cloud->Build();
+  auto t1 = std::chrono::steady_clock::now();
+  std::cout << "cloud: " << Cfg.CloudCount << " spheres, BVH build " <<
+    std::chrono::duration<DBL>(t1 - t0).count() << " s, " << Cloud->Memory() / (1024.0 * 1024.0) << " MB" << std::endl;
+  Scene << Cloud;
+  Scene << new lght::point(vec3(0, 20, 0), 100, vec3(1, 1, 1));
+  Scene << new lght::direction(vec3(-1, -3, -2), vec3(0.5, 0.5, 0.5));
+  Cam.SetLocAtUp(vec3(0, 14, 18), vec3(0, 1, 0), vec3(0, 1, 0));
+  return TRUE;
+} /* End of 'BuildCloud' function */
+
+/* Scene working set meter class.
+ * Process peak working set only grows, so every scene after the largest one
+ * would report its peak. Scene peak is sampled current working set growth
+ * over scene start instead (sampled after scene build and each render, so
+ * short peaks inside render are not seen).
+ */
+class rss_meter
+{
+  DBL Start = 0, Peak = 0; // Scene start and peak working set in megabytes
+
+  /* Obtain process working set function.
+   * ARGUMENTS: None.
+   * RETURNS:
+   *   (DBL) current working set in megabytes.
+   */
+  static DBL WorkingSet( VOID )
+  {
+    PROCESS_MEMORY_COUNTERS pmc {};
+
+    pmc.cb = sizeof(pmc);
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+      return 0;
+    return pmc.WorkingSetSize / (1024.0 * 1024.0);
+  } /* End of 'WorkingSet' function */
+
+public:
+  /* Start scene measure function.
+   * ARGUMENTS: None.
+   * RETURNS: None.
+   */
+  VOID Reset( VOID )
+  {
+    Start = Peak = WorkingSet();
+  } /* End of 'Reset' function */
+
+  /* Sample working set function.
+   * ARGUMENTS: None.
+   * RETURNS:
+   *   (DBL) scene peak working set growth in megabytes.
+   */
+  DBL Sample( VOID )
+  {
+    Peak = max(Peak, WorkingSet());
+    return Peak - Start;
+  } /* End of 'Sample' function */
+}; /* End of 'rss_meter' class */
+
+// Current scene working set meter
+static rss_meter Rss;
+
+/* Load baseline median times function.
+ * ARGUMENTS:
+ *   - baseline file name:
+ *       const std::string &FileName;
+ * RETURNS:
+ *   (std::map<std::string, DBL>) scene name to time map (empty if no file).
+ */
+static std::map<std::string, DBL> LoadBaseline( const std::string &FileName )
+{
+  std::map<std::string, DBL> res;
+  std::ifstream f(FileName);
+  std::stringstream ss;
+
+  if (!f.is_open())
+    return res;
+  ss << f.rdbuf();
+  std::string s = ss.str();
+
+  // Scene records look like: "name": {"time": 1.234, ...}
+  size_t pos = s.find("\"scenes\"");
+  if (pos != std::string::npos)
+    pos = s.find('{', pos);
+  while (pos != std::string::npos)
+  {
+    size_t q0 = s.find('"', pos + 1);
+    if (q0 == std::string::npos)
+      break;
+    size_t q1 = s.find('"', q0 + 1);
+    size_t t = s.find("\"time\":", q1);
+    size_t end = s.find('}', q1);
+    if (q1 == std::string::npos || t == std::string::npos || end == std::string::npos || t > end)
+      break;
+    res[s.substr(q0 + 1, q1 - q0 - 1)] = atof(s.c_str() + t + 7);
+    pos = end;
+  }
+  return res;
+} /* End of 'LoadBaseline' function */
+
+/* Compare result with baseline function.
+ * ARGUMENTS:
+ *   - result to compare:
+ *       const bench_result &Br;
+ *   - baseline times:
+ *       const std::map<std::string, DBL> &Base;
+ *   - benchmark settings:
+ *       const bench_cfg &Cfg;
+ * RETURNS:
+ *   (BOOL) TRUE if result is slower than threshold allows, FALSE otherwise.
+ */
+static BOOL CheckBaseline( const bench_result &Br, const std::map<std::string, DBL> &Base, const bench_cfg &Cfg )
+{
+  BOOL IsRegression = FALSE;
+
+  if (auto it = Base.find(Br.Name); it != Base.end() && it->second > 0)
+  {
+    DBL change = (Br.Time / it->second - 1) * 100;
+    std::cout << ", " << std::showpos << change << std::noshowpos << "% vs baseline";
+    if (change > Cfg.Threshold)
+      std::cout << " REGRESSION", IsRegression = TRUE;
+  }
+  std::cout << std::endl;
+  return IsRegression;
+} /* End of 'CheckBaseline' function */
+
+/* Ray/box slab test microbenchmarks function.
+ * Every kernel tests the same random rays against the same random
+ * boxes: 'box::Intersect' through virtual call, scalar 'mth::Slab'
+ * and four box 'mth::Slab4'.
+ * ARGUMENTS:
+ *   - benchmark settings:
+ *       const bench_cfg &Cfg;
+ *   - baseline times:
+ *       const std::map<std::string, DBL> &Base;
+ *   - results to add to:
+ *       std::vector<bench_result> &Res;
+ * RETURNS:
+ *   (BOOL) TRUE if any kernel regressed, FALSE otherwise.
+ */
+static BOOL RunKernels( const bench_cfg &Cfg, const std::map<std::string, DBL> &Base, std::vector<bench_result> &Res )
+{
+  const INT NumOfBoxes = 1024, NumOfRays = 4096;
+  std::vector<vec3> mins(NumOfBoxes), maxs(NumOfBoxes);
+  std::vector<std::unique_ptr<shape>> boxes(NumOfBoxes);
+  std::vector<mth::box4> packs(NumOfBoxes / 4);
+  std::vector<ray> rays(NumOfRays);
+  BOOL IsRegression = FALSE;
+
+  srand(30);
+  for (INT i = 0; i < NumOfBoxes; i++)
+  {
+    vec3 c = vec3::Rnd1() * 10, s = vec3(0.1) + vec3(rand() % 100, rand() % 100, rand() % 100) / 50.0;
+
+    mins[i] = c - s;
+    maxs[i] = c + s;
+    boxes[i] = std::make_unique<box>(mins[i], maxs[i]);
+    packs[i / 4].Set(i % 4, mins[i], maxs[i]);
+  }
+  for (INT i = 0; i < NumOfRays; i++)
+    rays[i] = ray(vec3::Rnd1() * 20, vec3::Rnd1());
+
+  // Kernels return hits count, so loops can't be thrown away
+  const std::pair<const CHAR *, std::function<UINT64( VOID )>> kernels[] =
+  {
+    {"kernel_box_virtual", [&]( VOID )
+      {
+        UINT64 hits = 0;
+        intr in;
+        for (const ray &r : rays)
+          for (const std::unique_ptr<shape> &b : boxes)
+            hits += b->Intersect(r, &in);
+        return hits;
+      }},
+    {"kernel_slab", [&]( VOID )
+      {
+        UINT64 hits = 0;
+        DBL tn, tf;
+        for (const ray &r : rays)
+          for (INT i = 0; i < NumOfBoxes; i++)
+            hits += mth::Slab(r, mins[i], maxs[i], &tn, &tf);
+        return hits;
+      }},
+    {"kernel_slab4", [&]( VOID )
+      {
+        UINT64 hits = 0;
+        DBL tn[4];
+        for (const ray &r : rays)
+          for (const mth::box4 &p : packs)
+            hits += std::popcount((UINT)mth::Slab4(r, p, 1e300, tn));
+        return hits;
+      }},
+  };
+
+  for (auto &k : kernels)
+  {
+    std::vector<DBL> Times;
+    UINT64 hits = 0;
+
+    for (INT r = 0; r < Cfg.WarmUps + Cfg.Reps; r++)
+    {
+      auto t0 = std::chrono::steady_clock::now();
+      hits = k.second();
+      auto t1 = std::chrono::steady_clock::now();
+
+      if (r >= Cfg.WarmUps)
+        Times.push_back(std::chrono::duration<DBL>(t1 - t0).count());
+    }
+    std::sort(Times.begin(), Times.end());
+
+    bench_result br;
+    br.Name = k.first;
+    br.Time = Times[Times.size() / 2];
+    br.MinTime = Times[0];
+    br.RaysPerSec = (DBL)NumOfRays * NumOfBoxes / br.Time;
+    br.PeakRSS = Rss.Sample();
+    Res.push_back(br);
+
+    std::cout << std::fixed << std::setprecision(2) << k.first << ": " <<
+      br.Time * 1e9 / ((DBL)NumOfRays * NumOfBoxes) << " ns/test, " << hits << " hits";
+    IsRegression |= CheckBaseline(br, Base, Cfg);
+  }
+  return IsRegression;
+} /* End of 'RunKernels' function */
+
+/* Batched query API throughput benchmark function.
+ * Rays go from camera through random frame points, closest hit
+ * rays have unlimited range, occlusion rays are cut at random
+ * distance up to 50.
+ * ARGUMENTS:
+ *   - scene and its camera:
+ *       rt::scene &Scene;
+ *       camera &Cam;
+ *   - scene name:
+ *       const std::string &Name;
+ *   - benchmark settings:
+ *       const bench_cfg &Cfg;
+ *   - baseline times:
+ *       const std::map<std::string, DBL> &Base;
+ *   - results to add to:
+ *       std::vector<bench_result> &Res;
+ * RETURNS:
+ *   (BOOL) TRUE if any query regressed, FALSE otherwise.
+ */
+static BOOL RunQueries( rt::scene &Scene, camera &Cam, const std::string &Name, const bench_cfg &Cfg,
+                        const std::map<std::string, DBL> &Base, std::vector<bench_result> &Res )
+{
+  INT n = Cfg.QueryCount;
+  std::vector<DBL> org((size_t)n * 3), dir((size_t)n * 3), range((size_t)n * 2), cut((size_t)n * 2);
+  std::vector<gortHIT> hits(n);
+  std::vector<BYTE> bits((n + 7) / 8);
+  std::mt19937 rnd(30);
+  std::uniform_real_distribution<DBL> u(0, 1);
+  BOOL IsRegression = FALSE;
+
+  for (INT i = 0; i < n; i++)
+  {
+    ray r = Cam.FrameRay(u(rnd) * Cam.FrameW, u(rnd) * Cam.FrameH);
+
+    for (INT k = 0; k < 3; k++)
+      org[i * 3 + k] = r.Org[k], dir[i * 3 + k] = r.Dir[k];
+    range[i * 2] = cut[i * 2] = 0;
+    range[i * 2 + 1] = 1e30;
+    cut[i * 2 + 1] = u(rnd) * 50;
+  }
+
+  // Queries return hits count, so calls can't be thrown away
+  const std::pair<const CHAR *, std::function<INT( VOID )>> queries[] =
+  {
+    {"query", [&]( VOID )
+      {
+        return GORT_Intersect((gortSCENE *)&Scene, n, org.data(), dir.data(), range.data(), hits.data(), Cfg.Threads);
+      }},
+    {"occlusion", [&]( VOID )
+      {
+        return GORT_Occluded((gortSCENE *)&Scene, n, org.data(), dir.data(), cut.data(), bits.data(), Cfg.Threads);
+      }},
+  };
+
+  for (auto &q : queries)
+  {
+    std::vector<DBL> Times;
+    INT found = 0;
+
+    for (INT r = 0; r < Cfg.WarmUps + Cfg.Reps; r++)
+    {
+      auto t0 = std::chrono::steady_clock::now();
+      found = q.second();
+      auto t1 = std::chrono::steady_clock::now();
+
+      if (r >= Cfg.WarmUps)
+        Times.push_back(std::chrono::duration<DBL>(t1 - t0).count());
+    }
+    std::sort(Times.begin(), Times.end());
+
+    bench_result br;
+    br.Name = Name + "/" + q.first;
+    br.Time = Times[Times.size() / 2];
+    br.MinTime = Times[0];
+    br.RaysPerSec = n / br.Time;
+    br.PeakRSS = Rss.Sample();
+    Res.push_back(br);
+
+    std::cout << std::fixed << std::setprecision(4) << br.Name << ": " << br.Time << " s (min " << br.MinTime << " s), " <<
+      std::setprecision(2) << br.RaysPerSec / 1e6 << " Mrays/s, " << found << " of " << n << " rays hit";
+    IsRegression |= CheckBaseline(br, Base, Cfg);
+  }
+  return IsRegression;
+} /* End of 'RunQueries' function */
+
+/* Caustics photon map statistics and gather benchmark function.
+ * Map is left by last scene render, gathers are done near stored
+ * photons on one thread.
+ * ARGUMENTS:
+ *   - scene:
+ *       rt::scene &Scene;
+ *   - scene name:
+ *       const std::string &Name;
+ *   - benchmark settings:
+ *       const bench_cfg &Cfg;
+ *   - baseline times:
+ *       const std::map<std::string, DBL> &Base;
+ *   - results to add to:
+ *       std::vector<bench_result> &Res;
+ * RETURNS:
+ *   (BOOL) TRUE if gather regressed, FALSE otherwise.
+ */
+static BOOL RunCaustics( rt::scene &Scene, const std::string &Name, const bench_cfg &Cfg,
+                         const std::map<std::string, DBL> &Base, std::vector<bench_result> &Res )
+{
+  const photon_map &pm = Scene.Caustics;
+  const INT n = 100000;
+  std::mt19937 rnd(30);
+  std::uniform_real_distribution<DBL> u(-1, 1);
+  std::vector<vec3> pts, nrm;
+  vec3 sum(0);
+
+  std::cout << std::fixed << std::setprecision(2) << Name << "/caustics: " << pm.Size() << " of " << pm.Emitted <<
+    " photons stored, " << pm.Memory() / (1024.0 * 1024.0) << " MB, trace " << pm.TraceTime * 1000 <<
+    " ms, kd-tree " << pm.BuildTime * 1000 << " ms" << std::endl;
+  if (pm.Size() == 0)
+    return FALSE;
+  for (INT i = 0; i < n; i++)
+  {
+    const photon_map::photon &ph = pm[(INT)(rnd() % pm.Size())];
+
+    pts.push_back(vec3(ph.P[0], ph.P[1], ph.P[2]) + vec3(u(rnd), u(rnd), u(rnd)) * Scene.CausticRadius);
+    nrm.push_back(-vec3(ph.Dir[0], ph.Dir[1], ph.Dir[2]));
+  }
+  auto t0 = std::chrono::steady_clock::now();
+  for (INT i = 0; i < n; i++)
+    sum += pm.Irradiance(pts[i], nrm[i], Scene.CausticRadius, Scene.CausticK);
+  auto t1 = std::chrono::steady_clock::now();
+
+  bench_result br;
+  br.Name = Name + "/caustics";
+  br.Time = br.MinTime = std::chrono::duration<DBL>(t1 - t0).count();
+  br.RaysPerSec = n / br.Time;
+  br.PeakRSS = Rss.Sample();
+  Res.push_back(br);
+
+  // Sum is printed, so gathers can't be thrown away
+  std::cout << std::setprecision(4) << br.Name << ": " << br.Time * 1e9 / n << " ns per gather (k " << Scene.CausticK <<
+    ", radius " << Scene.CausticRadius << "), mean irradiance " << (sum[0] + sum[1] + sum[2]) / (3 * n);
+  return CheckBaseline(br, Base, Cfg);
+} /* End of 'RunCaustics' function */
+
+/* Animated sphere clouds refit benchmark function.
+ * Clouds spheres orbit around vertical axis with angular speed
+ * decreasing with distance (tree quality degrades with frames).
+ * Each frame spheres are moved, scene is refitted and rendered.
+ * ARGUMENTS:
+ *   - scene:
+ *       rt::scene &Scene;
+ *   - camera:
+ *       camera &Cam;
+ *   - scene name:
+ *       const std::string &Name;
+ *   - benchmark settings:
+ *       const bench_cfg &Cfg;
+ *   - frame:
+ *       frame &Frm;
+ *   - baseline times:
+ *       const std::map<std::string, DBL> &Base;
+ *   - results to add to:
+ *       std::vector<bench_result> &Res;
+ * RETURNS:
+ *   (BOOL) TRUE if refit regressed, FALSE otherwise.
+ */
+static BOOL RunAnimation( rt::scene &Scene, camera &Cam, const std::string &Name, const bench_cfg &Cfg,
+                          frame &Frm, const std::map<std::string, DBL> &Base, std::vector<bench_result> &Res )
+{
+  std::vector<sphere_cloud *> Clouds;
+  INT spheres = 0, rebuilt = 0;
+  DBL move = 0, refit = 0, render = 0, build = 0, sah = 0;
+
+  for (auto shp : Scene.Shapes)
+    if (auto c = dynamic_cast<sphere_cloud *>(shp); c != nullptr)
+      Clouds.push_back(c), spheres += c->Count();
+  if (Clouds.empty())
+    return FALSE;
+
+  // Full rebuild time for comparison
+  auto t0 = std::chrono::steady_clock::now();
+  for (auto c : Clouds)
+    c->Build();
+  auto t1 = std::chrono::steady_clock::now();
+  build = std::chrono::duration<DBL>(t1 - t0).count();
+
+  for (INT f = 0; f < Cfg.AnimFrames; f++)
+  {
+    t0 = std::chrono::steady_clock::now();
+    for (auto c : Clouds)
+      for (INT i = 0; i < c->Count(); i++)
+      {
+        vec3 p = c->GetCenter(i);
+        DBL r = sqrt(p[0] * p[0] + p[2] * p[2]), a = 0.02 / (0.5 + r * 0.25), ca = cos(a), sa = sin(a);
+
+        c->SetSphere(i, vec3(p[0] * ca - p[2] * sa, p[1], p[0] * sa + p[2] * ca), c->GetRadius(i));
+      }
+    t1 = std::chrono::steady_clock::now();
+    move += std::chrono::duration<DBL>(t1 - t0).count();
+
+    t0 = std::chrono::steady_clock::now();
+    rebuilt += Scene.Refit(Cfg.Threads);
+    t1 = std::chrono::steady_clock::now();
+    refit += std::chrono::duration<DBL>(t1 - t0).count();
+
+    t0 = std::chrono::steady_clock::now();
+    Scene.Render(Frm, Cam, Cfg.Threads);
+    t1 = std::chrono::steady_clock::now();
+    render += std::chrono::duration<DBL>(t1 - t0).count();
+    Rss.Sample();
+  }
+  for (auto c : Clouds)
+    sah = max(sah, c->SahCost / c->BuildCost);
+
+  bench_result br;
+  br.Name = Name + "/refit";
+  br.Time = br.MinTime = refit / Cfg.AnimFrames;
+  br.RaysPerSec = spheres / br.Time;
+  br.PeakRSS = Rss.Sample();
+  Res.push_back(br);
+
+  std::cout << std::fixed << std::setprecision(2) << br.Name << ": " << Cfg.AnimFrames << " frames, per frame move " <<
+    move / Cfg.AnimFrames * 1000 << " ms, refit " << br.Time * 1000 << " ms (" << rebuilt << " rebuilds, full build " <<
+    build * 1000 << " ms), render " << render / Cfg.AnimFrames * 1000 << " ms, SAH cost ratio " << sah;
+  return CheckBaseline(br, Base, Cfg);
+} /* End of 'RunAnimation' function */
+
+/* Path tracing convergence measure function.
+ * Reference is rendered by surface sampling only ('IsPathMis' off)
+ * with 'PathRefSamples' samples, then both modes are rendered with
+ * 1, 2, 4, ... 64 samples. Time and RMSE of linear color against
+ * reference are stored to 'bench/<Name>_convergence.csv'.
+ * ARGUMENTS:
+ *   - scene:
+ *       rt::scene &Scene;
+ *   - camera:
+ *       camera &Cam;
+ *   - scene name:
+ *       const std::string &Name;
+ *   - benchmark settings:
+ *       const bench_cfg &Cfg;
+ *   - frame and feature buffers (frame sized):
+ *       frame &Frm;
+ *       gbuffer &Features;
+ * RETURNS:
+ *   (BOOL) TRUE if results are stored, FALSE otherwise.
+ */
+static BOOL RunConvergence( rt::scene &Scene, camera &Cam, const std::string &Name, const bench_cfg &Cfg,
+                            frame &Frm, gbuffer &Features )
+{
+  std::vector<FLT> Ref[3];
+  std::ofstream f("bench/" + Name + "_convergence.csv");
+
+  Scene.IsPath = TRUE;
+  Scene.IsPathMis = FALSE;
+  auto t0 = std::chrono::steady_clock::now();
+  Scene.RenderRect(Frm, Cam, Cfg.Threads, 0, 0, Frm.W, Frm.H, Cfg.PathRefSamples, nullptr, &Features);
+  auto t1 = std::chrono::steady_clock::now();
+  for (INT k = 0; k < 3; k++)
+    Ref[k] = Features.Color[k];
+  std::cout << Name << "/path reference: " << Cfg.PathRefSamples << " spp in " << std::fixed << std::setprecision(2) <<
+    std::chrono::duration<DBL>(t1 - t0).count() << " s" << std::endl;
+  f << "mode,spp,seconds,rmse\n";
+  for (INT mis = 1; mis >= 0; mis--)
+    for (INT spp = 1; spp <= 64; spp *= 2)
+    {
+      DBL err = 0;
+
+      Scene.IsPathMis = mis;
+      t0 = std::chrono::steady_clock::now();
+      Scene.RenderRect(Frm, Cam, Cfg.Threads, 0, 0, Frm.W, Frm.H, spp, nullptr, &Features);
+      t1 = std::chrono::steady_clock::now();
+      for (INT k = 0; k < 3; k++)
+        for (size_t i = 0; i < Ref[k].size(); i++)
+          err += (Features.Color[k][i] - Ref[k][i]) * (Features.Color[k][i] - Ref[k][i]);
+      err = sqrt(err / (3.0 * Frm.W * Frm.H));
+
+      DBL sec = std::chrono::duration<DBL>(t1 - t0).count();
+      f << (mis ? "mis" : "bsdf") << "," << spp << "," << sec << "," << err << "\n";
+      std::cout << Name << "/path " << (mis ? "mis" : "bsdf") << " " << spp << " spp: " << std::fixed <<
+        std::setprecision(4) << sec << " s, rmse " << err << std::endl;
+    }
+  Scene.IsPath = FALSE;
+  Scene.IsPathMis = TRUE;
+  return f.good();
+} /* End of 'RunConvergence' function */
+
+/* Store results to JSON file function.
+ * ARGUMENTS:
+ *   - file name:
+ *       const std::string &FileName;
+ *   - benchmark settings:
+ *       const bench_cfg &Cfg;
+ *   - results:
+ *       const std::vector<bench_result> &Res;
+ * RETURNS:
+ *   (BOOL) TRUE if success, FALSE otherwise.
+ */
+static BOOL SaveResults( const std::string &FileName, const bench_cfg &Cfg, const std::vector<bench_result> &Res )
+{
+  std::ofstream f(FileName);
+
+  if (!f.is_open())
+    return FALSE;
+  f << "{\n  \"width\": " << Cfg.W << ", \"height\": " << Cfg.H <<
+    ", \"threads\": " << Cfg.Threads << ", \"reps\": " << Cfg.Reps << ",\n  \"scenes\": {";
+  for (size_t i = 0; i < Res.size(); i++)
+    f << (i == 0 ? "\n" : ",\n") << "    \"" << Res[i].Name << "\": {\"time\": " << Res[i].Time <<
+      ", \"min_time\": " << Res[i].MinTime << ", \"rays_per_sec\": " << Res[i].RaysPerSec <<
+      ", \"scene_peak_rss_mb\": " << Res[i].PeakRSS << "}";
+  f << "\n  }\n}\n";
+  return TRUE;
+} /* End of 'SaveResults' function */
+
+/* The main program function.
+ * ARGUMENTS:
+ *   - command line arguments:
+ *       INT argc, CHAR *argv[];
+ * RETURNS:
+ *   (INT) 0 if no regressions, 1 otherwise.
+ */
+INT main( INT argc, CHAR *argv[] )
+{
+  bench_cfg Cfg;
+  const bench_scene Scenes[] =
+  {
+    {"spheres", BuildSpheres},
+    {"default", BuildDefault},
+    {"mesh",    BuildMesh},
+    {"csg",     BuildCSG},
+    {"glass",   BuildGlass},
+    {"soft",    BuildSoft},
+    {"cloud",   BuildCloud},
+    {"snapshot", BuildSnapshot},
+  };
+
+  for (INT i = 1; i + 1 < argc; i += 2)
+  {
+    std::string opt = argv[i], val = argv[i + 1];
+
+    if (opt == "-w")
+      Cfg.W = atoi(val.c_str());
+    else if (opt == "-h")
+      Cfg.H = atoi(val.c_str());
+    else if (opt == "-t")
+      Cfg.Threads = max(atoi(val.c_str()), 1);
+    else if (opt == "-r")
+      Cfg.Reps = max(atoi(val.c_str()), 1);
+    else if (opt == "-u")
+      Cfg.WarmUps = max(atoi(val.c_str()), 0);
+    else if (opt == "-m")
+      Cfg.Model = val;
+    else if (opt == "-b")
+      Cfg.Baseline = val;
+    else if (opt == "-o")
+      Cfg.Out = val;
+    else if (opt == "-x")
+      Cfg.Threshold = atof(val.c_str());
+    else if (opt == "-s")
+      Cfg.Only = val;
+    else if (opt == "-l")
+      Cfg.Snapshot = val;
+    else if (opt == "-f")
+      Cfg.IsFlat = atoi(val.c_str()) != 0;
+    else if (opt == "-k")
+      Cfg.IsKernels = atoi(val.c_str()) != 0;
+    else if (opt == "-d")
+      Cfg.IsDenoise = atoi(val.c_str()) != 0;
+    else if (opt == "-p")
+      Cfg.IsPinned = atoi(val.c_str()) != 0;
+    else if (opt == "-n")
+      Cfg.IsNuma = atoi(val.c_str()) != 0;
+    else if (opt == "-c")
+      Cfg.IsScaling = atoi(val.c_str()) != 0;
+    else if (opt == "-z")
+      Cfg.CloudCount = max(atoi(val.c_str()), 1);
+    else if (opt == "-q")
+      Cfg.IsQuantized = atoi(val.c_str()) != 0;
+    else if (opt == "-v")
+      Cfg.IsRaster = atoi(val.c_str()) != 0;
+    else if (opt == "-y")
+      Cfg.QueryCount = max(atoi(val.c_str()), 0);
+    else if (opt == "-g")
+      Cfg.PathRefSamples = max(atoi(val.c_str()), 0);
+    else if (opt == "-e")
+      Cfg.CausticPhotons = max(atoi(val.c_str()), 0);
+    else if (opt == "-i")
+      Cfg.IrrCache = min(max(atoi(val.c_str()), 0), 2);
+    else if (opt == "-a")
+      Cfg.AnimFrames = max(atoi(val.c_str()), 0);
+    else if (opt == "-j")
+      Cfg.MemoryBudget = max(atof(val.c_str()), 0.0);
+  }
+
+  std::map<std::string, DBL> Base = LoadBaseline(Cfg.Baseline);
+  std::vector<bench_result> Res;
+  BOOL IsRegression = FALSE;
+  frame Frm;
+  gbuffer Features;
+
+  Frm.Resize(Cfg.W, Cfg.H);
+  Features.Resize(Cfg.W, Cfg.H);
+  std::cout << "Benchmark " << Cfg.W << "x" << Cfg.H << ", " << Cfg.Threads << " threads, " <<
+    Cfg.WarmUps << " warm-up + " << Cfg.Reps << " reps" <<
+    (Cfg.IsFlat ? ", typed shape arrays" : "") << (Cfg.IsDenoise ? ", denoise" : "") <<
+    (Cfg.IsPinned ? ", pinned" : "") << (Cfg.IsNuma ? ", NUMA" : "") <<
+    (Cfg.IsRaster ? ", raster primary" : "") << std::endl;
+
+  // Measured threads counts
+  std::vector<INT> Counts;
+  if (Cfg.IsScaling)
+    for (INT n = 1; n < Cfg.Threads; n *= 2)
+      Counts.push_back(n);
+  Counts.push_back(Cfg.Threads);
+  for (const bench_scene &bs : Scenes)
+  {
+    if (!Cfg.Only.empty() && Cfg.Only != bs.Name)
+      continue;
+
+    rt::scene *Scene = new rt::scene;
+    camera Cam;
+
+    // Same random sequence for every run
+    srand(30);
+    Rss.Reset();
+    Cam.SetProj(0.1, 0.1, 500);
+    Cam.Resize(Cfg.W, Cfg.H);
+    Scene->MemoryBudget = (size_t)(max(Cfg.MemoryBudget, 0.0) * 1024 * 1024);
+    if (!bs.Build(*Scene, Cam, Cfg) || Scene->IsOverBudget)
+    {
+      std::cout << bs.Name << ": skipped (scene data not found or over memory budget)" << std::endl;
+      Scene->Clear();
+      delete Scene;
+      continue;
+    }
+    if (Cfg.IsFlat)
+      Scene->Flatten();
+    Rss.Sample();
+    if (Cfg.MemoryBudget >= 0)
+    {
+      mem_report rep;
+
+      Scene->Account(rep);
+      rep.Add("frame", "color", 1, Frm.Memory());
+      rep.Add("frame", "features", 1, Features.Memory());
+      std::cout << bs.Name << " memory:" << std::endl;
+      rep.Print(std::cout, Scene->MemoryBudget);
+      if (!Scene->IsInBudget())
+      {
+        std::cout << bs.Name << ": skipped (over memory budget)" << std::endl;
+        Scene->Clear();
+        delete Scene;
+        continue;
+      }
+    }
+    Scene->Pool.Setup({Cfg.Threads, Cfg.IsPinned, Cfg.IsNuma});
+    Scene->IsRaster = Cfg.IsRaster;
+    Scene->IsCaustics = Cfg.CausticPhotons > 0;
+    Scene->CausticPhotons = Cfg.CausticPhotons;
+    Scene->IsIrrCache = Cfg.IrrCache > 0;
+    Scene->IsIrrCacheKeep = Cfg.IrrCache > 1;
+
+    DBL Time1 = 0;
+    for (INT n : Counts)
+    {
+      std::vector<DBL> Times, Rates;
+      for (INT r = 0; r < Cfg.WarmUps + Cfg.Reps; r++)
+      {
+        auto t0 = std::chrono::steady_clock::now();
+        cost c = Scene->Render(Frm, Cam, n, nullptr, Cfg.IsDenoise ? &Features : nullptr);
+        if (Cfg.IsDenoise)
+        {
+          Features.Denoise(Scene->Pool, n);
+          Features.ToFrame(Frm);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+
+        if (r >= Cfg.WarmUps)
+        {
+          Times.push_back(std::chrono::duration<DBL>(t1 - t0).count());
+          Rates.push_back(c.Rays / Times.back());
+        }
+        Rss.Sample();
+      }
+      // Rays count differs between renders (adaptive shadows), so rate is median of renders rates
+      std::sort(Times.begin(), Times.end());
+      std::sort(Rates.begin(), Rates.end());
+
+      bench_result br;
+      br.Name = Cfg.IsScaling ? std::string(bs.Name) + "/t" + std::to_string(n) : bs.Name;
+      br.Time = Times[Times.size() / 2];
+      br.MinTime = Times[0];
+      br.RaysPerSec = Rates[Rates.size() / 2];
+      br.PeakRSS = Rss.Sample();
+      Res.push_back(br);
+      if (n == 1)
+        Time1 = br.Time;
+
+      std::cout << std::fixed << std::setprecision(4) << br.Name << ": " << br.Time << " s (min " << br.MinTime << " s), " <<
+        std::setprecision(2) << br.RaysPerSec / 1e6 << " Mrays/s, scene peak RSS +" << br.PeakRSS << " MB";
+      if (Cfg.IsScaling && Time1 > 0)
+        std::cout << ", speedup " << Time1 / br.Time << "x, efficiency " << Time1 / br.Time / n * 100 << "%";
+      IsRegression |= CheckBaseline(br, Base, Cfg);
+    }
+    Frm.SaveTGA(std::string("bench/") + bs.Name + ".tga", std::string("Benchmark scene ") + bs.Name);
+    if (Cfg.MemoryBudget >= 0)
+    {
+      mem_report rep;
+
+      Scene->Pool.Account(rep);
+      std::cout << bs.Name << "/transient memory: " << std::setprecision(2) <<
+        Scene->Pool.TransientPeak() / 1024.0 << " KB per worker at most (" <<
+        rep.Items["thread/scratch"].Peak / 1024.0 << " KB scratch line, " <<
+        rep.Items["thread/heap"].Peak / 1024.0 << " KB heap hit lists and lines; thread stacks not counted)" << std::endl;
+    }
+    if (Cfg.IrrCache > 0)
+      std::cout << bs.Name << "/irradiance cache: " << Scene->Irr.Size() << " records, " << std::setprecision(2) <<
+        Scene->Irr.Memory() / (1024.0 * 1024.0) << " MB" << std::endl;
+    if (Cfg.QueryCount > 0)
+      IsRegression |= RunQueries(*Scene, Cam, bs.Name, Cfg, Base, Res);
+    if (Cfg.CausticPhotons > 0)
+      IsRegression |= RunCaustics(*Scene, bs.Name, Cfg, Base, Res);
+    if (Cfg.AnimFrames > 0)
+      IsRegression |= RunAnimation(*Scene, Cam, bs.Name, Cfg, Frm, Base, Res);
+    if (Cfg.PathRefSamples > 0)
+      RunConvergence(*Scene, Cam, bs.Name, Cfg, Frm, Features);
+
+    Scene->Clear();
+    delete Scene;
+  }
+  if (Cfg.IsKernels)
+  {
+    Rss.Reset();
+    IsRegression |= RunKernels(Cfg, Base, Res);
+  }
+  if (!SaveResults(Cfg.Out, Cfg, Res))
+    std::cout << "Can't store results to " << Cfg.Out << std::endl;
+  if (Base.empty())
+    std::cout << "No baseline in " << Cfg.Baseline << ", copy " << Cfg.Out << " there to create it" << std::endl;
+  return IsRegression ? 1 : 0;
+} /* End of 'main' function */
+
+/* End of 'bench.cpp' file */
@@ -26,6 +26,7 @@
 #include "mth_matr.h"
 #include "mth_cam.h"
 #include "mth_ray.h"
+#include "mth_slab.h"
 
 
 #endif // __mth_h
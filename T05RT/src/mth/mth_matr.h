@@ -455,6 +455,38 @@ namespace mth // Space math namespace
       return matr(TransM);
     } /* End of 'Transpose' function */
 
+    /* Transform point function (row vector, translation is last row).
+     * ARGUMENTS:
+     *   - point to transform:
+     *       const vec3<Type1> &V;
+     * RETURNS:
+     *   (vec3) transformed point.
+     */
+    template<typename Type1>
+    vec3<Type1> PointTransform( const vec3<Type1> &V ) const
+    {
+      return vec3<Type1>(
+        (Type1)(V.X * M[0][0] + V.Y * M[1][0] + V.Z * M[2][0] + M[3][0]),
+        (Type1)(V.X * M[0][1] + V.Y * M[1][1] + V.Z * M[2][1] + M[3][1]),
+        (Type1)(V.X * M[0][2] + V.Y * M[1][2] + V.Z * M[2][2] + M[3][2]));
+    } /* End of 'PointTransform' function */
+
+    /* Transform vector function (translation is not applied).
+     * ARGUMENTS:
+     *   - vector to transform:
+     *       const vec3<Type1> &V;
+     * RETURNS:
+     *   (vec3) transformed vector.
+     */
+    template<typename Type1>
+    vec3<Type1> VectorTransform( const vec3<Type1> &V ) const
+    {
+      return vec3<Type1>(
+        (Type1)(V.X * M[0][0] + V.Y * M[1][0] + V.Z * M[2][0]),
+        (Type1)(V.X * M[0][1] + V.Y * M[1][1] + V.Z * M[2][1]),
+        (Type1)(V.X * M[0][2] + V.Y * M[1][2] + V.Z * M[2][2]));
+    } /* End of 'VectorTransform' function */
+
     /* Matrix ortho setup fuction.
      * ARGUMENTS:
      *   - size of projection space:
@@ -8,7 +8,7 @@
  *               Math ray handle module.
  * PROGRAMMER  : CGSG-SummerCamp'2024.
  *               Vladislav A. Golubov (VG6).
- * LAST UPDATE : 23.07.2024.
+ * LAST UPDATE : 19.10.2026.
  * NOTE        : None.
  *
  * No part of this file may be changed without agreement of
@@ -27,14 +27,20 @@ namespace mth
     {
     public:
       vec3<Type> Org, Dir; // ray vectors
+      vec3<Type> InvDir;   // direction reciprocals (infinity for zero components)
+      INT Sign[3];         // direction component signs (1 if negative, 0 otherwise)
 
-      /* Ray constructors */
-      ray( VOID )
+      /* Ray constructors (default is origin ray along Z axis, so slab data is always set) */
+      ray( VOID ) : ray(vec3<Type>(0), vec3<Type>(0, 0, 1))
       {
       }
       ray( const vec3<Type> &O, const vec3<Type> &D ) : Dir(D.Normalizing())
       {
         Org = O;
+        InvDir = vec3<Type>(1 / Dir[0], 1 / Dir[1], 1 / Dir[2]);
+        Sign[0] = InvDir[0] < 0;
+        Sign[1] = InvDir[1] < 0;
+        Sign[2] = InvDir[2] < 0;
       }
 
       /* Calculate point from ray function
@@ -0,0 +1,269 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : mth_slab.h
+ * PURPOSE     : Raytracing project.
+ *               Math ray/axis aligned box slab test module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : Tests use ray 'InvDir' and 'Sign', so there are
+ *               no divisions and no per axis branches. Four box
+ *               variant uses AVX when compiled with /arch:AVX or
+ *               higher and SSE2 otherwise, single precision four
+ *               box variant (BVH nodes) uses SSE.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#ifndef __mth_slab_h
+#define __mth_slab_h
+
+#include <immintrin.h>
+#include "mth_ray.h"
+
+/* Math library namespace */
+namespace mth
+{
+  /* Ray and axis aligned box intersection function.
+   * ARGUMENTS:
+   *   - ray to test:
+   *       const ray<Type> &R;
+   *   - box minimal and maximal corners:
+   *       const vec3<Type> &Min, &Max;
+   *   - result entry and exit distances (entry is negative if ray starts inside):
+   *       Type *TNear, *TFar;
+   * RETURNS:
+   *   (BOOL) TRUE if box is intersected in front of ray origin, FALSE otherwise.
+   */
+  template<typename Type>
+    inline BOOL Slab( const ray<Type> &R, const vec3<Type> &Min, const vec3<Type> &Max,
+                      Type *TNear, Type *TFar )
+    {
+      const vec3<Type> *b[2] = {&Min, &Max};
+      Type
+        nx = ((*b[R.Sign[0]])[0] - R.Org[0]) * R.InvDir[0],
+        fx = ((*b[1 - R.Sign[0]])[0] - R.Org[0]) * R.InvDir[0],
+        ny = ((*b[R.Sign[1]])[1] - R.Org[1]) * R.InvDir[1],
+        fy = ((*b[1 - R.Sign[1]])[1] - R.Org[1]) * R.InvDir[1],
+        nz = ((*b[R.Sign[2]])[2] - R.Org[2]) * R.InvDir[2],
+        fz = ((*b[1 - R.Sign[2]])[2] - R.Org[2]) * R.InvDir[2],
+        tn = nx > ny ? nx : ny,
+        tf = fx < fy ? fx : fy;
+
+      tn = tn > nz ? tn : nz;
+      tf = tf < fz ? tf : fz;
+      *TNear = tn;
+      *TFar = tf;
+      return (tn <= tf) & (tf >= 0);
+    } /* End of 'Slab' function */
+
+  /* Ray and axis aligned box intersection with hit faces function.
+   * Face numbers: axis * 2 for entry face, axis * 2 + 1 for exit face.
+   * ARGUMENTS:
+   *   - ray to test:
+   *       const ray<Type> &R;
+   *   - box minimal and maximal corners:
+   *       const vec3<Type> &Min, &Max;
+   *   - result entry and exit distances (entry is negative if ray starts inside):
+   *       Type *TNear, *TFar;
+   *   - result entry and exit face numbers:
+   *       INT *NearFace, *FarFace;
+   * RETURNS:
+   *   (BOOL) TRUE if box is intersected in front of ray origin, FALSE otherwise.
+   */
+  template<typename Type>
+    inline BOOL Slab( const ray<Type> &R, const vec3<Type> &Min, const vec3<Type> &Max,
+                      Type *TNear, Type *TFar, INT *NearFace, INT *FarFace )
+    {
+      const vec3<Type> *b[2] = {&Min, &Max};
+      Type
+        nx = ((*b[R.Sign[0]])[0] - R.Org[0]) * R.InvDir[0],
+        fx = ((*b[1 - R.Sign[0]])[0] - R.Org[0]) * R.InvDir[0],
+        ny = ((*b[R.Sign[1]])[1] - R.Org[1]) * R.InvDir[1],
+        fy = ((*b[1 - R.Sign[1]])[1] - R.Org[1]) * R.InvDir[1],
+        nz = ((*b[R.Sign[2]])[2] - R.Org[2]) * R.InvDir[2],
+        fz = ((*b[1 - R.Sign[2]])[2] - R.Org[2]) * R.InvDir[2],
+        tn = nx > ny ? nx : ny,
+        tf = fx < fy ? fx : fy;
+      INT
+        na = nx > ny ? 0 : 2,
+        fa = fx < fy ? 1 : 3;
+
+      na = tn > nz ? na : 4;
+      fa = tf < fz ? fa : 5;
+      tn = tn > nz ? tn : nz;
+      tf = tf < fz ? tf : fz;
+      *TNear = tn;
+      *TFar = tf;
+      *NearFace = na;
+      *FarFace = fa;
+      return (tn <= tf) & (tf >= 0);
+    } /* End of 'Slab' function */
+
+  /* Four axis aligned boxes packet (structure of arrays) */
+  struct alignas(32) box4
+  {
+    DBL Min[3][4]; // Minimal corners components: [axis][box]
+    DBL Max[3][4]; // Maximal corners components: [axis][box]
+
+    /* Set packet box function.
+     * ARGUMENTS:
+     *   - box number in packet (0..3):
+     *       INT No;
+     *   - box corners:
+     *       const vec3<DBL> &BMin, &BMax;
+     * RETURNS: None.
+     */
+    VOID Set( INT No, const vec3<DBL> &BMin, const vec3<DBL> &BMax )
+    {
+      for (INT i = 0; i < 3; i++)
+        Min[i][No] = BMin[i], Max[i][No] = BMax[i];
+    } /* End of 'Set' function */
+
+    /* Set empty (never intersected) packet box function.
+     * ARGUMENTS:
+     *   - box number in packet (0..3):
+     *       INT No;
+     * RETURNS: None.
+     */
+    VOID SetEmpty( INT No )
+    {
+      for (INT i = 0; i < 3; i++)
+        Min[i][No] = 1e300, Max[i][No] = -1e300;
+    } /* End of 'SetEmpty' function */
+  }; /* End of 'box4' structure */
+
+  /* Ray and four axis aligned boxes intersection function.
+   * Slab planes are ordered by ray 'Sign' (not by min/max of distances),
+   * so empty boxes (see 'box4::SetEmpty') are never intersected.
+   * ARGUMENTS:
+   *   - ray to test:
+   *       const ray<DBL> &R;
+   *   - boxes packet:
+   *       const box4 &B;
+   *   - maximal distance (closest hit found so far):
+   *       DBL TMax;
+   *   - result entry distances (clamped to 0 if ray starts inside):
+   *       DBL *TNear;
+   * RETURNS:
+   *   (INT) intersected boxes bit mask (bit i for box i).
+   */
+  inline INT Slab4( const ray<DBL> &R, const box4 &B, DBL TMax, DBL *TNear )
+  {
+#ifdef __AVX__
+    __m256d tn = _mm256_setzero_pd(), tf = _mm256_set1_pd(TMax);
+
+    for (INT i = 0; i < 3; i++)
+    {
+      const DBL
+        *bn = R.Sign[i] ? B.Max[i] : B.Min[i],
+        *bf = R.Sign[i] ? B.Min[i] : B.Max[i];
+      __m256d
+        o = _mm256_set1_pd(R.Org[i]),
+        inv = _mm256_set1_pd(R.InvDir[i]),
+        t1 = _mm256_mul_pd(_mm256_sub_pd(_mm256_load_pd(bn), o), inv),
+        t2 = _mm256_mul_pd(_mm256_sub_pd(_mm256_load_pd(bf), o), inv);
+
+      tn = _mm256_max_pd(tn, t1);
+      tf = _mm256_min_pd(tf, t2);
+    }
+    _mm256_storeu_pd(TNear, tn);
+    return _mm256_movemask_pd(_mm256_cmp_pd(tn, tf, _CMP_LE_OQ));
+#else
+    INT mask = 0;
+
+    // Two boxes per SSE2 register
+    for (INT h = 0; h < 4; h += 2)
+    {
+      __m128d tn = _mm_setzero_pd(), tf = _mm_set1_pd(TMax);
+
+      for (INT i = 0; i < 3; i++)
+      {
+        const DBL
+          *bn = R.Sign[i] ? B.Max[i] : B.Min[i],
+          *bf = R.Sign[i] ? B.Min[i] : B.Max[i];
+        __m128d
+          o = _mm_set1_pd(R.Org[i]),
+          inv = _mm_set1_pd(R.InvDir[i]),
+          t1 = _mm_mul_pd(_mm_sub_pd(_mm_load_pd(bn + h), o), inv),
+          t2 = _mm_mul_pd(_mm_sub_pd(_mm_load_pd(bf + h), o), inv);
+
+        tn = _mm_max_pd(tn, t1);
+        tf = _mm_min_pd(tf, t2);
+      }
+      _mm_storeu_pd(TNear + h, tn);
+      mask |= _mm_movemask_pd(_mm_cmple_pd(tn, tf)) << h;
+    }
+    return mask;
+#endif /* __AVX__ */
+  } /* End of 'Slab4' function */
+
+  /* Four axis aligned single precision boxes packet (structure of arrays) */
+  struct alignas(16) box4f
+  {
+    FLT Min[3][4]; // Minimal corners components: [axis][box]
+    FLT Max[3][4]; // Maximal corners components: [axis][box]
+  }; /* End of 'box4f' structure */
+
+  /* Ray broadcast to four single precision lanes structure */
+  struct ray4f
+  {
+    __m128 Org[3];    // Origin components
+    __m128 InvDir[3]; // Direction reciprocals
+    INT Sign[3];      // Direction component signs (1 if negative)
+
+    /* Broadcast ray constructor.
+     * ARGUMENTS:
+     *   - ray to broadcast:
+     *       const ray<DBL> &R;
+     */
+    explicit ray4f( const ray<DBL> &R )
+    {
+      for (INT i = 0; i < 3; i++)
+      {
+        Org[i] = _mm_set1_ps((FLT)R.Org[i]);
+        InvDir[i] = _mm_set1_ps((FLT)R.InvDir[i]);
+        Sign[i] = R.Sign[i];
+      }
+    } /* End of 'ray4f' function */
+  }; /* End of 'ray4f' structure */
+
+  /* Ray and four single precision axis aligned boxes intersection function.
+   * Same ordered slab planes as double precision variant, SSE only.
+   * ARGUMENTS:
+   *   - broadcast ray to test:
+   *       const ray4f &R;
+   *   - boxes packet:
+   *       const box4f &B;
+   *   - maximal distance (closest hit found so far):
+   *       FLT TMax;
+   *   - result entry distances (clamped to 0 if ray starts inside):
+   *       FLT *TNear;
+   * RETURNS:
+   *   (INT) intersected boxes bit mask (bit i for box i).
+   */
+  inline INT Slab4( const ray4f &R, const box4f &B, FLT TMax, FLT *TNear )
+  {
+    __m128 tn = _mm_setzero_ps(), tf = _mm_set1_ps(TMax);
+
+    for (INT i = 0; i < 3; i++)
+    {
+      __m128
+        t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(R.Sign[i] ? B.Max[i] : B.Min[i]), R.Org[i]), R.InvDir[i]),
+        t2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(R.Sign[i] ? B.Min[i] : B.Max[i]), R.Org[i]), R.InvDir[i]);
+
+      tn = _mm_max_ps(tn, t1);
+      tf = _mm_min_ps(tf, t2);
+    }
+    _mm_storeu_ps(TNear, tn);
+    return _mm_movemask_ps(_mm_cmple_ps(tn, tf));
+  } /* End of 'Slab4' function */
+} /* End of 'mth' namespace */
+
+#endif // !__mth_slab_h
+
+/* END OF 'mth_slab.h' FILE */
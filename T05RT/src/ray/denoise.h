@@ -0,0 +1,318 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : denoise.h
+ * PURPOSE     : Raytracing project.
+ *               Feature buffers and edge aware denoiser module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : Edge avoiding a-trous wavelet filter (5 x 5 B3 spline
+ *               kernel with growing step). Tap weight is one exp of
+ *               color, normal, depth and albedo distances sum.
+ *               Buffers are planar float arrays, filter processes
+ *               4 pixels per SSE register, rows of each pass are
+ *               split between workers of scene render thread pool.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#ifndef __denoise_h_
+#define __denoise_h_
+
+#include <vector>
+#include <atomic>
+#include <immintrin.h>
+#include "frame.h"
+#include "pool.h"
+
+/* Project namespace */
+namespace gort
+{
+  /* Render feature buffers and denoiser class */
+  class gbuffer
+  {
+  public:
+    // Buffers size
+    INT W = 0, H = 0;
+
+    // Planar buffers (one float per pixel each)
+    std::vector<FLT>
+      Color[3],  // Linear color
+      Albedo[3], // First hit diffuse color
+      Normal[3], // First hit normal (zero for background)
+      Depth;     // First hit distance (zero for background)
+
+    // Filter parameters
+    FLT
+      SigmaColor = 0.6f,  // Color distance scale (square is halved each iteration)
+      SigmaNormal = 0.3f, // Normal distance scale
+      SigmaDepth = 0.05f, // Relative depth distance scale
+      SigmaAlbedo = 0.2f; // Albedo distance scale
+    INT Iterations = 5;   // Filter iterations (step 1, 2, 4, ...)
+
+    /* Resize buffers function.
+     * ARGUMENTS:
+     *   - new buffers size:
+     *       INT NewW, NewH;
+     * RETURNS: None.
+     */
+    VOID Resize( INT NewW, INT NewH )
+    {
+      size_t n = (size_t)NewW * NewH;
+
+      W = NewW;
+      H = NewH;
+      for (INT i = 0; i < 3; i++)
+      {
+        Color[i].assign(n, 0);
+        Albedo[i].assign(n, 0);
+        Normal[i].assign(n, 0);
+      }
+      Depth.assign(n, 0);
+    } /* End of 'Resize' function */
+
+    /* Obtain buffer memory function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (size_t) all planar buffers memory in bytes.
+     */
+    size_t Memory( VOID ) const
+    {
+      size_t sum = Depth.capacity();
+      
+      for (INT i = 0; i < 3; i++)
+        sum += Color[i].capacity() + Albedo[i].capacity() + Normal[i].capacity();
+      return sum * sizeof(FLT);
+    } /* End of 'Memory' function */
+
+    /* Store pixel color and features function.
+     * ARGUMENTS:
+     *   - pixel coordinates:
+     *       INT X, Y;
+     *   - pixel color:
+     *       const vec3 &C;
+     *   - first hit albedo and normal:
+     *       const vec3 &A, &N;
+     *   - first hit distance:
+     *       DBL Z;
+     * RETURNS: None.
+     */
+    VOID Put( INT X, INT Y, const vec3 &C, const vec3 &A, const vec3 &N, DBL Z )
+    {
+      // Clipping
+      if (X < 0 || Y < 0 || X >= W || Y >= H)
+        return;
+
+      size_t i = (size_t)Y * W + X;
+      for (INT c = 0; c < 3; c++)
+      {
+        Color[c][i] = (FLT)C[c];
+        Albedo[c][i] = (FLT)A[c];
+        Normal[c][i] = (FLT)N[c];
+      }
+      Depth[i] = (FLT)Z;
+    } /* End of 'Put' function */
+
+    /* Denoise color buffer function.
+     * ARGUMENTS:
+     *   - thread pool to run filter passes on:
+     *       thread_pool &Pool;
+     *   - filter workers count (clamped to pool size):
+     *       INT ThreadCount;
+     * RETURNS: None.
+     */
+    VOID Denoise( thread_pool &Pool, INT ThreadCount )
+    {
+      std::vector<FLT> tmp[3];
+
+      for (INT c = 0; c < 3; c++)
+        tmp[c].resize(Color[c].size());
+      ThreadCount = max(ThreadCount, 1);
+      for (INT it = 0; it < Iterations; it++)
+      {
+        std::atomic_int Row = 0;
+        FLT sc = SigmaColor * SigmaColor / (FLT)(1 << it);
+
+        Pool.Run(ThreadCount,
+          [&]( INT )
+          {
+            for (INT y = Row++; y < H; y = Row++)
+              FilterRow(Color, tmp, y, 1 << it, 1 / sc);
+          });
+        for (INT c = 0; c < 3; c++)
+          Color[c].swap(tmp[c]);
+      }
+    } /* End of 'Denoise' function */
+
+    /* Store color buffer to frame function.
+     * ARGUMENTS:
+     *   - frame to write (should be same size):
+     *       frame &Frm;
+     * RETURNS: None.
+     */
+    VOID ToFrame( frame &Frm ) const
+    {
+      std::vector<DWORD> Row(W);
+
+      for (INT y = 0; y < H; y++)
+      {
+        size_t i = (size_t)y * W;
+
+        for (INT x = 0; x < W; x++)
+          Row[x] = frame::ToRGB(Color[0][i + x], Color[1][i + x], Color[2][i + x]);
+        Frm.PutSpan(0, y, W, Row.data());
+      }
+    } /* End of 'ToFrame' function */
+
+  private:
+    /* Four values exponent (for X <= 0) function.
+     * ARGUMENTS:
+     *   - values:
+     *       __m128 X;
+     * RETURNS:
+     *   (__m128) exp(X), about 1e-7 relative error.
+     */
+    static __m128 Exp4( __m128 X )
+    {
+      // exp(x) = 2 ^ (i + f), 2 ^ f by 5th order polynomial
+      __m128
+        t = _mm_mul_ps(_mm_max_ps(X, _mm_set1_ps(-87.f)), _mm_set1_ps(1.44269504f)),
+        i = _mm_cvtepi32_ps(_mm_cvttps_epi32(t));
+
+      i = _mm_sub_ps(i, _mm_and_ps(_mm_cmpgt_ps(i, t), _mm_set1_ps(1)));
+      __m128
+        f = _mm_sub_ps(t, i),
+        p = _mm_set1_ps(1.3333558e-3f);
+
+      p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(9.6181291e-3f));
+      p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(5.5504109e-2f));
+      p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(2.4022651e-1f));
+      p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(6.9314718e-1f));
+      p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1));
+      __m128i e = _mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(i), _mm_set1_epi32(127)), 23);
+      return _mm_mul_ps(p, _mm_castsi128_ps(e));
+    } /* End of 'Exp4' function */
+
+    /* Load four row values with border clamping function.
+     * ARGUMENTS:
+     *   - row values:
+     *       const FLT *Row;
+     *   - first value index (any):
+     *       INT X;
+     * RETURNS:
+     *   (__m128) values.
+     */
+    __m128 Load4( const FLT *Row, INT X ) const
+    {
+      if (X >= 0 && X + 3 < W)
+        return _mm_loadu_ps(Row + X);
+      auto cl =
+        [this]( INT I )
+        {
+          return I < 0 ? 0 : I >= W ? W - 1 : I;
+        };
+      return _mm_set_ps(Row[cl(X + 3)], Row[cl(X + 2)], Row[cl(X + 1)], Row[cl(X)]);
+    } /* End of 'Load4' function */
+
+    /* Filter one row function.
+     * ARGUMENTS:
+     *   - source and destination color planes:
+     *       const std::vector<FLT> *In;
+     *       std::vector<FLT> *Out;
+     *   - row number:
+     *       INT Y;
+     *   - taps step:
+     *       INT Step;
+     *   - inverse color sigma square:
+     *       FLT InvSc;
+     * RETURNS: None.
+     */
+    VOID FilterRow( const std::vector<FLT> *In, std::vector<FLT> *Out, INT Y, INT Step, FLT InvSc ) const
+    {
+      static const FLT Kernel[5] = {1.f / 16, 1.f / 4, 3.f / 8, 1.f / 4, 1.f / 16};
+      const __m128
+        inv_c = _mm_set1_ps(InvSc),
+        inv_n = _mm_set1_ps(1 / (SigmaNormal * SigmaNormal)),
+        inv_a = _mm_set1_ps(1 / (SigmaAlbedo * SigmaAlbedo)),
+        inv_z = _mm_set1_ps(1 / (SigmaDepth * Step)),
+        abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+      size_t row = (size_t)Y * W;
+      auto sq =
+        []( __m128 A, __m128 B )
+        {
+          __m128 d = _mm_sub_ps(A, B);
+          return _mm_mul_ps(d, d);
+        };
+
+      for (INT x = 0; x < W; x += 4)
+      {
+        __m128 cp[3], ap[3], np[3], zp, sum[3], wsum = _mm_setzero_ps();
+
+        for (INT c = 0; c < 3; c++)
+        {
+          cp[c] = Load4(In[c].data() + row, x);
+          ap[c] = Load4(Albedo[c].data() + row, x);
+          np[c] = Load4(Normal[c].data() + row, x);
+          sum[c] = _mm_setzero_ps();
+        }
+        zp = Load4(Depth.data() + row, x);
+        __m128 inv_zp = _mm_div_ps(inv_z, _mm_max_ps(zp, _mm_set1_ps(1e-3f)));
+
+        for (INT j = 0; j < 5; j++)
+        {
+          INT y = Y + (j - 2) * Step;
+          size_t qrow = (size_t)(y < 0 ? 0 : y >= H ? H - 1 : y) * W;
+
+          for (INT i = 0; i < 5; i++)
+          {
+            INT qx = x + (i - 2) * Step;
+            __m128 cq[3], d, dc = _mm_setzero_ps(), dn = _mm_setzero_ps(), da = _mm_setzero_ps();
+
+            for (INT c = 0; c < 3; c++)
+            {
+              cq[c] = Load4(In[c].data() + qrow, qx);
+              dc = _mm_add_ps(dc, sq(cp[c], cq[c]));
+              dn = _mm_add_ps(dn, sq(np[c], Load4(Normal[c].data() + qrow, qx)));
+              da = _mm_add_ps(da, sq(ap[c], Load4(Albedo[c].data() + qrow, qx)));
+            }
+            __m128 dz = _mm_and_ps(_mm_sub_ps(zp, Load4(Depth.data() + qrow, qx)), abs_mask);
+
+            d = _mm_add_ps(_mm_mul_ps(dc, inv_c), _mm_mul_ps(dn, inv_n));
+            d = _mm_add_ps(d, _mm_mul_ps(da, inv_a));
+            d = _mm_add_ps(d, _mm_mul_ps(dz, inv_zp));
+            __m128 w = _mm_mul_ps(Exp4(_mm_sub_ps(_mm_setzero_ps(), d)), _mm_set1_ps(Kernel[i] * Kernel[j]));
+
+            wsum = _mm_add_ps(wsum, w);
+            for (INT c = 0; c < 3; c++)
+              sum[c] = _mm_add_ps(sum[c], _mm_mul_ps(w, cq[c]));
+          }
+        }
+
+        // Center tap has weight 'Kernel[2] ^ 2' at least, so no zero division
+        for (INT c = 0; c < 3; c++)
+        {
+          __m128 r = _mm_div_ps(sum[c], wsum);
+
+          if (x + 3 < W)
+            _mm_storeu_ps(Out[c].data() + row + x, r);
+          else
+          {
+            alignas(16) FLT v[4];
+
+            _mm_store_ps(v, r);
+            for (INT k = 0; k < 4 && x + k < W; k++)
+              Out[c][row + x + k] = v[k];
+          }
+        }
+      }
+    } /* End of 'FilterRow' function */
+  }; /* End of 'gbuffer' class */
+} /* end of 'gort' namespace */
+
+#endif /* __denoise_h_ */
+
+/* END OF 'denoise.h' FILE */
@@ -69,6 +69,16 @@ namespace gort
       }
     } /* End of Resize' function */
 
+    /* Obtain buffer memory function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (size_t) pixels memory in bytes.
+     */
+    size_t Memory( VOID ) const
+    {
+      return (size_t)W * H * sizeof(DWORD);
+    } /* End of 'Memory' function */
+
     /* Put pixel with specified color function.
      * ARGUMENTS:
      *   - pixel coordinates:
@@ -90,6 +100,47 @@ namespace gort
       Pixels[Y * W + X] = Color;
     } /* End of 'PutPixel' function */
 
+    /* Put frame row function.
+     * ARGUMENTS:
+     *   - row number:
+     *       INT Y;
+     *   - row pixel colors ('W' values):
+     *       const DWORD *Row;
+     * RETURNS: None.
+     */
+    VOID PutRow( INT Y, const DWORD *Row )
+    {
+      PutSpan(0, Y, W, Row);
+    } /* End of 'PutRow' function */
+
+    /* Put frame row part function.
+     * ARGUMENTS:
+     *   - first pixel coordinates:
+     *       INT X, Y;
+     *   - pixels count:
+     *       INT Count;
+     *   - pixel colors ('Count' values):
+     *       const DWORD *Span;
+     * RETURNS: None.
+     */
+    VOID PutSpan( INT X, INT Y, INT Count, const DWORD *Span )
+    {
+      // Lock access
+      const std::lock_guard<std::recursive_mutex> lock(frame_mutex);
+
+      // Clipping
+      if (Y < 0 || Y >= H)
+        return;
+      if (X < 0)
+        Span -= X, Count += X, X = 0;
+      if (X + Count > W)
+        Count = W - X;
+      if (Count <= 0)
+        return;
+
+      memcpy(Pixels + Y * W + X, Span, Count * sizeof(DWORD));
+    } /* End of 'PutSpan' function */
+
     /* Get pixel color function.
      * ARGUMENTS:
      *   - pixel coordinates:
@@ -110,6 +161,25 @@ namespace gort
       return Pixels[Y * W + X];
     } /* End of 'PutPixel' function */
 
+    /* Copy frame pixels function.
+     * ARGUMENTS:
+     *   - destination ('W' values per row):
+     *       DWORD *Dst;
+     *   - rows range (Y1 is excluded, -1 for frame height):
+     *       INT Y0, Y1;
+     * RETURNS: None.
+     */
+    VOID GetPixels( DWORD *Dst, INT Y0 = 0, INT Y1 = -1 )
+    {
+      // Lock access
+      const std::lock_guard<std::recursive_mutex> lock(frame_mutex);
+
+      if (Y1 < 0 || Y1 > H)
+        Y1 = H;
+      if (Y0 < Y1)
+        memcpy(Dst, Pixels + Y0 * W, (Y1 - Y0) * W * sizeof(DWORD));
+    } /* End of 'GetPixels' function */
+
     /* Fill frame with specified color function.
      * ARGUMENTS:
      *   - pixels color:
@@ -263,17 +333,12 @@ namespace gort
       return TRUE;
     } /* End of 'SaveTGA' function */
 
-    /* Auto naming store frame buffer image to TGA file function.
-     * ARGUMENTS:
-     *   - addition comments:
-     *       const std::string &Comments;
-     *   - render/job time (hours, minutes, seconds):
-     *       const std::tuple<INT, INT, INT> &JobTime;
+    /* Obtain unique auto save file name (without extension) function.
+     * ARGUMENTS: None.
      * RETURNS:
-     *   (BOOL) TRUE if success, FALSE otherwise.
+     *   (std::string) file path without extension.
      */
-    BOOL AutoSaveTGA( const std::string &Comments = "",
-                      const std::tuple<INT, INT, INT> &JobTime = {0, 0, 0} )
+    static std::string AutoSaveName( VOID )
     {
       SYSTEMTIME st;
 
@@ -287,7 +352,22 @@ namespace gort
         st.wYear, st.wMonth, st.wDay, st.wHour,
         st.wMinute, st.wSecond, st.wMilliseconds,
         rand() % 90);
-      return SaveTGA(path + "/" + Buf + ".tga", Comments, JobTime);
+      return path + "/" + Buf;
+    } /* End of 'AutoSaveName' function */
+
+    /* Auto naming store frame buffer image to TGA file function.
+     * ARGUMENTS:
+     *   - addition comments:
+     *       const std::string &Comments;
+     *   - render/job time (hours, minutes, seconds):
+     *       const std::tuple<INT, INT, INT> &JobTime;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise.
+     */
+    BOOL AutoSaveTGA( const std::string &Comments = "",
+                      const std::tuple<INT, INT, INT> &JobTime = {0, 0, 0} )
+    {
+      return SaveTGA(AutoSaveName() + ".tga", Comments, JobTime);
     } /* End of 'AutoSaveTGA' function */
   }; /* End of 'frame' class */
 } /* end of 'virt' namespace */
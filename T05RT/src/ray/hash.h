@@ -0,0 +1,145 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : hash.h
+ * PURPOSE     : Raytracing project.
+ *               Content hash module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : 64 bit words are mixed by multiply-rotate steps,
+ *               value is finalized by 'splitmix64' avalanche. Data is
+ *               hashed as raw bytes, so records with padding bytes
+ *               should be added by fields.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#ifndef __hash_h_
+#define __hash_h_
+
+#include <bit>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "def.h"
+
+/* Project namespace */
+namespace gort
+{
+  /* Content hash accumulator class */
+  class hasher
+  {
+    UINT64 Acc = 0x9E3779B97F4A7C15; // Accumulated state
+
+    /* Mix one word function.
+     * ARGUMENTS:
+     *   - word to mix:
+     *       UINT64 W;
+     * RETURNS: None.
+     */
+    VOID Mix( UINT64 W )
+    {
+      Acc = std::rotl(Acc ^ (W * 0x87C37B91114253D5), 31) * 0x4CF5AD432745937F;
+    } /* End of 'Mix' function */
+
+  public:
+    /* Add raw bytes function.
+     * ARGUMENTS:
+     *   - data and its size in bytes:
+     *       const VOID *Data;
+     *       size_t Size;
+     * RETURNS:
+     *   (hasher &) this hasher.
+     */
+    hasher & Add( const VOID *Data, size_t Size )
+    {
+      const BYTE *p = (const BYTE *)Data;
+      UINT64 w;
+
+      for (; Size >= 8; Size -= 8, p += 8)
+        memcpy(&w, p, 8), Mix(w);
+      if (Size > 0)
+      {
+        w = 0;
+        memcpy(&w, p, Size);
+        Mix(w ^ (UINT64)Size << 56);
+      }
+      return *this;
+    } /* End of 'Add' function */
+
+    /* Add value function.
+     * ARGUMENTS:
+     *   - value without padding bytes:
+     *       const Type &X;
+     * RETURNS:
+     *   (hasher &) this hasher.
+     */
+    template<typename Type>
+      hasher & operator<<( const Type &X )
+      {
+        return Add(&X, sizeof(Type));
+      } /* End of 'operator<<' function */
+
+    /* Add array function (size is hashed too).
+     * ARGUMENTS:
+     *   - array of records without padding bytes:
+     *       const std::vector<Type> &Arr;
+     * RETURNS:
+     *   (hasher &) this hasher.
+     */
+    template<typename Type>
+      hasher & operator<<( const std::vector<Type> &Arr )
+      {
+        Mix(Arr.size());
+        return Add(Arr.data(), Arr.size() * sizeof(Type));
+      } /* End of 'operator<<' function */
+
+    /* Add stock function (size is hashed too).
+     * ARGUMENTS:
+     *   - stock of records without padding bytes:
+     *       const stock<Type> &Arr;
+     * RETURNS:
+     *   (hasher &) this hasher.
+     */
+    template<typename Type>
+      hasher & operator<<( const stock<Type> &Arr )
+      {
+        return *this << (const std::vector<Type> &)Arr;
+      } /* End of 'operator<<' function */
+
+    /* Add string function.
+     * ARGUMENTS:
+     *   - string:
+     *       const std::string &Str;
+     * RETURNS:
+     *   (hasher &) this hasher.
+     */
+    hasher & operator<<( const std::string &Str )
+    {
+      Mix(Str.size());
+      return Add(Str.data(), Str.size());
+    } /* End of 'operator<<' function */
+
+    /* Obtain hash value function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (UINT64) finalized hash.
+     */
+    UINT64 Value( VOID ) const
+    {
+      UINT64 z = Acc;
+
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+      return z ^ (z >> 31);
+    } /* End of 'Value' function */
+  }; /* End of 'hasher' class */
+} /* end of 'gort' namespace */
+
+#endif /* __hash_h_ */
+
+/* END OF 'hash.h' FILE */
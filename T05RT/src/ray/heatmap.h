@@ -0,0 +1,198 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : heatmap.h
+ * PURPOSE     : Raytracing project.
+ *               Per-pixel render cost heatmap module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : All three metrics are recorded, 'Metric' selects one
+ *               for false color image (raw file keeps all).
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#ifndef __heatmap_h_
+#define __heatmap_h_
+
+#include <vector>
+#include <algorithm>
+#include "frame.h"
+
+/* Project namespace */
+namespace gort
+{
+  /* Per-pixel render cost store class */
+  class heatmap
+  {
+  public:
+    /* Heatmap color metric */
+    enum METRIC
+    {
+      Time,  // Nanoseconds per pixel
+      Tests, // Shape intersection tests per pixel
+      Rays,  // Traced rays per pixel
+    } Metric = Time;
+
+    // Cost buffer size
+    INT W = 0, H = 0;
+
+  private:
+    // Per-pixel cost values (3 values per pixel: ns, tests, rays)
+    std::vector<FLT> Cost;
+
+    // False color image
+    frame Img;
+
+  public:
+    /* Resize cost buffer function.
+     * ARGUMENTS:
+     *   - new buffer size:
+     *       INT NewW, NewH;
+     * RETURNS: None.
+     */
+    VOID Resize( INT NewW, INT NewH )
+    {
+      W = NewW;
+      H = NewH;
+      Cost.assign((size_t)W * H * 3, 0);
+    } /* End of 'Resize' function */
+
+    /* Obtain buffer memory function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (size_t) cost values and false color image memory in bytes.
+     */
+    size_t Memory( VOID ) const
+    {
+      return Cost.capacity() * sizeof(FLT) + Img.Memory();
+    } /* End of 'Memory' function */
+
+    /* Store pixel cost function.
+     * ARGUMENTS:
+     *   - pixel coordinates:
+     *       INT X, Y;
+     *   - pixel trace time in nanoseconds:
+     *       DBL Ns;
+     *   - pixel cost counters:
+     *       const cost &C;
+     * RETURNS: None.
+     */
+    VOID Put( INT X, INT Y, DBL Ns, const cost &C )
+    {
+      // Clipping
+      if (X < 0 || Y < 0 || X >= W || Y >= H)
+        return;
+
+      FLT *ptr = &Cost[((size_t)Y * W + X) * 3];
+      ptr[0] = (FLT)Ns;
+      ptr[1] = (FLT)C.Tests;
+      ptr[2] = (FLT)C.Rays;
+    } /* End of 'Put' function */
+
+    /* Convert 0..1 value to false color function.
+     * ARGUMENTS:
+     *   - normalized value:
+     *       DBL V;
+     * RETURNS:
+     *   (DWORD) result packed color (blue -> cyan -> green -> yellow -> red).
+     */
+    static DWORD ToColor( DBL V )
+    {
+      static const vec3 Ramp[] =
+      {
+        vec3(0, 0, 0.5), vec3(0, 0.5, 1), vec3(0, 1, 0.5),
+        vec3(1, 1, 0), vec3(1, 0.4, 0), vec3(1, 0, 0)
+      };
+      const INT n = sizeof(Ramp) / sizeof(Ramp[0]) - 1;
+
+      V = V < 0 ? 0 : V > 1 ? 1 : V;
+      INT i = (INT)(V * n);
+      if (i >= n)
+        i = n - 1;
+      DBL t = V * n - i;
+      vec3 c = Ramp[i] * (1 - t) + Ramp[i + 1] * t;
+      return frame::ToRGB(c[0], c[1], c[2]);
+    } /* End of 'ToColor' function */
+
+    /* Store false color heatmap to TGA file function.
+     * ARGUMENTS:
+     *   - file name:
+     *       const std::string &FileName;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise.
+     */
+    BOOL SaveTGA( const std::string &FileName )
+    {
+      if (W == 0 || H == 0)
+        return FALSE;
+
+      // Normalize by 99.5 percentile in log scale to hide single outliers
+      std::vector<FLT> vals((size_t)W * H);
+      for (size_t i = 0; i < vals.size(); i++)
+        vals[i] = Cost[i * 3 + Metric];
+      std::vector<FLT> sorted(vals);
+      size_t k = (size_t)(sorted.size() * 0.995);
+      if (k >= sorted.size())
+        k = sorted.size() - 1;
+      std::nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+      DBL norm = log(1.0 + sorted[k]);
+      if (norm <= 0)
+        norm = 1;
+
+      Img.Resize(W, H);
+      for (INT y = 0; y < H; y++)
+        for (INT x = 0; x < W; x++)
+          Img.PutPixel(x, y, ToColor(log(1.0 + vals[(size_t)y * W + x]) / norm));
+      static const CHAR *Names[] = {"ns", "tests", "rays"};
+      return Img.SaveTGA(FileName, std::string("Cost heatmap: ") + Names[Metric]);
+    } /* End of 'SaveTGA' function */
+
+    /* Store raw cost buffer function.
+     * File layout: "GCST" signature, DWORD width, height, channels (3),
+     * then W * H * 3 floats (ns, tests, rays) row by row from top.
+     * ARGUMENTS:
+     *   - file name:
+     *       const std::string &FileName;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise.
+     */
+    BOOL SaveRaw( const std::string &FileName )
+    {
+      std::fstream f(FileName, std::fstream::out | std::fstream::binary);
+      if (!f.is_open())
+        return FALSE;
+
+      DWORD head[4] = {*(DWORD *)"GCST", (DWORD)W, (DWORD)H, 3};
+      f.write((CHAR *)head, sizeof(head));
+      f.write((CHAR *)Cost.data(), Cost.size() * sizeof(FLT));
+      return TRUE;
+    } /* End of 'SaveRaw' function */
+
+    /* Store heatmap and raw buffer beside rendered image function.
+     * ARGUMENTS:
+     *   - image file name without extension:
+     *       const std::string &Name;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise.
+     */
+    BOOL Save( const std::string &Name )
+    {
+      DBL sum[3] {}, mx[3] {};
+      for (size_t i = 0; i < Cost.size(); i++)
+        sum[i % 3] += Cost[i], mx[i % 3] = max(mx[i % 3], (DBL)Cost[i]);
+      std::cout << "Cost: " << sum[0] / 1e9 << " s traced, " <<
+        (UINT64)sum[1] << " tests, " << (UINT64)sum[2] << " rays; " <<
+        "pixel max: " << mx[0] << " ns, " << mx[1] << " tests, " << mx[2] << " rays" << std::endl;
+      return SaveTGA(Name + "_cost.tga") && SaveRaw(Name + "_cost.raw");
+    } /* End of 'Save' function */
+  }; /* End of 'heatmap' class */
+} /* end of 'gort' namespace */
+
+#endif /* __heatmap_h_ */
+
+/* END OF 'heatmap.h' FILE */
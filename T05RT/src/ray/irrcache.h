@@ -0,0 +1,293 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : irrcache.h
+ * PURPOSE     : Raytracing project.
+ *               Indirect irradiance cache module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : Records are interpolated by Ward weight
+ *               w = 1 / (|P - Pi| / Ri + sqrt(1 - N * Ni)),
+ *               record is used if w > 1 / Error, so it is valid in
+ *               sphere of 'Error * Ri' radius ('Ri' is harmonic mean
+ *               distance of record hemisphere rays).
+ *               Record is linked to all octree nodes its validity box
+ *               overlaps at level where node is smaller than the box,
+ *               so lookup checks nodes on point path only. Nodes and
+ *               lists are only appended by atomic operations, lookups
+ *               never wait; records are freed by 'Clear' only (not
+ *               during render).
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#ifndef __irrcache_h_
+#define __irrcache_h_
+
+#include <atomic>
+#include "def.h"
+
+/* Project namespace */
+namespace gort
+{
+  /* Irradiance cache class */
+  class irr_cache
+  {
+  public:
+    static const INT MaxDepth = 16; // Octree maximal depth
+
+    // Cache parameters
+    DBL
+      Error = 0.3,     // Interpolation error bound
+      MinR = 0.05,     // Record minimal harmonic mean distance
+      MaxR = 4,        // Record maximal harmonic mean distance
+      Extent = 1024;   // Octree root half size (around origin)
+    INT Rays = 128;    // Record hemisphere rays count
+
+  private:
+    /* Cache record */
+    struct record
+    {
+      vec3 P, N, E; // Position, normal and irradiance
+      DBL R;        // Harmonic mean distance
+      record *All;  // Next record in all records list
+    }; /* End of 'record' structure */
+
+    /* Node records list entry */
+    struct entry
+    {
+      const record *Rec; // Linked record
+      entry *Next;       // Next entry
+    }; /* End of 'entry' structure */
+
+    /* Octree node */
+    struct node
+    {
+      std::atomic<node *> Child[8] {}; // Children (octant bit 'k' is coordinate 'k' above center)
+      std::atomic<entry *> Head {};    // Records entries list
+    }; /* End of 'node' structure */
+
+    node Root;                                // Octree root (cube of 'Extent' half size at origin)
+    std::atomic<record *> Records {nullptr};  // All records list
+    std::atomic_int Count {0};                // Records count
+    std::atomic<size_t> Bytes {0};            // Allocated memory
+
+    /* Push item to atomic list function.
+     * ARGUMENTS:
+     *   - list head:
+     *       std::atomic<Type *> &Head;
+     *   - item to push:
+     *       Type *Item;
+     *   - item next field:
+     *       Type *Type::*Next;
+     * RETURNS: None.
+     */
+    template<typename Type>
+      static VOID Push( std::atomic<Type *> &Head, Type *Item, Type *Type::*Next )
+      {
+        Item->*Next = Head.load();
+        while (!Head.compare_exchange_weak(Item->*Next, Item))
+          ;
+      } /* End of 'Push' function */
+
+    /* Link record to overlapped nodes function.
+     * ARGUMENTS:
+     *   - node and its center, half size and depth:
+     *       node *Node;
+     *       const vec3 &C;
+     *       DBL Half;
+     *       INT Depth;
+     *   - record and its validity radius:
+     *       const record *Rec;
+     *       DBL R;
+     * RETURNS: None.
+     */
+    VOID Link( node *Node, const vec3 &C, DBL Half, INT Depth, const record *Rec, DBL R )
+    {
+      if (Depth == MaxDepth || Half < R)
+      {
+        entry *e = new entry {Rec, nullptr};
+
+        Bytes += sizeof(entry);
+        Push(Node->Head, e, &entry::Next);
+        return;
+      }
+      for (INT i = 0; i < 8; i++)
+      {
+        vec3 c = C;
+        BOOL is_overlap = TRUE;
+
+        for (INT k = 0; k < 3; k++)
+        {
+          c[k] += (i >> k & 1) ? Half / 2 : -Half / 2;
+          is_overlap &= fabs(Rec->P[k] - c[k]) < Half / 2 + R;
+        }
+        if (!is_overlap)
+          continue;
+
+        node *ch = Node->Child[i].load();
+        if (ch == nullptr)
+        {
+          node *n = new node;
+
+          // Other thread could create child meanwhile
+          if (Node->Child[i].compare_exchange_strong(ch, n))
+            ch = n, Bytes += sizeof(node);
+          else
+            delete n;
+        }
+        Link(ch, c, Half / 2, Depth + 1, Rec, R);
+      }
+    } /* End of 'Link' function */
+
+    /* Delete node subtree function.
+     * ARGUMENTS:
+     *   - node:
+     *       node *Node;
+     * RETURNS: None.
+     */
+    static VOID Free( node *Node )
+    {
+      for (entry *e = Node->Head.exchange(nullptr), *n; e != nullptr; e = n)
+        n = e->Next, delete e;
+      for (auto &c : Node->Child)
+        if (node *ch = c.exchange(nullptr); ch != nullptr)
+        {
+          Free(ch);
+          delete ch;
+        }
+    } /* End of 'Free' function */
+
+  public:
+    /* Class destructor */
+    ~irr_cache( VOID )
+    {
+      Clear();
+    } /* End of '~irr_cache' function */
+
+    /* Remove all records function (no lookups should be active).
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID Clear( VOID )
+    {
+      Free(&Root);
+      for (record *r = Records.exchange(nullptr), *n; r != nullptr; r = n)
+        n = r->All, delete r;
+      Count = 0;
+      Bytes = 0;
+    } /* End of 'Clear' function */
+
+    /* Obtain records count function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (INT) records count.
+     */
+    INT Size( VOID ) const
+    {
+      return Count;
+    } /* End of 'Size' function */
+
+    /* Obtain cache memory function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (size_t) records, entries and nodes memory in bytes.
+     */
+    size_t Memory( VOID ) const
+    {
+      return Bytes;
+    } /* End of 'Memory' function */
+
+    /* Add record function.
+     * ARGUMENTS:
+     *   - record position and normal:
+     *       const vec3 &P, &N;
+     *   - record irradiance:
+     *       const vec3 &E;
+     *   - hemisphere rays harmonic mean distance:
+     *       DBL R;
+     * RETURNS: None.
+     */
+    VOID Insert( const vec3 &P, const vec3 &N, const vec3 &E, DBL R )
+    {
+      record *rec = new record {P, N, E, min(max(R, MinR), MaxR), nullptr};
+      BOOL is_inside = TRUE;
+
+      Bytes += sizeof(record);
+      for (INT k = 0; k < 3; k++)
+        is_inside &= fabs(P[k]) < Extent;
+      // Records out of octree stay in root
+      if (is_inside)
+        Link(&Root, vec3(0), Extent, 0, rec, rec->R * Error);
+      else
+      {
+        entry *e = new entry {rec, nullptr};
+
+        Bytes += sizeof(entry);
+        Push(Root.Head, e, &entry::Next);
+      }
+      Push(Records, rec, &record::All);
+      Count++;
+    } /* End of 'Insert' function */
+
+    /* Interpolate irradiance function.
+     * ARGUMENTS:
+     *   - point position and normal:
+     *       const vec3 &P, &N;
+     *   - result irradiance:
+     *       vec3 *E;
+     * RETURNS:
+     *   (BOOL) TRUE if point is covered by records, FALSE otherwise.
+     */
+    BOOL Lookup( const vec3 &P, const vec3 &N, vec3 *E ) const
+    {
+      const node *n = &Root;
+      vec3 c(0), sum(0);
+      DBL half = Extent, wsum = 0;
+
+      for (INT depth = 0; n != nullptr; depth++)
+      {
+        for (const entry *e = n->Head.load(); e != nullptr; e = e->Next)
+        {
+          const record &r = *e->Rec;
+          vec3 d = P - r.P;
+          DBL dist = !d, cn = N & r.N;
+
+          // Record in front of point is skipped
+          if (dist > r.R * Error || cn <= 0 || (d & (N + r.N)) < -0.02 * r.R)
+            continue;
+          if (DBL w = 1 / (dist / r.R + sqrt(max(0.0, 1 - cn)) + 1e-6); w > 1 / Error)
+            sum += r.E * w, wsum += w;
+        }
+        if (depth == MaxDepth)
+          break;
+
+        INT i = 0;
+        for (INT k = 0; k < 3; k++)
+          if (fabs(P[k] - c[k]) > half)
+            i = -1;
+        if (i < 0)
+          break;
+        for (INT k = 0; k < 3; k++)
+          if (P[k] > c[k])
+            i |= 1 << k, c[k] += half / 2;
+          else
+            c[k] -= half / 2;
+        half /= 2;
+        n = n->Child[i].load();
+      }
+      if (wsum <= 0)
+        return FALSE;
+      *E = sum / wsum;
+      return TRUE;
+    } /* End of 'Lookup' function */
+  }; /* End of 'irr_cache' class */
+} /* end of 'gort' namespace */
+
+#endif /* __irrcache_h_ */
+
+/* END OF 'irrcache.h' FILE */
@@ -0,0 +1,629 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : job.h
+ * PURPOSE     : Raytracing project.
+ *               Resumable animation render job module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : Manifest file layout: 'job_header', then 'job_frame'
+ *               record per frame. Manifest is changed under whole file
+ *               exclusive lock only, so render processes on one machine
+ *               share it. Frame is claimed by process id and process
+ *               creation time; frames claimed by dead processes are
+ *               claimed again. Finished rows strips are stored to
+ *               '<frame file>.part' before 'RowsDone' is changed, so
+ *               resumed frame renders rest rows only. Each render
+ *               process writes frames sequence part named by process
+ *               id and creation time, last process finishing the job
+ *               merges parts to one '<manifest>.gseq' sequence.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#ifndef __job_h_
+#define __job_h_
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include "frame.h"
+
+/* Project namespace */
+namespace gort
+{
+  /* Render job manifest header */
+  struct job_header
+  {
+    DWORD Sign;                // "GJOB"
+    DWORD Version;             // Format version
+    CHAR Scene[260];           // Scene snapshot file (empty for default scene)
+    CHAR Output[260];          // Frame file name pattern (one '%d' is replaced by frame number)
+    INT FirstFrame, LastFrame; // Frames range (last is included)
+    INT W, H;                  // Frame size
+    INT FramesPerSecond;       // Frame time step is 1 / 'FramesPerSecond'
+    INT StripH;                // Checkpointed rows strip height
+  }; /* End of 'job_header' structure */
+
+  /* Render job frame record */
+  struct job_frame
+  {
+    DWORD State;       // Frame state (see 'render_job::STATE')
+    DWORD Owner;       // Claiming process id
+    UINT64 OwnerStart; // Claiming process creation time (process id reuse guard)
+    INT RowsDone;      // Rows stored to partial file
+    INT Pad;           // Padding
+  }; /* End of 'job_frame' structure */
+
+  /* Render job manifest class */
+  class render_job
+  {
+  public:
+    // Current format version
+    static const DWORD Version = 1;
+
+    /* Frame states */
+    enum STATE
+    {
+      Todo, Claimed, Done
+    };
+
+  private:
+    HANDLE hFile = INVALID_HANDLE_VALUE; // Manifest file
+    job_header Head {};                  // Manifest header
+    std::string Name;                    // Manifest file name
+
+    /* Manifest exclusive lock class */
+    class lock
+    {
+      HANDLE hFile;    // Locked file
+      OVERLAPPED Ov {}; // Lock range start
+
+    public:
+      /* Class constructor (waits for lock).
+       * ARGUMENTS:
+       *   - file to lock:
+       *       HANDLE hF;
+       */
+      lock( HANDLE hF ) : hFile(hF)
+      {
+        LockFileEx(hFile, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &Ov);
+      } /* End of 'lock' function */
+
+      /* Class destructor */
+      ~lock( VOID )
+      {
+        UnlockFileEx(hFile, 0, MAXDWORD, MAXDWORD, &Ov);
+      } /* End of '~lock' function */
+    }; /* End of 'lock' class */
+
+    /* Read or write manifest data function.
+     * ARGUMENTS:
+     *   - write flag:
+     *       BOOL IsWrite;
+     *   - file offset:
+     *       UINT64 Offset;
+     *   - data:
+     *       VOID *Data;
+     *       DWORD Size;
+     * RETURNS:
+     *   (BOOL) TRUE if all data is transferred, FALSE otherwise.
+     */
+    BOOL Access( BOOL IsWrite, UINT64 Offset, VOID *Data, DWORD Size )
+    {
+      OVERLAPPED ov {};
+      DWORD done = 0;
+
+      ov.Offset = (DWORD)Offset;
+      ov.OffsetHigh = (DWORD)(Offset >> 32);
+      if (IsWrite)
+        return WriteFile(hFile, Data, Size, &done, &ov) && done == Size;
+      return ReadFile(hFile, Data, Size, &done, &ov) && done == Size;
+    } /* End of 'Access' function */
+
+    /* Frame record file offset function.
+     * ARGUMENTS:
+     *   - frame number:
+     *       INT FrameNo;
+     * RETURNS:
+     *   (UINT64) offset.
+     */
+    UINT64 RecOffset( INT FrameNo ) const
+    {
+      return sizeof(job_header) + (UINT64)(FrameNo - Head.FirstFrame) * sizeof(job_frame);
+    } /* End of 'RecOffset' function */
+
+    /* Obtain process creation time function.
+     * ARGUMENTS:
+     *   - process handle:
+     *       HANDLE hProcess;
+     * RETURNS:
+     *   (UINT64) creation time (0 if unknown).
+     */
+    static UINT64 ProcessStart( HANDLE hProcess )
+    {
+      FILETIME ct, et, kt, ut;
+
+      if (!GetProcessTimes(hProcess, &ct, &et, &kt, &ut))
+        return 0;
+      return (UINT64)ct.dwHighDateTime << 32 | ct.dwLowDateTime;
+    } /* End of 'ProcessStart' function */
+
+    /* Check frame owner process is running function.
+     * ARGUMENTS:
+     *   - owner process id and creation time:
+     *       DWORD Pid;
+     *       UINT64 Start;
+     * RETURNS:
+     *   (BOOL) TRUE if owner runs, FALSE otherwise.
+     */
+    static BOOL IsAlive( DWORD Pid, UINT64 Start )
+    {
+      if (Pid == GetCurrentProcessId())
+        return Start == ProcessStart(GetCurrentProcess());
+
+      HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, Pid);
+      DWORD code = 0;
+
+      if (hProcess == NULL)
+        return FALSE;
+
+      BOOL is_alive = GetExitCodeProcess(hProcess, &code) && code == STILL_ACTIVE && ProcessStart(hProcess) == Start;
+
+      CloseHandle(hProcess);
+      return is_alive;
+    } /* End of 'IsAlive' function */
+
+    /* Count not finished frames function (manifest should be locked).
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (INT) frames count (-1 if error).
+     */
+    INT CountLeft( VOID )
+    {
+      std::vector<job_frame> recs(Count());
+      INT left = 0;
+
+      if (!Access(FALSE, RecOffset(Head.FirstFrame), recs.data(), (DWORD)(recs.size() * sizeof(job_frame))))
+        return -1;
+      for (auto &r : recs)
+        left += r.State != Done;
+      return left;
+    } /* End of 'CountLeft' function */
+
+    /* Check manifest header function.
+     * Header is read from file, so names should be terminated and
+     * output pattern should have exactly one frame number place.
+     * ARGUMENTS:
+     *   - header to check:
+     *       const job_header &H;
+     * RETURNS:
+     *   (BOOL) TRUE if header is valid, FALSE otherwise.
+     */
+    static BOOL IsValid( const job_header &H )
+    {
+      if (H.Sign != *(DWORD *)"GJOB" || H.Version != Version ||
+          memchr(H.Scene, 0, sizeof(H.Scene)) == nullptr || memchr(H.Output, 0, sizeof(H.Output)) == nullptr)
+        return FALSE;
+
+      std::string out = H.Output;
+      size_t pos = out.find("%d");
+
+      return pos != std::string::npos && out.find("%d", pos + 2) == std::string::npos;
+    } /* End of 'IsValid' function */
+
+    /* Write new job header and frame records function (manifest should be locked).
+     * ARGUMENTS:
+     *   - job description:
+     *       const job_header &Desc;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise.
+     */
+    BOOL Init( const job_header &Desc )
+    {
+      job_header h = Desc;
+
+      h.Sign = *(DWORD *)"GJOB";
+      h.Version = Version;
+      h.LastFrame = max(h.LastFrame, h.FirstFrame);
+      h.StripH = max(h.StripH, 1);
+      if (!IsValid(h))
+        return FALSE;
+      Head = h;
+
+      std::vector<job_frame> recs(Count());
+
+      if (!Access(TRUE, 0, &Head, sizeof(Head)) ||
+          !Access(TRUE, RecOffset(Head.FirstFrame), recs.data(), (DWORD)(recs.size() * sizeof(job_frame))))
+        return FALSE;
+      FlushFileBuffers(hFile);
+      return TRUE;
+    } /* End of 'Init' function */
+
+    /* Change owned frame record function.
+     * ARGUMENTS:
+     *   - frame number:
+     *       INT FrameNo;
+     *   - record change (gets record):
+     *       Func Edit;
+     * RETURNS:
+     *   (BOOL) TRUE if record is owned by this process and stored, FALSE otherwise.
+     */
+    template<typename Func>
+      BOOL Change( INT FrameNo, Func Edit )
+      {
+        if (!IsOpen() || FrameNo < Head.FirstFrame || FrameNo > Head.LastFrame)
+          return FALSE;
+
+        lock l(hFile);
+        job_frame rec;
+
+        if (!Access(FALSE, RecOffset(FrameNo), &rec, sizeof(rec)) || rec.State != Claimed ||
+            rec.Owner != GetCurrentProcessId() || rec.OwnerStart != ProcessStart(GetCurrentProcess()))
+          return FALSE;
+        Edit(rec);
+        return Access(TRUE, RecOffset(FrameNo), &rec, sizeof(rec));
+      } /* End of 'Change' function */
+
+  public:
+    /* Class destructor */
+    ~render_job( VOID )
+    {
+      Close();
+    } /* End of '~render_job' function */
+
+    /* Create manifest or open existing one function.
+     * ARGUMENTS:
+     *   - manifest file name:
+     *       const std::string &FileName;
+     *   - job description (ignored if manifest exists, output pattern should have one '%d'):
+     *       const job_header &Desc;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise.
+     */
+    BOOL Create( const std::string &FileName, const job_header &Desc )
+    {
+      Close();
+      hFile = CreateFile(FileName.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+      if (hFile == INVALID_HANDLE_VALUE)
+        return FALSE;
+
+      Name = FileName;
+
+      lock l(hFile);
+
+      // Existing job is resumed
+      if (Access(FALSE, 0, &Head, sizeof(Head)) && IsValid(Head))
+        return TRUE;
+      if (!Init(Desc))
+      {
+        CloseHandle(hFile);
+        hFile = INVALID_HANDLE_VALUE;
+        Head = {};
+        return FALSE;
+      }
+      return TRUE;
+    } /* End of 'Create' function */
+
+    /* Start finished job again function.
+     * All frames are to be rendered again by new description
+     * (frame files and sequence are overwritten).
+     * ARGUMENTS:
+     *   - new job description (output pattern should have one '%d'):
+     *       const job_header &Desc;
+     * RETURNS:
+     *   (BOOL) TRUE if job is restarted, FALSE if it has frames left or error.
+     */
+    BOOL Restart( const job_header &Desc )
+    {
+      if (!IsOpen())
+        return FALSE;
+
+      lock l(hFile);
+
+      return CountLeft() == 0 && Init(Desc);
+    } /* End of 'Restart' function */
+
+    /* Open existing manifest function.
+     * ARGUMENTS:
+     *   - manifest file name:
+     *       const std::string &FileName;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise.
+     */
+    BOOL Open( const std::string &FileName )
+    {
+      Close();
+      hFile = CreateFile(FileName.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+      if (hFile == INVALID_HANDLE_VALUE)
+        return FALSE;
+
+      Name = FileName;
+
+      lock l(hFile);
+
+      if (Access(FALSE, 0, &Head, sizeof(Head)) && IsValid(Head))
+        return TRUE;
+      CloseHandle(hFile);
+      hFile = INVALID_HANDLE_VALUE;
+      Head = {};
+      return FALSE;
+    } /* End of 'Open' function */
+
+    /* Close manifest function (claimed frames stay claimed till process exit).
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID Close( VOID )
+    {
+      if (hFile != INVALID_HANDLE_VALUE)
+        CloseHandle(hFile);
+      hFile = INVALID_HANDLE_VALUE;
+      Head = {};
+      Name.clear();
+    } /* End of 'Close' function */
+
+    /* Check manifest is opened function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (BOOL) TRUE if opened, FALSE otherwise.
+     */
+    BOOL IsOpen( VOID ) const
+    {
+      return hFile != INVALID_HANDLE_VALUE;
+    } /* End of 'IsOpen' function */
+
+    /* Obtain job description function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (const job_header &) manifest header.
+     */
+    const job_header & Header( VOID ) const
+    {
+      return Head;
+    } /* End of 'Header' function */
+
+    /* Obtain job frames count function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (INT) frames count.
+     */
+    INT Count( VOID ) const
+    {
+      return IsOpen() ? Head.LastFrame - Head.FirstFrame + 1 : 0;
+    } /* End of 'Count' function */
+
+    /* Obtain not finished frames count function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (INT) frames count.
+     */
+    INT Left( VOID )
+    {
+      if (!IsOpen())
+        return 0;
+
+      lock l(hFile);
+
+      return max(CountLeft(), 0);
+    } /* End of 'Left' function */
+
+    /* Claim frame to render function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (INT) claimed frame number or -1 if no frames left.
+     */
+    INT Claim( VOID )
+    {
+      if (!IsOpen())
+        return -1;
+
+      lock l(hFile);
+      std::vector<job_frame> recs(Count());
+
+      if (!Access(FALSE, RecOffset(Head.FirstFrame), recs.data(), (DWORD)(recs.size() * sizeof(job_frame))))
+        return -1;
+      for (INT i = 0; i < (INT)recs.size(); i++)
+        if (job_frame &r = recs[i];
+            r.State == Todo || (r.State == Claimed && !IsAlive(r.Owner, r.OwnerStart)))
+        {
+          r.State = Claimed;
+          r.Owner = GetCurrentProcessId();
+          r.OwnerStart = ProcessStart(GetCurrentProcess());
+          if (!Access(TRUE, RecOffset(Head.FirstFrame + i), &r, sizeof(r)))
+            return -1;
+          return Head.FirstFrame + i;
+        }
+      return -1;
+    } /* End of 'Claim' function */
+
+    /* Return claimed frame to job function (stored rows are kept).
+     * ARGUMENTS:
+     *   - frame number:
+     *       INT FrameNo;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise.
+     */
+    BOOL Release( INT FrameNo )
+    {
+      return Change(FrameNo, []( job_frame &R ) { R.State = Todo, R.Owner = 0, R.OwnerStart = 0; });
+    } /* End of 'Release' function */
+
+    /* Mark claimed frame finished function.
+     * ARGUMENTS:
+     *   - frame number:
+     *       INT FrameNo;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise.
+     */
+    BOOL Finish( INT FrameNo )
+    {
+      if (!Change(FrameNo, []( job_frame &R ) { R.State = Done, R.RowsDone = 0; }))
+        return FALSE;
+      std::filesystem::remove(FrameName(FrameNo) + ".part");
+      return TRUE;
+    } /* End of 'Finish' function */
+
+    /* Obtain frame file name function.
+     * ARGUMENTS:
+     *   - frame number:
+     *       INT FrameNo;
+     * RETURNS:
+     *   (std::string) file name by output pattern.
+     */
+    std::string FrameName( INT FrameNo ) const
+    {
+      // Pattern comes from file, so it is not used as format string
+      std::string name = Head.Output;
+      size_t pos = name.find("%d");
+
+      if (pos != std::string::npos)
+        name.replace(pos, 2, std::to_string(FrameNo));
+      return name;
+    } /* End of 'FrameName' function */
+
+    /* Obtain job sequence file name function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (std::string) manifest file name with '.gseq' extension.
+     */
+    std::string SeqName( VOID ) const
+    {
+      return std::filesystem::path(Name).replace_extension(".gseq").string();
+    } /* End of 'SeqName' function */
+
+    /* Obtain this process sequence part file name function.
+     * Name contains process creation time, so resumed job never
+     * overwrites part of dead process with same id.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (std::string) file name.
+     */
+    std::string SeqPartName( VOID ) const
+    {
+      return SeqName() + "." + std::to_string(GetCurrentProcessId()) + "-" +
+        std::to_string(ProcessStart(GetCurrentProcess())) + ".gpart";
+    } /* End of 'SeqPartName' function */
+
+    /* Merge sequence parts of finished job function.
+     * Parts are merged under manifest lock by first process that finds
+     * all frames done and no merge is needed after it.
+     * ARGUMENTS:
+     *   - parts merge (gets source file names and result file name,
+     *     returns merged frames count or -1 if error):
+     *       Func Merge;
+     * RETURNS:
+     *   (INT) merged frames count, 0 if job is not finished or has
+     *   nothing to merge, -1 if error.
+     */
+    template<typename Func>
+      INT MergeSeq( Func Merge )
+      {
+        if (!IsOpen())
+          return 0;
+
+        lock l(hFile);
+        std::filesystem::path name = SeqName();
+        std::string prefix = name.filename().string() + ".";
+        std::vector<std::string> parts;
+        std::error_code ec;
+
+        if (CountLeft() != 0)
+          return 0;
+        for (auto &e : std::filesystem::directory_iterator(name.parent_path().empty() ? "." : name.parent_path(), ec))
+          if (std::string f = e.path().filename().string();
+              f.starts_with(prefix) && e.path().extension() == ".gpart")
+            parts.push_back(e.path().string());
+        if (parts.empty())
+          return 0;
+        // Previously merged frames are kept (parts frames are preferred)
+        if (std::filesystem::exists(name, ec))
+          parts.push_back(name.string());
+
+        INT n = Merge(parts, name.string());
+
+        if (n >= 0)
+          for (auto &p : parts)
+            if (p != name.string())
+              std::filesystem::remove(p, ec);
+        return n;
+      } /* End of 'MergeSeq' function */
+
+    /* Load claimed frame stored rows function.
+     * ARGUMENTS:
+     *   - frame number:
+     *       INT FrameNo;
+     *   - frame to put rows to (of job size):
+     *       frame &Frm;
+     * RETURNS:
+     *   (INT) loaded rows count (first row to render).
+     */
+    INT LoadRows( INT FrameNo, frame &Frm )
+    {
+      job_frame rec {};
+
+      if (!IsOpen() || FrameNo < Head.FirstFrame || FrameNo > Head.LastFrame || Frm.W != Head.W)
+        return 0;
+      {
+        lock l(hFile);
+
+        if (!Access(FALSE, RecOffset(FrameNo), &rec, sizeof(rec)))
+          return 0;
+      }
+
+      std::ifstream f(FrameName(FrameNo) + ".part", std::ifstream::binary);
+      std::vector<DWORD> row(Head.W);
+      INT y = 0;
+
+      for (; y < min(rec.RowsDone, Frm.H); y++)
+      {
+        if (!f.read((CHAR *)row.data(), Head.W * sizeof(DWORD)))
+          break;
+        Frm.PutRow(y, row.data());
+      }
+      return y;
+    } /* End of 'LoadRows' function */
+
+    /* Store claimed frame rendered rows function.
+     * ARGUMENTS:
+     *   - frame number:
+     *       INT FrameNo;
+     *   - frame (of job size):
+     *       frame &Frm;
+     *   - rendered rows range (all rows before Y0 are stored, Y1 is excluded):
+     *       INT Y0, Y1;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise.
+     */
+    BOOL StoreRows( INT FrameNo, frame &Frm, INT Y0, INT Y1 )
+    {
+      std::vector<DWORD> rows((size_t)(Y1 - Y0) * Frm.W);
+      std::fstream f(FrameName(FrameNo) + ".part", std::fstream::in | std::fstream::out | std::fstream::binary);
+
+      if (!f.is_open())
+        f.open(FrameName(FrameNo) + ".part", std::fstream::out | std::fstream::binary);
+      if (!f.is_open() || Frm.W != Head.W)
+        return FALSE;
+      Frm.GetPixels(rows.data(), Y0, Y1);
+      f.seekp((UINT64)Y0 * Frm.W * sizeof(DWORD));
+      f.write((CHAR *)rows.data(), rows.size() * sizeof(DWORD));
+      f.close();
+      if (!f.good())
+        return FALSE;
+      // Rows are counted after they are stored
+      return Change(FrameNo, [Y1]( job_frame &R ) { R.RowsDone = Y1; });
+    } /* End of 'StoreRows' function */
+  }; /* End of 'render_job' class */
+} /* end of 'gort' namespace */
+
+#endif /* __job_h_ */
+
+/* END OF 'job.h' FILE */
@@ -0,0 +1,378 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : area.h
+ * PURPOSE     : Raytracing project.
+ *               Area lights handler module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : Lights are sampled by (U, V) in [0, 1) square,
+ *               strata selection and shadow rays are done by
+ *               scene (see 'rt::scene::AreaShade').
+ *               Path tracing emitted radiance is chosen so that small
+ *               light facing diffuse surface shades it as Whitted one,
+ *               but with inverse square distance falloff.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+#ifndef __area_h_
+#define __area_h_
+#include "../rt_def.h"
+
+/* Main aplication namespace */
+namespace gort
+{
+  /* Lights namespace */
+  namespace lght
+  {
+    /* Rectangle area light class */
+    class rect : public gort::light
+    {
+    public:
+      DBL LPower;      // light power
+      vec3 LP, E1, E2; // light corner and edges
+      vec3 LColor;     // light color
+
+      /* Class constructor.
+       * ARGUMENTS:
+       *   - rectangle corner and edges:
+       *       const vec3 &Corner, &Edge1, &Edge2;
+       *   - light power:
+       *       DBL Power;
+       *   - light color:
+       *       const vec3 &Color;
+       *   - maximal strata per side (penumbra samples count is 'Strata' ^ 2):
+       *       INT MaxStrata;
+       */
+      rect( const vec3 &Corner, const vec3 &Edge1, const vec3 &Edge2, DBL Power = 10,
+            const vec3 &Color = {1, 1, 1}, INT MaxStrata = 4 ) :
+        LPower(Power), LP(Corner), E1(Edge1), E2(Edge2), LColor(Color)
+      {
+        Strata = MaxStrata;
+      } /* End of 'rect' function */
+
+      /* Light sample shading function.
+       * ARGUMENTS:
+       *   - shading point:
+       *       const vec3 &P;
+       *   - sample position on light:
+       *       DBL U, V;
+       *   - light to do shade:
+       *       light_info *L;
+       * RETURN:
+       *   (DBL) Shading coefficient.
+       */
+      DBL Sample( const vec3 &P, DBL U, DBL V, light_info *L ) override
+      {
+        vec3 Q = LP + E1 * U + E2 * V;
+
+        L->L = (Q - P).Normalize();
+        L->Dist = !(Q - P);
+        L->Color = LColor;
+        return LPower / L->Dist;
+      } /* End of 'Sample' function */
+
+      /* Shading pixel function (rectangle center).
+       * ARGUMENTS:
+       *   - possition
+       *       vec3 &P;
+       *   - light to do shade:
+       *       light_info *L;
+       * RETURN:
+       *   (DBL) Shading coefficient.
+       */
+      DBL Shadow( const vec3 &P, light_info *L ) override
+      {
+        return Sample(P, 0.5, 0.5, L);
+      } /* End of 'Shadow' function */
+
+      /* Sample light surface for path tracing function.
+       * ARGUMENTS:
+       *   - shading point:
+       *       const vec3 &From;
+       *   - sample position on light:
+       *       DBL U, V;
+       *   - result sample:
+       *       light_sample *S;
+       * RETURN:
+       *   (BOOL) TRUE.
+       */
+      BOOL SampleSurface( const vec3 &From, DBL U, DBL V, light_sample *S ) override
+      {
+        vec3 n = E1 % E2;
+        DBL area = !n;
+
+        S->P = LP + E1 * U + E2 * V;
+        // Two sided light, normal is faced to shading point
+        S->N = ((From - S->P) & n) < 0 ? -n / area : n / area;
+        S->Le = LColor * (PI * LPower / area);
+        S->PdfA = 1 / area;
+        return TRUE;
+      } /* End of 'SampleSurface' function */
+
+      /* Intersect light surface by ray function.
+       * ARGUMENTS:
+       *   - ray to intersect:
+       *       const ray &R;
+       *   - result hit distance:
+       *       DBL *T;
+       *   - result hit point sample:
+       *       light_sample *S;
+       * RETURN:
+       *   (BOOL) TRUE if light is hit, FALSE otherwise.
+       */
+      BOOL HitSurface( const ray &R, DBL *T, light_sample *S ) override
+      {
+        vec3 n = E1 % E2;
+        DBL dn = R.Dir & n, t;
+
+        if (fabs(dn) < Threshold || (t = ((LP - R.Org) & n) / dn) < Threshold)
+          return FALSE;
+
+        // Parallelogram coordinates of hit point
+        vec3 q = R(t) - LP;
+        DBL
+          a11 = E1 & E1, a12 = E1 & E2, a22 = E2 & E2,
+          b1 = q & E1, b2 = q & E2,
+          det = a11 * a22 - a12 * a12,
+          u = (b1 * a22 - b2 * a12) / det,
+          v = (a11 * b2 - a12 * b1) / det;
+
+        if (u < 0 || u > 1 || v < 0 || v > 1)
+          return FALSE;
+        *T = t;
+        return SampleSurface(R.Org, u, v, S);
+      } /* End of 'HitSurface' function */
+
+      /* Emit photon function.
+       * Both sides emit by cosine law.
+       * ARGUMENTS:
+       *   - emission samples in [0, 1) square (position and direction):
+       *       DBL U1, V1, U2, V2;
+       *   - result photon ray:
+       *       ray *R;
+       *   - result light total flux:
+       *       vec3 *Flux;
+       * RETURN:
+       *   (BOOL) TRUE.
+       */
+      BOOL EmitPhoton( DBL U1, DBL V1, DBL U2, DBL V2, ray *R, vec3 *Flux ) override
+      {
+        vec3 w = (E1 % E2).Normalizing(), u = E1.Normalizing(), v = w % u;
+
+        // First half of samples is emitted by back side
+        if (U2 < 0.5)
+          w = -w, U2 *= 2;
+        else
+          U2 = U2 * 2 - 1;
+
+        DBL r = sqrt(U2), phi = 2 * PI * V2;
+
+        *R = ray(LP + E1 * U1 + E2 * V1, u * (r * cos(phi)) + v * (r * sin(phi)) + w * sqrt(max(0.0, 1 - U2)));
+        *Flux = LColor * (2 * PI * PI * LPower);
+        return TRUE;
+      } /* End of 'EmitPhoton' function */
+
+      /* Hash light parameters function.
+       * ARGUMENTS:
+       *   - hash to add to:
+       *       hasher &H;
+       * RETURN:
+       *   (BOOL) TRUE.
+       */
+      BOOL Hash( hasher &H ) const override
+      {
+        H << "rect" << LP << E1 << E2 << LPower << LColor << Strata;
+        return TRUE;
+      } /* End of 'Hash' function */
+    }; /* End of 'rect' class */
+
+    /* Sphere area light class */
+    class sphere : public gort::light
+    {
+    public:
+      DBL LPower;  // light power
+      vec3 LP;     // light center
+      DBL LR;      // light radius
+      vec3 LColor; // light color
+
+      /* Class constructor.
+       * ARGUMENTS:
+       *   - sphere center and radius:
+       *       const vec3 &Center;
+       *       DBL Radius;
+       *   - light power:
+       *       DBL Power;
+       *   - light color:
+       *       const vec3 &Color;
+       *   - maximal strata per side (penumbra samples count is 'Strata' ^ 2):
+       *       INT MaxStrata;
+       */
+      sphere( const vec3 &Center, DBL Radius, DBL Power = 10,
+              const vec3 &Color = {1, 1, 1}, INT MaxStrata = 4 ) :
+        LPower(Power), LP(Center), LR(Radius), LColor(Color)
+      {
+        Strata = MaxStrata;
+      } /* End of 'sphere' function */
+
+      /* Light sample shading function.
+       * Samples sphere silhouette disk facing shading point.
+       * ARGUMENTS:
+       *   - shading point:
+       *       const vec3 &P;
+       *   - sample position on light:
+       *       DBL U, V;
+       *   - light to do shade:
+       *       light_info *L;
+       * RETURN:
+       *   (DBL) Shading coefficient.
+       */
+      DBL Sample( const vec3 &P, DBL U, DBL V, light_info *L ) override
+      {
+        vec3
+          w = (LP - P).Normalizing(),
+          a = fabs(w[0]) > 0.9 ? vec3(0, 1, 0) : vec3(1, 0, 0),
+          u = (w % a).Normalizing(),
+          v = u % w;
+        DBL
+          r = LR * sqrt(U),
+          phi = 2 * PI * V;
+        vec3 Q = LP + u * (r * cos(phi)) + v * (r * sin(phi));
+
+        L->L = (Q - P).Normalize();
+        L->Dist = !(Q - P);
+        L->Color = LColor;
+        return LPower / L->Dist;
+      } /* End of 'Sample' function */
+
+      /* Shading pixel function (sphere center).
+       * ARGUMENTS:
+       *   - possition
+       *       vec3 &P;
+       *   - light to do shade:
+       *       light_info *L;
+       * RETURN:
+       *   (DBL) Shading coefficient.
+       */
+      DBL Shadow( const vec3 &P, light_info *L ) override
+      {
+        return Sample(P, 0, 0, L);
+      } /* End of 'Shadow' function */
+
+      /* Sample light surface for path tracing function.
+       * Hemisphere facing shading point is sampled uniformly.
+       * ARGUMENTS:
+       *   - shading point:
+       *       const vec3 &From;
+       *   - sample position on light:
+       *       DBL U, V;
+       *   - result sample:
+       *       light_sample *S;
+       * RETURN:
+       *   (BOOL) TRUE.
+       */
+      BOOL SampleSurface( const vec3 &From, DBL U, DBL V, light_sample *S ) override
+      {
+        vec3
+          w = (From - LP).Normalizing(),
+          a = fabs(w[0]) > 0.9 ? vec3(0, 1, 0) : vec3(1, 0, 0),
+          u = (w % a).Normalizing(),
+          v = u % w;
+        DBL
+          z = U,
+          r = sqrt(max(0.0, 1 - z * z)),
+          phi = 2 * PI * V;
+
+        S->N = w * z + u * (r * cos(phi)) + v * (r * sin(phi));
+        S->P = LP + S->N * LR;
+        S->Le = LColor * (LPower / (4 * LR * LR));
+        S->PdfA = 1 / (2 * PI * LR * LR);
+        return TRUE;
+      } /* End of 'SampleSurface' function */
+
+      /* Intersect light surface by ray function.
+       * ARGUMENTS:
+       *   - ray to intersect:
+       *       const ray &R;
+       *   - result hit distance:
+       *       DBL *T;
+       *   - result hit point sample:
+       *       light_sample *S;
+       * RETURN:
+       *   (BOOL) TRUE if light is hit, FALSE otherwise.
+       */
+      BOOL HitSurface( const ray &R, DBL *T, light_sample *S ) override
+      {
+        vec3 a = LP - R.Org;
+        DBL
+          oc2 = a & a,
+          ok = a & R.Dir,
+          h2 = LR * LR - (oc2 - ok * ok),
+          t;
+
+        if (oc2 <= LR * LR || h2 < 0 || (t = ok - sqrt(h2)) < Threshold)
+          return FALSE;
+        *T = t;
+        S->P = R(t);
+        S->N = (S->P - LP) / LR;
+        S->Le = LColor * (LPower / (4 * LR * LR));
+        S->PdfA = 1 / (2 * PI * LR * LR);
+        return TRUE;
+      } /* End of 'HitSurface' function */
+
+      /* Emit photon function.
+       * Surface emits by cosine law.
+       * ARGUMENTS:
+       *   - emission samples in [0, 1) square (position and direction):
+       *       DBL U1, V1, U2, V2;
+       *   - result photon ray:
+       *       ray *R;
+       *   - result light total flux:
+       *       vec3 *Flux;
+       * RETURN:
+       *   (BOOL) TRUE.
+       */
+      BOOL EmitPhoton( DBL U1, DBL V1, DBL U2, DBL V2, ray *R, vec3 *Flux ) override
+      {
+        DBL
+          z = 1 - 2 * U1,
+          s = sqrt(max(0.0, 1 - z * z)),
+          r = sqrt(U2),
+          phi = 2 * PI * V1;
+        vec3
+          w(s * cos(phi), z, s * sin(phi)),
+          a = fabs(w[0]) > 0.9 ? vec3(0, 1, 0) : vec3(1, 0, 0),
+          u = (w % a).Normalizing(),
+          v = u % w;
+
+        phi = 2 * PI * V2;
+        *R = ray(LP + w * (LR * (1 + Threshold)),
+                 u * (r * cos(phi)) + v * (r * sin(phi)) + w * sqrt(max(0.0, 1 - U2)));
+        *Flux = LColor * (PI * PI * LPower);
+        return TRUE;
+      } /* End of 'EmitPhoton' function */
+
+      /* Hash light parameters function.
+       * ARGUMENTS:
+       *   - hash to add to:
+       *       hasher &H;
+       * RETURN:
+       *   (BOOL) TRUE.
+       */
+      BOOL Hash( hasher &H ) const override
+      {
+        H << "sphere" << LP << LR << LPower << LColor << Strata;
+        return TRUE;
+      } /* End of 'Hash' function */
+    }; /* End of 'sphere' class */
+  } /* End of 'lght' namespace */
+} /* End of 'gort' namespace */
+
+
+#endif /* __area_h_ */
+
+/* End of 'area.h' file */
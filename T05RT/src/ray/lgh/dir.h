@@ -53,6 +53,19 @@ namespace gort
         L->Color = LColor;
         return 1;
       } /* End of 'Shadow' function */
+
+      /* Hash light parameters function.
+       * ARGUMENTS:
+       *   - hash to add to:
+       *       hasher &H;
+       * RETURN:
+       *   (BOOL) TRUE.
+       */
+      BOOL Hash( hasher &H ) const override
+      {
+        H << "direction" << Ld << LColor;
+        return TRUE;
+      } /* End of 'Hash' function */
     };
   } /* End of 'light' namespace */
 } /* End of 'gort' namespace */
@@ -18,5 +18,6 @@
 #define __lights_h_
 #include "dir.h"
 #include "point.h"
+#include "area.h"
 
 #endif /* __lights_h_ */
@@ -8,7 +8,7 @@
  *               point light handler module.
  * PROGRAMMER  : CGSG-SummerCamp'2024.
  *               Vladislav A. Golubov (VG6).
- * LAST UPDATE : 27.07.2024.
+ * LAST UPDATE : 19.10.2026.
  * NOTE        : None.
  *
  * No part of this file may be changed without agreement of
@@ -54,6 +54,43 @@ namespace gort
 
         return LPower / L->Dist;
       } /* End of 'Shadow' function */
+
+      /* Emit photon function.
+       * Light intensity is 'LPower' in all directions.
+       * ARGUMENTS:
+       *   - emission samples in [0, 1) square (direction is second one):
+       *       DBL U1, V1, U2, V2;
+       *   - result photon ray:
+       *       ray *R;
+       *   - result light total flux:
+       *       vec3 *Flux;
+       * RETURN:
+       *   (BOOL) TRUE.
+       */
+      BOOL EmitPhoton( DBL U1, DBL V1, DBL U2, DBL V2, ray *R, vec3 *Flux ) override
+      {
+        DBL
+          z = 1 - 2 * U2,
+          r = sqrt(max(0.0, 1 - z * z)),
+          phi = 2 * PI * V2;
+
+        *R = ray(LP, vec3(r * cos(phi), z, r * sin(phi)));
+        *Flux = LColor * (4 * PI * LPower);
+        return TRUE;
+      } /* End of 'EmitPhoton' function */
+
+      /* Hash light parameters function.
+       * ARGUMENTS:
+       *   - hash to add to:
+       *       hasher &H;
+       * RETURN:
+       *   (BOOL) TRUE.
+       */
+      BOOL Hash( hasher &H ) const override
+      {
+        H << "point" << LP << LPower << LColor;
+        return TRUE;
+      } /* End of 'Hash' function */
     };
   } /* End of 'light' namespace */
 } /* End of 'gort' namespace */
@@ -0,0 +1,142 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : memory.h
+ * PURPOSE     : Raytracing project.
+ *               Memory footprint accounting module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : Report is filled by objects 'Account' functions.
+ *               Sizes are allocated bytes (container capacities), not
+ *               used ones, allocator overhead is not counted. Items of
+ *               same group and name are merged, item keeps largest
+ *               single addition too (largest mesh, busiest worker).
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#ifndef __memory_h_
+#define __memory_h_
+
+#include <map>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <iomanip>
+#include "def.h"
+
+/* Project namespace */
+namespace gort
+{
+  /* Memory footprint report class */
+  class mem_report
+  {
+  public:
+    /* Report item */
+    struct item
+    {
+      std::string Group; // Items group ("shapes", "mesh", "scene", "frame", "thread")
+      std::string Name;  // Item name in group
+      size_t Count = 0;  // Accounted objects count
+      size_t Bytes = 0;  // All objects memory in bytes
+      size_t Peak = 0;   // Largest single addition memory in bytes
+      size_t Parts = 0;  // Additions count
+    }; /* End of 'item' structure */
+
+    std::map<std::string, item> Items; // Items by "group/name" key (sorted, so groups are adjacent)
+
+    /* Obtain array allocated memory function.
+     * ARGUMENTS:
+     *   - array:
+     *       const std::vector<Type> &Arr;
+     * RETURNS:
+     *   (size_t) array capacity in bytes.
+     */
+    template<typename Type>
+      static size_t Of( const std::vector<Type> &Arr )
+      {
+        return Arr.capacity() * sizeof(Type);
+      } /* End of 'Of' function */
+
+    /* Add objects memory function.
+     * ARGUMENTS:
+     *   - item group and name:
+     *       const std::string &Group, &Name;
+     *   - objects count:
+     *       size_t Count;
+     *   - objects memory in bytes:
+     *       size_t Bytes;
+     * RETURNS: None.
+     */
+    VOID Add( const std::string &Group, const std::string &Name, size_t Count, size_t Bytes )
+    {
+      item &it = Items[Group + "/" + Name];
+
+      it.Group = Group;
+      it.Name = Name;
+      it.Count += Count;
+      it.Bytes += Bytes;
+      it.Peak = max(it.Peak, Bytes);
+      it.Parts++;
+    } /* End of 'Add' function */
+
+    /* Obtain accounted memory function.
+     * ARGUMENTS:
+     *   - group name (empty for all groups):
+     *       const std::string &Group;
+     * RETURNS:
+     *   (size_t) group memory in bytes.
+     */
+    size_t Total( const std::string &Group = "" ) const
+    {
+      size_t sum = 0;
+
+      for (auto &[key, it] : Items)
+        if (Group.empty() || it.Group == Group)
+          sum += it.Bytes;
+      return sum;
+    } /* End of 'Total' function */
+
+    /* Print report function (stream format state is kept).
+     * ARGUMENTS:
+     *   - output stream:
+     *       std::ostream &Out;
+     *   - memory budget in bytes (0 for no budget):
+     *       size_t Budget;
+     * RETURNS: None.
+     */
+    VOID Print( std::ostream &Out, size_t Budget = 0 ) const
+    {
+      const DBL mb = 1024.0 * 1024.0;
+      std::string group;
+      std::ios_base::fmtflags flags = Out.flags();
+      std::streamsize prec = Out.precision();
+
+      Out << std::fixed << std::setprecision(2);
+      for (auto &[key, it] : Items)
+      {
+        if (it.Group != group)
+          Out << (group = it.Group) << ": " << Total(group) / mb << " MB" << std::endl;
+        Out << "  " << std::left << std::setw(16) << it.Name << std::right << std::setw(10) << it.Count <<
+          std::setw(12) << it.Bytes / mb << " MB";
+        if (it.Peak * it.Parts != it.Bytes)
+          Out << " (largest " << it.Peak / mb << " MB)";
+        Out << std::endl;
+      }
+      Out << "total: " << Total() / mb << " MB";
+      if (Budget > 0)
+        Out << " of " << Budget / mb << " MB budget";
+      Out << std::endl;
+      Out.flags(flags);
+      Out.precision(prec);
+    } /* End of 'Print' function */
+  }; /* End of 'mem_report' class */
+} /* end of 'gort' namespace */
+
+#endif /* __memory_h_ */
+
+/* END OF 'memory.h' FILE */
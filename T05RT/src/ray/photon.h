@@ -0,0 +1,291 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : photon.h
+ * PURPOSE     : Raytracing project.
+ *               Photon map module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : Photons are kept in one array as balanced kd-tree:
+ *               node of range is its median photon, subtrees are range
+ *               halves, so tree has no links and subtree is continuous.
+ *               Top levels are split sequentially, lower subtrees are
+ *               built by pool workers.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#ifndef __photon_h_
+#define __photon_h_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include "def.h"
+#include "pool.h"
+
+/* Project namespace */
+namespace gort
+{
+  /* Photon map class */
+  class photon_map
+  {
+  public:
+    static const INT MaxK = 256; // Maximal gathered photons count
+
+    /* Stored photon record */
+    struct photon
+    {
+      FLT P[3];     // Position
+      FLT Power[3]; // Flux
+      FLT Dir[3];   // Propagation direction
+      DWORD Axis;   // Split axis of kd-tree node
+    }; /* End of 'photon' structure */
+
+    INT Emitted = 0;      // Emitted photons count
+    DBL TraceTime = 0;    // Photons tracing time in seconds
+    DBL BuildTime = 0;    // Tree build time in seconds
+
+  private:
+    std::vector<photon> Photons; // Photons in kd-tree order
+
+    /* Build subtree function.
+     * ARGUMENTS:
+     *   - photons range (Hi is excluded):
+     *       INT Lo, Hi;
+     * RETURNS: None.
+     */
+    VOID Split( INT Lo, INT Hi )
+    {
+      while (Hi - Lo > 1)
+      {
+        INT mid = SplitNode(Lo, Hi);
+
+        Split(Lo, mid);
+        Lo = mid + 1;
+      }
+      if (Hi - Lo == 1)
+        Photons[Lo].Axis = 0;
+    } /* End of 'Split' function */
+
+    /* Split range by median on widest axis function.
+     * ARGUMENTS:
+     *   - photons range (Hi is excluded, at least 2 photons):
+     *       INT Lo, Hi;
+     * RETURNS:
+     *   (INT) node (median) photon number.
+     */
+    INT SplitNode( INT Lo, INT Hi )
+    {
+      FLT bmin[3], bmax[3];
+      INT mid = (Lo + Hi) / 2, a = 0;
+
+      for (INT k = 0; k < 3; k++)
+        bmin[k] = bmax[k] = Photons[Lo].P[k];
+      for (INT i = Lo + 1; i < Hi; i++)
+        for (INT k = 0; k < 3; k++)
+          bmin[k] = min(bmin[k], Photons[i].P[k]), bmax[k] = max(bmax[k], Photons[i].P[k]);
+      for (INT k = 1; k < 3; k++)
+        if (bmax[k] - bmin[k] > bmax[a] - bmin[a])
+          a = k;
+      std::nth_element(Photons.begin() + Lo, Photons.begin() + mid, Photons.begin() + Hi,
+        [a]( const photon &A, const photon &B )
+        {
+          return A.P[a] < B.P[a];
+        });
+      Photons[mid].Axis = a;
+      return mid;
+    } /* End of 'SplitNode' function */
+
+  public:
+    /* Clear map function.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID Clear( VOID )
+    {
+      Photons.clear();
+      Emitted = 0;
+      TraceTime = BuildTime = 0;
+    } /* End of 'Clear' function */
+
+    /* Obtain stored photons count function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (size_t) photons count.
+     */
+    size_t Size( VOID ) const
+    {
+      return Photons.size();
+    } /* End of 'Size' function */
+
+    /* Obtain map memory function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (size_t) photons memory in bytes.
+     */
+    size_t Memory( VOID ) const
+    {
+      return Photons.capacity() * sizeof(photon);
+    } /* End of 'Memory' function */
+
+    /* Obtain stored photon function.
+     * ARGUMENTS:
+     *   - photon number:
+     *       INT No;
+     * RETURNS:
+     *   (const photon &) photon record.
+     */
+    const photon & operator[]( INT No ) const
+    {
+      return Photons[No];
+    } /* End of 'operator[]' function */
+
+    /* Build map function.
+     * ARGUMENTS:
+     *   - photons to store (moved to map):
+     *       std::vector<photon> &&Src;
+     *   - workers pool and workers count:
+     *       thread_pool &Pool;
+     *       INT ThreadCount;
+     * RETURNS: None.
+     */
+    VOID Build( std::vector<photon> &&Src, thread_pool &Pool, INT ThreadCount )
+    {
+      auto t0 = std::chrono::steady_clock::now();
+      std::vector<std::pair<INT, INT>> ranges {{0, (INT)Src.size()}}, next;
+      INT n = max(Pool.Count(), 1);
+
+      Photons = std::move(Src);
+      Photons.shrink_to_fit();
+
+      // Split until there are enough subtrees for workers
+      while ((INT)ranges.size() < n * 4 && !ranges.empty())
+      {
+        next.clear();
+        for (auto [lo, hi] : ranges)
+          if (hi - lo > 1024)
+          {
+            INT mid = SplitNode(lo, hi);
+
+            next.push_back({lo, mid});
+            next.push_back({mid + 1, hi});
+          }
+          else
+            Split(lo, hi);
+        ranges.swap(next);
+      }
+      std::atomic_int task = 0;
+      Pool.Run(ThreadCount,
+        [&]( INT )
+        {
+          for (INT t = task++; t < (INT)ranges.size(); t = task++)
+            Split(ranges[t].first, ranges[t].second);
+        });
+      BuildTime = std::chrono::duration<DBL>(std::chrono::steady_clock::now() - t0).count();
+    } /* End of 'Build' function */
+
+    /* Estimate irradiance function.
+     * Up to K nearest photons in radius are gathered, photons
+     * coming from behind surface are skipped.
+     * ARGUMENTS:
+     *   - surface point and normal (faced to viewer):
+     *       const vec3 &P, &N;
+     *   - maximal gather radius:
+     *       DBL Radius;
+     *   - maximal photons count (up to 'MaxK'):
+     *       INT K;
+     * RETURNS:
+     *   (vec3) irradiance estimate.
+     */
+    vec3 Irradiance( const vec3 &P, const vec3 &N, DBL Radius, INT K ) const
+    {
+      // Max-heap of found photons by distance
+      std::pair<FLT, INT> heap[MaxK];
+      // Subtrees to visit with distance to parent split plane
+      struct
+      {
+        INT Lo, Hi;
+        FLT D2;
+      } stack[64];
+      INT nh = 0, ns = 0;
+      FLT r2 = (FLT)(Radius * Radius), p[3] = {(FLT)P[0], (FLT)P[1], (FLT)P[2]};
+
+      K = min(max(K, 1), MaxK);
+      if (!Photons.empty())
+        stack[ns++] = {0, (INT)Photons.size(), 0};
+      while (ns > 0)
+      {
+        auto [lo, hi, d2] = stack[--ns];
+
+        if (d2 >= r2)
+          continue;
+
+        INT mid = (lo + hi) / 2;
+        const photon &ph = Photons[mid];
+        FLT d = p[ph.Axis] - ph.P[ph.Axis];
+
+        // Near half is visited first
+        if (d < 0)
+        {
+          if (mid + 1 < hi)
+            stack[ns++] = {mid + 1, hi, d * d};
+          if (lo < mid)
+            stack[ns++] = {lo, mid, 0};
+        }
+        else
+        {
+          if (lo < mid)
+            stack[ns++] = {lo, mid, d * d};
+          if (mid + 1 < hi)
+            stack[ns++] = {mid + 1, hi, 0};
+        }
+
+        FLT
+          dx = p[0] - ph.P[0],
+          dy = p[1] - ph.P[1],
+          dz = p[2] - ph.P[2],
+          dist2 = dx * dx + dy * dy + dz * dz;
+
+        if (dist2 >= r2)
+          continue;
+        if (nh < K)
+        {
+          heap[nh++] = {dist2, mid};
+          std::push_heap(heap, heap + nh);
+          if (nh == K)
+            r2 = heap[0].first;
+        }
+        else
+        {
+          std::pop_heap(heap, heap + nh);
+          heap[nh - 1] = {dist2, mid};
+          std::push_heap(heap, heap + nh);
+          r2 = heap[0].first;
+        }
+      }
+      if (nh == 0)
+        return vec3(0);
+
+      vec3 sum(0);
+
+      for (INT i = 0; i < nh; i++)
+      {
+        const photon &ph = Photons[heap[i].second];
+
+        if (ph.Dir[0] * N[0] + ph.Dir[1] * N[1] + ph.Dir[2] * N[2] < 0)
+          sum += vec3(ph.Power[0], ph.Power[1], ph.Power[2]);
+      }
+      // Area is disk of found photons when K photons are found
+      return sum / (PI * (nh == K ? max((DBL)heap[0].first, 1e-8) : Radius * Radius));
+    } /* End of 'Irradiance' function */
+  }; /* End of 'photon_map' class */
+} /* end of 'gort' namespace */
+
+#endif /* __photon_h_ */
+
+/* END OF 'photon.h' FILE */
@@ -0,0 +1,398 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : pool.h
+ * PURPOSE     : Raytracing project.
+ *               Render thread pool module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : Workers are created once and wait for jobs. With
+ *               NUMA mode workers are spread over nodes round robin
+ *               and limited to node processors, per worker scratch
+ *               memory is allocated on worker node. Only scratch is
+ *               placed: scene data and frame buffer are single
+ *               allocations read and written from all nodes. Without
+ *               NUMA mode on machines with several processor groups
+ *               nodes are groups, so workers run on all groups. With
+ *               pinning each worker is bound to one logical processor.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#ifndef __pool_h_
+#define __pool_h_
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "def.h"
+#include "memory.h"
+
+/* Project namespace */
+namespace gort
+{
+  /* Render thread pool class */
+  class thread_pool
+  {
+  public:
+    /* Pool settings */
+    struct config
+    {
+      INT Count = 0;          // Workers count (0 for all logical processors)
+      BOOL IsPinned = FALSE;  // Bind each worker to one logical processor
+      BOOL IsNuma = FALSE;    // Spread workers over NUMA nodes
+    }; /* End of 'config' structure */
+
+  private:
+    /* Worker data */
+    struct worker
+    {
+      std::thread Th;          // Worker thread
+      INT Node = 0;            // NUMA node number (index in 'NodeMasks')
+      VOID *Scratch = nullptr; // Scratch memory
+      size_t ScratchSize = 0;  // Scratch memory size
+      size_t HeapPeak = 0;     // Largest transient heap memory: hit lists, lines without scratch (see 'NoteHeap')
+    }; /* End of 'worker' structure */
+
+    config Cfg;                          // Current settings
+    std::vector<worker> Workers;         // Workers
+    std::atomic_int WorkersCount = 0;    // Created workers count (0 before first 'Setup')
+    std::vector<GROUP_AFFINITY> NodeMasks; // Nodes processors
+    std::vector<USHORT> NodeNums;        // Nodes system numbers
+    std::mutex RunMutex;                 // 'Run' calls serialization
+    std::mutex JobMutex;                 // Job state access mutex
+    std::condition_variable JobStart, JobDone;
+    std::function<VOID ( INT )> Job;     // Current job
+    INT JobCount = 0;                    // Current job workers count
+    INT JobLeft = 0;                     // Current job not finished workers
+    UINT64 JobNo = 0;                    // Current job number
+    BOOL IsExit = FALSE;                 // Workers exit flag
+
+  public:
+    /* Obtain default workers count function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (INT) logical processors count (at least 1).
+     */
+    static INT DefaultCount( VOID )
+    {
+      return max((INT)GetActiveProcessorCount(ALL_PROCESSOR_GROUPS), 1);
+    } /* End of 'DefaultCount' function */
+
+    /* Class destructor */
+    ~thread_pool( VOID )
+    {
+      Stop();
+    } /* End of '~thread_pool' function */
+
+    /* Recreate workers function.
+     * ARGUMENTS:
+     *   - new settings:
+     *       const config &NewCfg;
+     * RETURNS: None.
+     */
+    VOID Setup( const config &NewCfg )
+    {
+      std::lock_guard<std::mutex> lock(RunMutex);
+
+      Create(NewCfg);
+    } /* End of 'Setup' function */
+
+    /* Obtain workers count function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (INT) workers count (pool is created with default settings if needed).
+     */
+    INT Count( VOID )
+    {
+      INT n = WorkersCount;
+
+      if (n == 0)
+      {
+        std::lock_guard<std::mutex> lock(RunMutex);
+
+        if (WorkersCount == 0)
+          Create(Cfg);
+        n = WorkersCount;
+      }
+      return n;
+    } /* End of 'Count' function */
+
+    /* Obtain nodes count function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (INT) nodes count used by workers (NUMA nodes or processor groups).
+     */
+    INT NodeCount( VOID ) const
+    {
+      return max((INT)NodeMasks.size(), 1);
+    } /* End of 'NodeCount' function */
+
+    /* Obtain worker node function.
+     * ARGUMENTS:
+     *   - worker number:
+     *       INT WorkerNo;
+     * RETURNS:
+     *   (INT) worker node number.
+     */
+    INT Node( INT WorkerNo ) const
+    {
+      return Workers[WorkerNo].Node;
+    } /* End of 'Node' function */
+
+    /* Obtain worker scratch memory function (call from worker only).
+     * ARGUMENTS:
+     *   - worker number:
+     *       INT WorkerNo;
+     *   - needed size in bytes:
+     *       size_t Size;
+     * RETURNS:
+     *   (VOID *) scratch memory, kept between jobs.
+     */
+    VOID * Scratch( INT WorkerNo, size_t Size )
+    {
+      worker &w = Workers[WorkerNo];
+
+      if (w.ScratchSize < Size)
+      {
+        if (w.Scratch != nullptr)
+          VirtualFree(w.Scratch, 0, MEM_RELEASE);
+        Size = (Size + 0xFFFF) & ~(size_t)0xFFFF;
+        if (Cfg.IsNuma)
+          w.Scratch = VirtualAllocExNuma(GetCurrentProcess(), nullptr, Size,
+            MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, NodeNums[w.Node]);
+        else
+          w.Scratch = VirtualAlloc(nullptr, Size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        w.ScratchSize = w.Scratch != nullptr ? Size : 0;
+      }
+      return w.Scratch;
+    } /* End of 'Scratch' function */
+
+    /* Store worker transient heap memory function (call from worker only).
+     * ARGUMENTS:
+     *   - worker number:
+     *       INT WorkerNo;
+     *   - worker allocated memory in bytes:
+     *       size_t Bytes;
+     * RETURNS: None.
+     */
+    VOID NoteHeap( INT WorkerNo, size_t Bytes )
+    {
+      worker &w = Workers[WorkerNo];
+
+      w.HeapPeak = max(w.HeapPeak, Bytes);
+    } /* End of 'NoteHeap' function */
+
+    /* Account workers memory function (no job should be active).
+     * ARGUMENTS:
+     *   - report to fill:
+     *       mem_report &Rep;
+     * RETURNS: None.
+     */
+    VOID Account( mem_report &Rep ) const
+    {
+      for (const worker &w : Workers)
+      {
+        Rep.Add("thread", "scratch", 1, w.ScratchSize);
+        Rep.Add("thread", "heap", 1, w.HeapPeak);
+      }
+    } /* End of 'Account' function */
+
+    /* Obtain largest worker transient memory function (no job should be active).
+     * Thread stacks are not counted.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (size_t) largest worker scratch and heap peak sum in bytes.
+     */
+    size_t TransientPeak( VOID ) const
+    {
+      size_t peak = 0;
+
+      for (const worker &w : Workers)
+        peak = max(peak, w.ScratchSize + w.HeapPeak);
+      return peak;
+    } /* End of 'TransientPeak' function */
+
+    /* Run job on workers and wait for finish function.
+     * ARGUMENTS:
+     *   - workers count (clamped to pool size, 0 or less for all):
+     *       INT Count;
+     *   - job (gets worker number):
+     *       const std::function<VOID ( INT )> &NewJob;
+     * RETURNS:
+     *   (INT) used workers count.
+     */
+    INT Run( INT Count, const std::function<VOID ( INT )> &NewJob )
+    {
+      INT n = this->Count();
+      std::lock_guard<std::mutex> run_lock(RunMutex);
+      std::unique_lock<std::mutex> lock(JobMutex);
+
+      Count = Count <= 0 ? n : min(Count, n);
+      Job = NewJob;
+      JobCount = JobLeft = Count;
+      JobNo++;
+      JobStart.notify_all();
+      JobDone.wait(lock, [this]( VOID ) { return JobLeft == 0; });
+      Job = nullptr;
+      return Count;
+    } /* End of 'Run' function */
+
+  private:
+    /* Recreate workers function (call under 'RunMutex').
+     * ARGUMENTS:
+     *   - new settings:
+     *       const config &NewCfg;
+     * RETURNS: None.
+     */
+    VOID Create( const config &NewCfg )
+    {
+      Stop();
+      Cfg = NewCfg;
+      INT n = Cfg.Count > 0 ? Cfg.Count : DefaultCount();
+
+      // Nodes processors
+      NodeMasks.clear();
+      NodeNums.clear();
+      ULONG hi = 0;
+      if (Cfg.IsNuma && GetNumaHighestNodeNumber(&hi))
+        for (ULONG i = 0; i <= hi; i++)
+        {
+          GROUP_AFFINITY ga {};
+
+          if (GetNumaNodeProcessorMaskEx((USHORT)i, &ga) && ga.Mask != 0)
+            NodeMasks.push_back(ga), NodeNums.push_back((USHORT)i);
+        }
+      // Several processor groups: one pseudo node per group
+      if (NodeMasks.empty() && GetActiveProcessorGroupCount() > 1)
+        for (WORD g = 0; g < GetActiveProcessorGroupCount(); g++)
+        {
+          GROUP_AFFINITY ga {};
+          DWORD procs = GetActiveProcessorCount(g);
+
+          ga.Group = g;
+          ga.Mask = procs >= sizeof(KAFFINITY) * 8 ? ~(KAFFINITY)0 : ((KAFFINITY)1 << procs) - 1;
+          if (ga.Mask != 0)
+            NodeMasks.push_back(ga), NodeNums.push_back(0);
+        }
+      if (NodeMasks.empty())
+      {
+        GROUP_AFFINITY ga {};
+        DWORD_PTR proc = 0, sys = 0;
+
+        GetProcessAffinityMask(GetCurrentProcess(), &proc, &sys);
+        ga.Mask = proc;
+        NodeMasks.push_back(ga);
+        NodeNums.push_back(0);
+      }
+
+      IsExit = FALSE;
+      JobCount = 0;
+      Workers = std::vector<worker>(n);
+      for (INT i = 0; i < n; i++)
+      {
+        Workers[i].Node = i % (INT)NodeMasks.size();
+        Workers[i].Th = std::thread(
+          [this, i]( VOID )
+          {
+            Bind(i);
+            Loop(i);
+          });
+      }
+      WorkersCount = n;
+    } /* End of 'Create' function */
+
+    /* Stop and delete workers function.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID Stop( VOID )
+    {
+      {
+        std::lock_guard<std::mutex> lock(JobMutex);
+        IsExit = TRUE;
+      }
+      JobStart.notify_all();
+      for (worker &w : Workers)
+      {
+        w.Th.join();
+        if (w.Scratch != nullptr)
+          VirtualFree(w.Scratch, 0, MEM_RELEASE);
+      }
+      Workers.clear();
+      WorkersCount = 0;
+    } /* End of 'Stop' function */
+
+    /* Bind worker to node or processor function.
+     * ARGUMENTS:
+     *   - worker number:
+     *       INT WorkerNo;
+     * RETURNS: None.
+     */
+    VOID Bind( INT WorkerNo )
+    {
+      if (!Cfg.IsPinned && !Cfg.IsNuma && NodeMasks.size() < 2)
+        return;
+
+      GROUP_AFFINITY ga = NodeMasks[Workers[WorkerNo].Node];
+      if (Cfg.IsPinned)
+      {
+        // K-th processor of node, K is worker number inside node
+        INT k = WorkerNo / (INT)NodeMasks.size(), bits = 0;
+
+        for (KAFFINITY m = ga.Mask; m != 0; m &= m - 1)
+          bits++;
+        k %= bits;
+        KAFFINITY m = ga.Mask;
+        while (k-- > 0)
+          m &= m - 1;
+        ga.Mask = m & ~(m - 1);
+      }
+      SetThreadGroupAffinity(GetCurrentThread(), &ga, nullptr);
+    } /* End of 'Bind' function */
+
+    /* Worker loop function.
+     * ARGUMENTS:
+     *   - worker number:
+     *       INT WorkerNo;
+     * RETURNS: None.
+     */
+    VOID Loop( INT WorkerNo )
+    {
+      UINT64 done = 0;
+
+      while (TRUE)
+      {
+        std::function<VOID ( INT )> job;
+
+        {
+          std::unique_lock<std::mutex> lock(JobMutex);
+
+          JobStart.wait(lock, [&]( VOID ) { return IsExit || (JobNo != done && WorkerNo < JobCount); });
+          if (IsExit)
+            return;
+          done = JobNo;
+          job = Job;
+        }
+        job(WorkerNo);
+        {
+          std::lock_guard<std::mutex> lock(JobMutex);
+
+          if (--JobLeft == 0)
+            JobDone.notify_one();
+        }
+      }
+    } /* End of 'Loop' function */
+  }; /* End of 'thread_pool' class */
+} /* end of 'gort' namespace */
+
+#endif /* __pool_h_ */
+
+/* END OF 'pool.h' FILE */
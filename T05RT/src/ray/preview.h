@@ -0,0 +1,261 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : preview.h
+ * PURPOSE     : Raytracing project.
+ *               Interactive dynamic resolution preview module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : While camera moves frames are rendered with pixel
+ *               step 'Div' (W / Div x H / Div frame), the step is
+ *               adapted after each such frame to hit 'TargetTime'.
+ *               Once camera stops step is halved pass by pass down
+ *               to full resolution, last pass uses 'Samples'
+ *               samples per pixel. Camera change cancels refinement
+ *               pass in flight.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#ifndef __preview_h_
+#define __preview_h_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "frame.h"
+#include "rt_scene.h"
+#include "timeline.h"
+
+/* Project namespace */
+namespace gort
+{
+  /* Interactive preview render class */
+  class preview
+  {
+  private:
+    frame Frames[3];                   // Shown, ready and back (rendered) frames
+    INT Shown = 0;                     // Shown frame number (UI thread only, see 'Draw')
+    INT Back = 2;                      // Back frame number (render thread only)
+    std::atomic_int Ready = 1;         // Last finished frame number, 'FreshBit' if not shown yet
+    rt::scene *Scene = nullptr;        // Scene to render
+    std::thread Th;                    // Render loop thread
+    std::mutex CamMutex;               // Camera access mutex
+    std::condition_variable Changed;   // Camera change or stop event
+    camera Cam;                        // Navigation camera (full frame size)
+    UINT64 CamVersion = 0;             // Camera change counter
+    std::atomic_bool IsRefining = FALSE; // Refinement pass in flight flag
+    BOOL IsToStop = FALSE;             // Render loop stop flag
+
+    // Ready frame not shown yet flag (in 'Ready')
+    static const INT FreshBit = 4;
+
+  public:
+    INT
+      Div = 4,                         // Pixel step while moving
+      MaxDiv = 8,                      // Maximal pixel step
+      Samples = 4;                     // Last refinement pass samples per pixel
+    DBL TargetTime = 1.0 / 15;         // Moving frame target time in seconds
+    std::atomic_bool IsActive = FALSE; // Render loop running flag
+
+    /* Start preview render loop function.
+     * ARGUMENTS:
+     *   - scene to render (should be kept unchanged while active):
+     *       rt::scene &NewScene;
+     *   - start camera (defines full frame size):
+     *       const camera &NewCam;
+     *   - render threads count:
+     *       INT ThreadCount;
+     *   - callback on each finished pass (called from render thread):
+     *       const std::function<VOID ( VOID )> &OnPass;
+     * RETURNS: None.
+     */
+    VOID Start( rt::scene &NewScene, const camera &NewCam, INT ThreadCount,
+                const std::function<VOID ( VOID )> &OnPass )
+    {
+      if (IsActive)
+        return;
+      Scene = &NewScene;
+      Cam = NewCam;
+      CamVersion++;
+      IsToStop = FALSE;
+      IsActive = TRUE;
+      Th = std::thread(
+        [this, ThreadCount, OnPass]( VOID )
+        {
+          timeline::Get().SetThread(1, "render");
+          Loop(max(ThreadCount, 1), OnPass);
+        });
+    } /* End of 'Start' function */
+
+    /* Stop preview render loop function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (camera) last navigation camera.
+     */
+    camera Stop( VOID )
+    {
+      if (IsActive)
+      {
+        {
+          std::lock_guard<std::mutex> lock(CamMutex);
+          IsToStop = TRUE;
+          Scene->IsToBeStop = TRUE;
+        }
+        Changed.notify_one();
+        Th.join();
+        Scene->IsToBeStop = FALSE;
+        IsActive = FALSE;
+      }
+      return Cam;
+    } /* End of 'Stop' function */
+
+    /* Move and turn navigation camera function.
+     * ARGUMENTS:
+     *   - movement in camera space (right, up, forward):
+     *       const vec3 &Move;
+     *   - turn angles in degrees:
+     *       DBL Yaw, Pitch;
+     * RETURNS: None.
+     */
+    VOID Navigate( const vec3 &Move, DBL Yaw, DBL Pitch )
+    {
+      {
+        std::lock_guard<std::mutex> lock(CamMutex);
+
+        Fly(Cam, Move, Yaw, Pitch);
+        CamVersion++;
+        // Moving passes are kept short by adaptation and are not cancelled,
+        // otherwise continuous movement never shows anything
+        if (IsRefining)
+          Scene->IsToBeStop = TRUE;
+      }
+      Changed.notify_one();
+    } /* End of 'Navigate' function */
+
+    /* Move and turn camera in fly mode function.
+     * ARGUMENTS:
+     *   - camera to change:
+     *       camera &C;
+     *   - movement in camera space (right, up, forward):
+     *       const vec3 &Move;
+     *   - turn angles in degrees:
+     *       DBL Yaw, Pitch;
+     * RETURNS: None.
+     */
+    static VOID Fly( camera &C, const vec3 &Move, DBL Yaw, DBL Pitch )
+    {
+      vec3 loc = C.Loc + C.Right * Move[0] + C.Up * Move[1] + C.Dir * Move[2];
+      DBL
+        az = atan2(C.Dir[0], C.Dir[2]) - D2R(Yaw),
+        el = asin(min(max(C.Dir[1], -1.0), 1.0)) - D2R(Pitch);
+
+      el = min(max(el, -D2R(89.0)), D2R(89.0));
+      C.SetLocAtUp(loc, loc + vec3(sin(az) * cos(el), sin(el), cos(az) * cos(el)), vec3(0, 1, 0));
+    } /* End of 'Fly' function */
+
+    /* Blit last finished pass to device context function.
+     * Should be called from one (UI) thread. Fresh ready frame is taken
+     * in exchange of shown one, so render thread never writes shown frame.
+     * ARGUMENTS:
+     *   - device context:
+     *       HDC hDC;
+     *   - window rectangle:
+     *       INT X, Y, DrawW, DrawH;
+     * RETURNS: None.
+     */
+    VOID Draw( HDC hDC, INT X, INT Y, INT DrawW, INT DrawH )
+    {
+      if (Ready.load() & FreshBit)
+        Shown = Ready.exchange(Shown) & ~FreshBit;
+      Frames[Shown].Draw(hDC, X, Y, DrawW, DrawH);
+    } /* End of 'Draw' function */
+
+  private:
+    /* Render loop function.
+     * ARGUMENTS:
+     *   - render threads count:
+     *       INT ThreadCount;
+     *   - callback on each finished pass:
+     *       const std::function<VOID ( VOID )> &OnPass;
+     * RETURNS: None.
+     */
+    VOID Loop( INT ThreadCount, const std::function<VOID ( VOID )> &OnPass )
+    {
+      UINT64 done = 0;        // Last shown camera version
+      INT d = Div, spp = 1;   // Next pass pixel step and samples
+      BOOL IsRefined = FALSE; // All refinement passes done flag
+
+      while (TRUE)
+      {
+        camera c;
+        UINT64 ver;
+
+        {
+          std::unique_lock<std::mutex> lock(CamMutex);
+
+          Changed.wait(lock, [&]( VOID ) { return IsToStop || CamVersion != done || !IsRefined; });
+          if (IsToStop)
+            break;
+          ver = CamVersion;
+          if (ver != done)
+            d = Div, spp = 1;
+          c = Cam;
+          IsRefining = ver == done;
+          Scene->IsToBeStop = FALSE;
+        }
+
+        // Render pass to back frame
+        frame &back = Frames[Back];
+        INT w = max(c.FrameW / d, 1), h = max(c.FrameH / d, 1);
+
+        if (back.W != w || back.H != h)
+          back.Resize(w, h);
+        c.Resize(w, h);
+        auto t0 = std::chrono::steady_clock::now();
+        {
+          timeline_scope ts("preview pass", d);
+          Scene->RenderRect(back, c, ThreadCount, 0, 0, w, h, spp);
+        }
+        DBL t = std::chrono::duration<DBL>(std::chrono::steady_clock::now() - t0).count();
+
+        if (Scene->IsToBeStop)
+        {
+          // Cancelled by camera change or stop
+          IsRefined = FALSE;
+          continue;
+        }
+        // Finished frame becomes ready, previous ready (or not shown) frame is next back
+        Back = Ready.exchange(Back | FreshBit) & ~FreshBit;
+        OnPass();
+
+        if (ver != done)
+        {
+          // Moving pass: adapt pixel step, cost is proportional to pixels count
+          Div = (INT)ceil(d * sqrt(t / TargetTime));
+          Div = min(max(Div, 1), MaxDiv);
+          done = ver;
+        }
+
+        // Next refinement step
+        IsRefined = FALSE;
+        if (d > 1)
+          d /= 2;
+        else if (spp < Samples)
+          spp = Samples;
+        else
+          IsRefined = TRUE;
+      }
+      IsRefining = FALSE;
+    } /* End of 'Loop' function */
+  }; /* End of 'preview' class */
+} /* end of 'gort' namespace */
+
+#endif /* __preview_h_ */
+
+/* END OF 'preview.h' FILE */
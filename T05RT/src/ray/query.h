@@ -0,0 +1,118 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : query.h
+ * PURPOSE     : Raytracing project.
+ *               Batched ray query C interface module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : Header is plain C. Rays are given by arrays: origins
+ *               and directions (3 doubles per ray) and distance ranges
+ *               (tmin, tmax per ray). Directions should be non zero.
+ *               Each direction is normalized and ray origin is moved
+ *               to 'Org + tmin * unit Dir', so 'TRange' and hit 'T'
+ *               are distances from 'Org' along unit direction (world
+ *               units), not parameters of given 'Dir' length.
+ *               Queries are split between scene render pool workers,
+ *               scene should not be changed or rendered meanwhile.
+ *               In C++ scene handle is 'gort::rt::scene' pointer.
+ *               Library build ('T05RTQUERY' project) defines
+ *               'GORT_DLL' to export functions; clients of DLL define
+ *               'GORT_DLL_IMPORT', static library clients define none.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#ifndef __query_h_
+#define __query_h_
+
+#if defined(GORT_DLL)
+#define GORT_DECL __declspec(dllexport)
+#elif defined(GORT_DLL_IMPORT)
+#define GORT_DECL __declspec(dllimport)
+#else /* GORT_DLL */
+#define GORT_DECL
+#endif /* GORT_DLL */
+
+#ifdef __cplusplus
+#define GORT_API extern "C" GORT_DECL
+#else /* __cplusplus */
+#define GORT_API GORT_DECL
+#endif /* __cplusplus */
+
+/* Scene handle (opaque) */
+typedef struct taggortSCENE gortSCENE;
+
+/* Closest hit record */
+typedef struct taggortHIT
+{
+  double T;    /* Hit distance from origin along unit direction (-1 if ray hits nothing in range) */
+  double N[3]; /* Hit shape normal (not faced to ray) */
+  double U, V; /* Triangle barycentrics (triangles and meshes only) */
+  int Type;    /* Shape kind: 0 - custom shape, 1 - sphere, 2 - box, 3 - plane, 4 - triangle */
+  int Shape;   /* Custom shape number in scene or typed array index (see 'Type') */
+  int Prim;    /* Shape primitive (mesh triangle, cloud sphere in adding order or box face), -1 if none */
+} gortHIT;
+
+/* Load snapshot scene function.
+ * ARGUMENTS:
+ *   - snapshot file name ('.gsnp'):
+ *       const char *FileName;
+ * RETURNS:
+ *   (gortSCENE *) loaded scene or NULL if failed.
+ */
+GORT_API gortSCENE * GORT_SceneLoad( const char *FileName );
+
+/* Free scene function.
+ * ARGUMENTS:
+ *   - scene to free (loaded by 'GORT_SceneLoad'):
+ *       gortSCENE *Scene;
+ * RETURNS: None.
+ */
+GORT_API void GORT_SceneFree( gortSCENE *Scene );
+
+/* Find closest hits function.
+ * Distances are measured along normalized direction (see NOTE).
+ * ARGUMENTS:
+ *   - scene:
+ *       gortSCENE *Scene;
+ *   - rays count:
+ *       int Count;
+ *   - rays origins, directions and distance ranges:
+ *       const double *Org, *Dir, *TRange;
+ *   - result hits ('Count' records):
+ *       gortHIT *Hits;
+ *   - workers count (0 for all scene pool workers):
+ *       int Threads;
+ * RETURNS:
+ *   (int) rays with hit count.
+ */
+GORT_API int GORT_Intersect( gortSCENE *Scene, int Count, const double *Org, const double *Dir,
+                             const double *TRange, gortHIT *Hits, int Threads );
+
+/* Check rays occlusion function.
+ * Any hit in range is enough, so it is cheaper than closest hit.
+ * ARGUMENTS:
+ *   - scene:
+ *       gortSCENE *Scene;
+ *   - rays count:
+ *       int Count;
+ *   - rays origins, directions and distance ranges:
+ *       const double *Org, *Dir, *TRange;
+ *   - result occlusion bits ('(Count + 7) / 8' bytes, ray N is bit 'N % 8' of byte 'N / 8'):
+ *       unsigned char *Bits;
+ *   - workers count (0 for all scene pool workers):
+ *       int Threads;
+ * RETURNS:
+ *   (int) occluded rays count.
+ */
+GORT_API int GORT_Occluded( gortSCENE *Scene, int Count, const double *Org, const double *Dir,
+                            const double *TRange, unsigned char *Bits, int Threads );
+
+#endif /* __query_h_ */
+
+/* END OF 'query.h' FILE */
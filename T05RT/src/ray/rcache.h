@@ -0,0 +1,287 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : rcache.h
+ * PURPOSE     : Raytracing project.
+ *               Rendered tiles disk cache module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : Render key is hash of scene content (shapes,
+ *               materials, lights), render settings, camera and
+ *               samples count. Rectangle is rendered by rows strips,
+ *               each strip is one file named by key and strip
+ *               rectangle, so stopped render keeps finished strips.
+ *               Scenes with shapes or lights that can't be hashed are
+ *               rendered without cache. Cache directory is never
+ *               trimmed (remove it to free disk).
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#ifndef __rcache_h_
+#define __rcache_h_
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "rt_scene.h"
+#include "hash.h"
+
+/* Project namespace */
+namespace gort
+{
+  /* Cached strip file header */
+  struct tile_header
+  {
+    DWORD Sign;             // "GTIL"
+    DWORD Version;          // Format version
+    INT X0, Y0, X1, Y1;     // Strip rectangle (X1, Y1 are excluded)
+    UINT64 Key;             // Render key
+    DBL Time;               // Strip render time in seconds
+  }; /* End of 'tile_header' structure */
+
+  /* Rendered tiles cache class */
+  class render_cache
+  {
+  public:
+    // Current format version (also changes all render keys)
+    static const DWORD Version = 1;
+
+    std::string Dir = "bin/cache"; // Cache files directory
+    INT StripH = 32;               // Cached strip height in rows
+
+    // Statistics
+    INT64
+      Hits = 0,          // Strips loaded from cache
+      Misses = 0,        // Strips rendered and stored
+      Unhashed = 0;      // Renders without cache (scene can't be hashed)
+    UINT64
+      BytesRead = 0,     // Loaded strips files size
+      BytesWritten = 0;  // Stored strips files size
+    DBL SavedTime = 0;   // Loaded strips render time in seconds
+
+  private:
+    /* Build strip file name function.
+     * ARGUMENTS:
+     *   - render key:
+     *       UINT64 Key;
+     *   - strip rectangle:
+     *       INT X0, Y0, X1, Y1;
+     * RETURNS:
+     *   (std::string) file name.
+     */
+    std::string FileName( UINT64 Key, INT X0, INT Y0, INT X1, INT Y1 ) const
+    {
+      std::ostringstream Name;
+
+      Name << Dir << "/" << std::hex << std::setw(16) << std::setfill('0') << Key << std::dec <<
+        "_" << X0 << "_" << Y0 << "_" << X1 << "_" << Y1 << ".gtile";
+      return Name.str();
+    } /* End of 'FileName' function */
+
+    /* Load strip from file function.
+     * ARGUMENTS:
+     *   - render key:
+     *       UINT64 Key;
+     *   - frame to fill:
+     *       frame &Frm;
+     *   - strip rectangle:
+     *       INT X0, Y0, X1, Y1;
+     * RETURNS:
+     *   (BOOL) TRUE if strip is loaded, FALSE otherwise.
+     */
+    BOOL Load( UINT64 Key, frame &Frm, INT X0, INT Y0, INT X1, INT Y1 )
+    {
+      std::ifstream f(FileName(Key, X0, Y0, X1, Y1), std::ios::binary);
+      tile_header h {};
+      std::vector<DWORD> pixels((size_t)(X1 - X0) * (Y1 - Y0));
+
+      if (!f.read((CHAR *)&h, sizeof(h)) || h.Sign != *(DWORD *)"GTIL" || h.Version != Version || h.Key != Key ||
+          h.X0 != X0 || h.Y0 != Y0 || h.X1 != X1 || h.Y1 != Y1 ||
+          !f.read((CHAR *)pixels.data(), pixels.size() * sizeof(DWORD)))
+        return FALSE;
+      for (INT y = Y0; y < Y1; y++)
+        Frm.PutSpan(X0, y, X1 - X0, &pixels[(size_t)(y - Y0) * (X1 - X0)]);
+      BytesRead += sizeof(h) + pixels.size() * sizeof(DWORD);
+      SavedTime += h.Time;
+      return TRUE;
+    } /* End of 'Load' function */
+
+    /* Store strip to file function.
+     * File is written under temporary name first, so other processes
+     * never read partial strip.
+     * ARGUMENTS:
+     *   - render key:
+     *       UINT64 Key;
+     *   - rendered frame:
+     *       frame &Frm;
+     *   - strip rectangle:
+     *       INT X0, Y0, X1, Y1;
+     *   - strip render time in seconds:
+     *       DBL Time;
+     * RETURNS: None.
+     */
+    VOID Store( UINT64 Key, frame &Frm, INT X0, INT Y0, INT X1, INT Y1, DBL Time )
+    {
+      std::string Name = FileName(Key, X0, Y0, X1, Y1), Tmp = Name + ".tmp";
+      tile_header h {*(DWORD *)"GTIL", Version, X0, Y0, X1, Y1, Key, Time};
+      std::vector<DWORD> rows((size_t)Frm.W * (Y1 - Y0));
+      std::error_code ec;
+
+      Frm.GetPixels(rows.data(), Y0, Y1);
+      {
+        std::ofstream f(Tmp, std::ios::binary);
+
+        f.write((const CHAR *)&h, sizeof(h));
+        for (INT y = 0; y < Y1 - Y0; y++)
+          f.write((const CHAR *)&rows[(size_t)y * Frm.W + X0], (X1 - X0) * sizeof(DWORD));
+        if (!f)
+          return;
+      }
+      std::filesystem::rename(Tmp, Name, ec);
+      if (!ec)
+        BytesWritten += sizeof(h) + (size_t)(X1 - X0) * (Y1 - Y0) * sizeof(DWORD);
+    } /* End of 'Store' function */
+
+  public:
+    /* Obtain render key function.
+     * ARGUMENTS:
+     *   - scene to render:
+     *       rt::scene &Scene;
+     *   - camera:
+     *       const camera &Cam;
+     *   - samples per pixel:
+     *       INT Samples;
+     * RETURNS:
+     *   (UINT64) render key (0 if scene can't be hashed).
+     */
+    UINT64 Key( rt::scene &Scene, const camera &Cam, INT Samples )
+    {
+      hasher H;
+
+      H << Version;
+      if (!Scene.Hash(H))
+        return 0;
+      H << Cam.Loc << Cam.Dir << Cam.Up << Cam.Right << Cam.ProjDist << Cam.FarClip << Cam.Size <<
+        Cam.Wp << Cam.Hp << Cam.FrameW << Cam.FrameH << Samples;
+      return max(H.Value(), 1ULL);
+    } /* End of 'Key' function */
+
+    /* Render frame rectangle with cache function.
+     * Strips found in cache are loaded, others are rendered and stored.
+     * ARGUMENTS:
+     *   - render key (see 'Key', 0 to render without cache):
+     *       UINT64 RenderKey;
+     *   - scene to render:
+     *       rt::scene &Scene;
+     *   - frame to render to (camera frame size should match):
+     *       frame &Frm;
+     *   - camera:
+     *       camera &Cam;
+     *   - render threads count:
+     *       INT ThreadCount;
+     *   - rectangle corners (X1, Y1 are excluded, clipped by frame):
+     *       INT X0, Y0, X1, Y1;
+     *   - samples per pixel:
+     *       INT Samples;
+     * RETURNS:
+     *   (cost) rendered strips tracing cost.
+     */
+    cost RenderRect( UINT64 RenderKey, rt::scene &Scene, frame &Frm, camera &Cam, INT ThreadCount,
+                     INT X0, INT Y0, INT X1, INT Y1, INT Samples = 1 )
+    {
+      timeline_scope ts("cached render");
+      cost Total;
+      std::error_code ec;
+
+      if (RenderKey == 0)
+      {
+        Unhashed++;
+        return Scene.RenderRect(Frm, Cam, ThreadCount, X0, Y0, X1, Y1, Samples);
+      }
+      X0 = max(X0, 0), Y0 = max(Y0, 0);
+      X1 = min(X1, Frm.W), Y1 = min(Y1, Frm.H);
+      std::filesystem::create_directories(Dir, ec);
+      for (INT y = Y0; y < Y1 && !Scene.IsToBeStop; y += StripH)
+      {
+        INT y1 = min(y + StripH, Y1);
+
+        if (Load(RenderKey, Frm, X0, y, X1, y1))
+        {
+          Hits++;
+          continue;
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        cost c = Scene.RenderRect(Frm, Cam, ThreadCount, X0, y, X1, y1, Samples);
+
+        Total.Tests += c.Tests;
+        Total.Rays += c.Rays;
+        // Stopped strip is not complete
+        if (Scene.IsToBeStop)
+          break;
+        Misses++;
+        Store(RenderKey, Frm, X0, y, X1, y1,
+          std::chrono::duration<DBL>(std::chrono::steady_clock::now() - t0).count());
+      }
+      return Total;
+    } /* End of 'RenderRect' function */
+
+    /* Render frame with cache function.
+     * ARGUMENTS:
+     *   - scene to render:
+     *       rt::scene &Scene;
+     *   - frame to render to (camera frame size should match):
+     *       frame &Frm;
+     *   - camera:
+     *       camera &Cam;
+     *   - render threads count:
+     *       INT ThreadCount;
+     * RETURNS:
+     *   (cost) rendered strips tracing cost.
+     */
+    cost Render( rt::scene &Scene, frame &Frm, camera &Cam, INT ThreadCount )
+    {
+      INT samples = Scene.IsPath ? Scene.PathSamples : 1;
+
+      // Per frame data as in 'rt::scene::Render'
+      Scene.Caustics.Clear();
+      if (!Scene.IsIrrCacheKeep)
+        Scene.Irr.Clear();
+      return RenderRect(Key(Scene, Cam, samples), Scene, Frm, Cam, ThreadCount, 0, 0, Frm.W, Frm.H, samples);
+    } /* End of 'Render' function */
+
+    /* Print statistics function (stream format state is kept).
+     * ARGUMENTS:
+     *   - output stream:
+     *       std::ostream &Out;
+     * RETURNS: None.
+     */
+    VOID Print( std::ostream &Out ) const
+    {
+      std::ios_base::fmtflags flags = Out.flags();
+      std::streamsize prec = Out.precision();
+
+      Out << std::fixed << std::setprecision(1) << "Render cache " << Dir << ": " << Hits << " hits, " << Misses <<
+        " misses (" << (Hits + Misses > 0 ? Hits * 100.0 / (Hits + Misses) : 0) << "% hit rate), " <<
+        std::setprecision(2) << SavedTime << " s of tracing saved, " <<
+        BytesRead / (1024.0 * 1024.0) << " MB read, " << BytesWritten / (1024.0 * 1024.0) << " MB written";
+      if (Unhashed > 0)
+        Out << ", " << Unhashed << " renders not cached (scene can't be hashed)";
+      Out << std::endl;
+      Out.flags(flags);
+      Out.precision(prec);
+    } /* End of 'Print' function */
+  }; /* End of 'render_cache' class */
+} /* end of 'gort' namespace */
+
+#endif /* __rcache_h_ */
+
+/* END OF 'rcache.h' FILE */
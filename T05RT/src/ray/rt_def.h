@@ -8,7 +8,7 @@
  *               Raytracing default declaration module.
  * PROGRAMMER  : CGSG-SummerCamp'2024.
  *               Vladislav A. Golubov (VG6).
- * LAST UPDATE : 27.07.2024.
+ * LAST UPDATE : 19.10.2026.
  * NOTE        : None.
  *
  * No part of this file may be changed without agreement of
@@ -18,14 +18,34 @@
 #ifndef __tr_def_h_
 #define __tr_def_h_
 #include "def.h"
+#include "memory.h"
+#include "hash.h"
 
 #include <vector>
+#include <map>
+#include <string>
+#include <deque>
 
 /* Application namespace. */
 namespace gort
 {
   const DBL Threshold = 0.0000001;
   class shape;
+  class thread_pool;
+
+  /* Shape reference (type, index) handle */
+  struct shape_ref
+  {
+    enum TYPE : DWORD
+    {
+      Custom,   // Heap shape, see 'intr::Shp'
+      Sphere,   // 'flat_shapes' typed arrays
+      Box,
+      Plane,
+      Triangle,
+    } Type = Custom;
+    DWORD Index = 0; // Typed array index
+  }; /* End of 'shape_ref' structure */
 
   /* intr class */
   class intr
@@ -34,12 +54,13 @@ namespace gort
     DBL T;      // Intersection ray distance
     vec3 N;     // Intersection normal
     vec3 P;     // Point of inntersection
-    shape *Shp; // Intersected shape
+    shape *Shp; // Intersected shape (custom shapes only)
+    shape_ref Ref; // Intersected shape reference
     INT I[5];   // Addon information
     DBL D[5];   // Addon information
     vec3 V[5];   // Addon information
-    BOOL IsP;
-    BOOL IsN;
+    BOOL IsP = FALSE;
+    BOOL IsN = FALSE;
     BOOL IsPlane = FALSE;
     enum ENTER_TYPE
     {
@@ -60,8 +81,8 @@ namespace gort
   class envi
   {
   public:
-    DBL RefractionCoef;  // Refraction coefficient
-    DBL Decay;           // Environment media decay coefficient
+    DBL RefractionCoef = 1; // Refraction coefficient
+    DBL Decay = 0;          // Environment media decay coefficient
   }; /* End of 'envi' class */
 
   /* light info class */
@@ -73,6 +94,15 @@ namespace gort
     DBL Dist;
   }; /* End of 'light_info' class */
 
+  /* Light surface sample structure (see 'light::SampleSurface') */
+  struct light_sample
+  {
+    vec3 P;   // Light surface point
+    vec3 N;   // Light surface normal
+    vec3 Le;  // Emitted radiance
+    DBL PdfA; // Sample density by light area
+  }; /* End of 'light_sample' structure */
+
   /* light class */
   class light
   {
@@ -80,6 +110,8 @@ namespace gort
   public:
     DBL Cc, Cl, Cq;
     vec3 Color;
+    INT Strata = 0; // Area light maximal strata per side (0 for point/direction lights)
+
     /* Shading pixel function
      * ARGUMENTS:
      *   - possition
@@ -93,6 +125,83 @@ namespace gort
     {
       return 0;
     }
+
+    /* Area light sample shading function.
+     * ARGUMENTS:
+     *   - shading point:
+     *       const vec3 &P;
+     *   - sample position on light:
+     *       DBL U, V;
+     *   - light to do shade ('L' is directed to light sample):
+     *       light_info *L;
+     * RETURN:
+     *   (DBL) Shading coefficient.
+     */
+    virtual DBL Sample( const vec3 &P, DBL U, DBL V, light_info *L )
+    {
+      return Shadow(P, L);
+    } /* End of 'Sample' function */
+
+    /* Sample light surface for path tracing function.
+     * Point lights have no surface, they are shaded by 'Shadow'.
+     * ARGUMENTS:
+     *   - shading point:
+     *       const vec3 &From;
+     *   - sample position on light:
+     *       DBL U, V;
+     *   - result sample:
+     *       light_sample *S;
+     * RETURN:
+     *   (BOOL) TRUE if light has surface, FALSE otherwise.
+     */
+    virtual BOOL SampleSurface( const vec3 &From, DBL U, DBL V, light_sample *S )
+    {
+      return FALSE;
+    } /* End of 'SampleSurface' function */
+
+    /* Intersect light surface by ray function.
+     * ARGUMENTS:
+     *   - ray to intersect:
+     *       const ray &R;
+     *   - result hit distance:
+     *       DBL *T;
+     *   - result hit point sample (density is for ray origin as 'From'):
+     *       light_sample *S;
+     * RETURN:
+     *   (BOOL) TRUE if light is hit, FALSE otherwise.
+     */
+    virtual BOOL HitSurface( const ray &R, DBL *T, light_sample *S )
+    {
+      return FALSE;
+    } /* End of 'HitSurface' function */
+
+    /* Emit photon function.
+     * ARGUMENTS:
+     *   - emission samples in [0, 1) square (position and direction):
+     *       DBL U1, V1, U2, V2;
+     *   - result photon ray:
+     *       ray *R;
+     *   - result light total flux:
+     *       vec3 *Flux;
+     * RETURN:
+     *   (BOOL) TRUE if photon is emitted, FALSE if light has no photons.
+     */
+    virtual BOOL EmitPhoton( DBL U1, DBL V1, DBL U2, DBL V2, ray *R, vec3 *Flux )
+    {
+      return FALSE;
+    } /* End of 'EmitPhoton' function */
+
+    /* Hash light parameters function.
+     * ARGUMENTS:
+     *   - hash to add to:
+     *       hasher &H;
+     * RETURN:
+     *   (BOOL) TRUE if light is hashed, FALSE if light can't be hashed (default).
+     */
+    virtual BOOL Hash( hasher &H ) const
+    {
+      return FALSE;
+    } /* End of 'Hash' function */
   }; /* End of 'light' class */
 
   /* Shading coefficient store class */
@@ -176,6 +285,16 @@ namespace gort
     } /* End of 'operator color' function */
   };
 
+  /* Shading kernel feature bits (see 'rt::scene::ShadeKernel') */
+  enum SHADE_KERNEL : DWORD
+  {
+    ShadeSpecular    = 1,  // Phong highlight ('Ks' is used)
+    ShadeMirror      = 2,  // Reflected ray ('Kr' is used)
+    ShadeDielectric  = 4,  // Refracted ray ('Kt' is used)
+    ShadeChecker     = 8,  // Procedural checker ambient (planes)
+    ShadeKernelCount = 16, // Kernels count (all bits combinations)
+  }; /* End of 'SHADE_KERNEL' enum */
+
     /* Surface material store class */
   class surface
   {
@@ -186,6 +305,18 @@ namespace gort
     DBL Ph = 47;
     // Secondary rays coefficients
     coef Kr {0}, Kt {0};
+
+    /* Select material shading kernel function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (DWORD) 'SHADE_KERNEL' bits (without shape dependent 'ShadeChecker').
+     */
+    DWORD Kernel( VOID ) const
+    {
+      return (Ks.IsUsage ? ShadeSpecular : 0) |
+             (Kr.IsUsage ? ShadeMirror : 0) |
+             (Kt.IsUsage ? ShadeDielectric : 0);
+    } /* End of 'Kernel' function */
   }; /* End of 'surface' class */
 
   /* Shade information struct */
@@ -199,15 +330,174 @@ namespace gort
     envi Media;
     vec3 Du, Dv;
   };
+  /* Tracing cost counters class */
+  class cost
+  {
+  public:
+    UINT64 Tests = 0;    // Shape intersection tests count
+    UINT64 Rays = 0;     // Traced rays count (primary, secondary and shadow)
+    size_t HitBytes = 0; // Largest hit list memory in bytes (see 'rt::scene::AllIntersect')
+  }; /* End of 'cost' class */
+
   /* Set intr_list container */
   typedef stock<intr> intr_list;
 
+  /* Scene material table class.
+   * Shapes keep record number only, equal records are merged on addition.
+   * Records stay in place while table grows (deque storage), they are
+   * added and changed between renders by scene owner. Record shading
+   * kernel is selected by each setter, so table is always ready to render.
+   */
+  class mtl_table
+  {
+    std::map<std::string, DWORD> Nums; // Record key to number map
+
+    /* Build record key function.
+     * Key is built from values only, 'coef' has padding bytes.
+     * ARGUMENTS:
+     *   - record surface and media:
+     *       const surface &Surf;
+     *       const envi &Media;
+     *   - result key values:
+     *       DBL *Key;
+     * RETURNS: None.
+     */
+    static VOID MakeKey( const surface &Surf, const envi &Media, DBL *Key )
+    {
+      const coef *c[5] = {&Surf.Ka, &Surf.Kd, &Surf.Ks, &Surf.Kr, &Surf.Kt};
+
+      for (INT i = 0; i < 5; i++)
+        for (INT k = 0; k < 3; k++)
+          Key[i * 3 + k] = c[i]->K[k];
+      Key[15] = Surf.Ph;
+      Key[16] = Media.RefractionCoef;
+      Key[17] = Media.Decay;
+    } /* End of 'MakeKey' function */
+
+  public:
+    std::deque<surface> Surfs; // Records surfaces
+    std::deque<envi> Medias;   // Records media
+    std::deque<DWORD> Kernels; // Records shading kernels (see 'SHADE_KERNEL')
+
+    /* Class constructor (default record is added).
+     * ARGUMENTS: None.
+     */
+    mtl_table( VOID )
+    {
+      Clear();
+    } /* End of 'mtl_table' function */
+
+    /* Remove all records except default one function.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID Clear( VOID )
+    {
+      Nums.clear();
+      Surfs.clear();
+      Medias.clear();
+      Kernels.clear();
+      Add(surface(), envi());
+    } /* End of 'Clear' function */
+
+    /* Obtain records count function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (size_t) records count (default record included).
+     */
+    size_t Size( VOID ) const
+    {
+      return Surfs.size();
+    } /* End of 'Size' function */
+
+    /* Add material record function.
+     * ARGUMENTS:
+     *   - record surface and media (default media if not given):
+     *       const surface &Surf;
+     *       const envi &Media;
+     * RETURNS:
+     *   (DWORD) record number (0 is default surface and media).
+     */
+    DWORD Add( const surface &Surf, const envi &Media = envi() )
+    {
+      DBL key[18];
+
+      MakeKey(Surf, Media, key);
+      auto [it, is_new] = Nums.emplace(std::string((const CHAR *)key, sizeof(key)), (DWORD)Surfs.size());
+
+      if (is_new)
+      {
+        Kernels.push_back(Surf.Kernel());
+        Surfs.push_back(Surf);
+        Medias.push_back(Media);
+      }
+      return it->second;
+    } /* End of 'Add' function */
+
+    /* Change material record function.
+     * All shapes with this record number get new material.
+     * ARGUMENTS:
+     *   - record number:
+     *       DWORD No;
+     *   - new record surface and media:
+     *       const surface &Surf;
+     *       const envi &Media;
+     * RETURNS: None.
+     */
+    VOID Set( DWORD No, const surface &Surf, const envi &Media )
+    {
+      DBL key[18];
+
+      if (No >= Surfs.size())
+        return;
+      MakeKey(Surfs[No], Medias[No], key);
+      if (auto it = Nums.find(std::string((const CHAR *)key, sizeof(key))); it != Nums.end() && it->second == No)
+        Nums.erase(it);
+      Surfs[No] = Surf;
+      Medias[No] = Media;
+      Kernels[No] = Surf.Kernel();
+      MakeKey(Surf, Media, key);
+      Nums.emplace(std::string((const CHAR *)key, sizeof(key)), No);
+    } /* End of 'Set' function */
+
+    /* Hash all records values function.
+     * ARGUMENTS:
+     *   - hash to add to:
+     *       hasher &H;
+     * RETURNS: None.
+     */
+    VOID Hash( hasher &H ) const
+    {
+      DBL key[18];
+
+      H << Surfs.size();
+      for (size_t i = 0; i < Surfs.size(); i++)
+      {
+        MakeKey(Surfs[i], Medias[i], key);
+        H << key;
+      }
+    } /* End of 'Hash' function */
+
+    /* Account table memory function.
+     * ARGUMENTS:
+     *   - report to fill:
+     *       mem_report &Rep;
+     * RETURNS: None.
+     */
+    VOID Account( mem_report &Rep ) const
+    {
+      // Map node is key string, number and tree links
+      Rep.Add("scene", "materials", Surfs.size(),
+        Surfs.size() * (sizeof(surface) + sizeof(envi) + sizeof(DWORD)) +
+        Nums.size() * (sizeof(std::pair<const std::string, DWORD>) + sizeof(DBL) * 18 + 4 * sizeof(VOID *)));
+    } /* End of 'Account' function */
+  }; /* End of 'mtl_table' class */
+
   /* Shape class */
   class shape
   {
   public:
-    envi Media;
-    surface Material;
+    DWORD Mtl = 0; // Scene material table record number (see 'rt::scene::Mtls')
     virtual ~shape( VOID );
     virtual BOOL Intersect( const ray &R, intr *Intr );
     virtual VOID GetNormal( intr *in );
@@ -223,11 +513,81 @@ namespace gort
     {
       return 0;
     }
-    VOID SetEnvi( const DBL Dec, const DBL RefrCoef )
+
+    /* Obtain shape bound box function.
+     * ARGUMENTS:
+     *   - result box corners:
+     *       vec3 *Min, *Max;
+     * RETURNS:
+     *   (BOOL) TRUE if shape is bounded, FALSE otherwise (default).
+     */
+    virtual BOOL GetBound( vec3 *Min, vec3 *Max ) const
     {
-      Media.Decay = Dec;
-      Media.RefractionCoef = RefrCoef;
-    }
+      return FALSE;
+    } /* End of 'GetBound' function */
+
+    /* Place shape by transform of its rest pose function.
+     * Rest pose is shape geometry at first call, 'Refit' should be
+     * called after shapes are placed. Flattened shapes (see
+     * 'rt::scene::Flatten') are not in shapes list, so they are static.
+     * ARGUMENTS:
+     *   - rest pose to world transform (rotation and translation):
+     *       const matr &M;
+     * RETURNS:
+     *   (BOOL) TRUE if shape is moved, FALSE otherwise (default, shape is static).
+     */
+    virtual BOOL SetTransform( const matr &M )
+    {
+      return FALSE;
+    } /* End of 'SetTransform' function */
+
+    /* Update shape acceleration data after shape change function.
+     * ARGUMENTS:
+     *   - workers pool and workers count:
+     *       thread_pool &Pool;
+     *       INT ThreadCount;
+     * RETURNS:
+     *   (BOOL) TRUE if data is rebuilt, FALSE otherwise (default, nothing to update).
+     */
+    virtual BOOL Refit( thread_pool &Pool, INT ThreadCount )
+    {
+      return FALSE;
+    } /* End of 'Refit' function */
+
+    /* Account shape memory function.
+     * ARGUMENTS:
+     *   - report to fill:
+     *       mem_report &Rep;
+     * RETURNS: None.
+     */
+    virtual VOID Account( mem_report &Rep ) const
+    {
+      Rep.Add("shapes", "custom", 1, sizeof(shape));
+    } /* End of 'Account' function */
+
+    /* Hash shape geometry and materials function.
+     * ARGUMENTS:
+     *   - hash to add to:
+     *       hasher &H;
+     * RETURNS:
+     *   (BOOL) TRUE if shape is hashed, FALSE if shape can't be hashed (default).
+     */
+    virtual BOOL Hash( hasher &H ) const
+    {
+      return FALSE;
+    } /* End of 'Hash' function */
+
+    /* Obtain intersection point material number function.
+     * ARGUMENTS:
+     *   - intersection data:
+     *       const intr &In;
+     * RETURNS:
+     *   (DWORD) scene material table record number (shape one by default).
+     */
+    virtual DWORD MtlNo( const intr &In ) const
+    {
+      return Mtl;
+    } /* End of 'MtlNo' function */
   } ; /* End of 'shape' class*/
 
 }
@@ -0,0 +1,692 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : rt_flat.h
+ * PURPOSE     : Raytracing project.
+ *               Typed shape arrays module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : Spheres, boxes, planes and triangles are stored by
+ *               value in per type arrays and intersected in plain
+ *               loops without virtual calls. Shapes are referenced
+ *               by 'shape_ref' (type, index) handles. Arrays can view
+ *               records in place (memory mapped snapshot tables, see
+ *               'flat_shapes::Attach'), viewed array is copied to own
+ *               storage on first change only.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#ifndef __rt_flat_h_
+#define __rt_flat_h_
+
+#include <map>
+#include <memory>
+#include <string>
+#include "rt_def.h"
+#include "shp/shapes.h"
+
+/* Project namespace */
+namespace gort
+{
+  /* Material record (surface and media) */
+  struct flat_mtl
+  {
+    vec3 Ka, Kd, Ks, Kr, Kt;   // Shading coefficients
+    DBL Ph;                    // Phong power
+    DBL Decay, RefractionCoef; // Shape media
+  }; /* End of 'flat_mtl' structure */
+
+  /* Sphere record */
+  struct flat_sphere
+  {
+    vec3 C;         // Center
+    DBL R;          // Radius
+    DWORD Mtl, Pad; // Material number
+  }; /* End of 'flat_sphere' structure */
+
+  /* Box record */
+  struct flat_box
+  {
+    vec3 B1, B2;    // Box corners
+    DWORD Mtl, Pad; // Material number
+  }; /* End of 'flat_box' structure */
+
+  /* Plane record */
+  struct flat_plane
+  {
+    vec3 P, N;      // Plane point and normal
+    DWORD Mtl, Pad; // Material number
+  }; /* End of 'flat_plane' structure */
+
+  /* Triangle record */
+  struct flat_triangle
+  {
+    // Intersection data (see 'triangle' class)
+    vec3 N, U1, V1;
+    DBL D, u0, v0;
+    // Source vertices and normals
+    vec3 P[3], Ns[3];
+    DWORD Mtl, Pad; // Material number
+
+    /* Build triangle record function.
+     * ARGUMENTS:
+     *   - vertex positions:
+     *       const vec3 &P0, &P1, &P2;
+     *   - vertex normals:
+     *       const vec3 &N0, &N1, &N2;
+     *   - material number:
+     *       DWORD MtlNo;
+     * RETURNS:
+     *   (flat_triangle) triangle record.
+     */
+    static flat_triangle Make( const vec3 &P0, const vec3 &P1, const vec3 &P2,
+                               const vec3 &N0, const vec3 &N1, const vec3 &N2, DWORD MtlNo )
+    {
+      flat_triangle t;
+      vec3 S1 = P1 - P0, S2 = P2 - P0;
+
+      t.N = (S1 % S2).Normalizing();
+      t.D = t.N & P0;
+      t.U1 = (S1 * (S2 & S2) - S2 * (S1 & S2)) / (((S1 & S1) * (S2 & S2)) - (S1 & S2) * (S1 & S2));
+      t.u0 = P0 & t.U1;
+      t.V1 = (S2 * (S1 & S1) - (S1 * (S1 & S2))) / (((S2 & S2) * (S1 & S1)) - ((S1 & S2) * (S1 & S2)));
+      t.v0 = P0 & t.V1;
+      t.P[0] = P0, t.P[1] = P1, t.P[2] = P2;
+      t.Ns[0] = N0, t.Ns[1] = N1, t.Ns[2] = N2;
+      t.Mtl = MtlNo;
+      t.Pad = 0;
+      return t;
+    } /* End of 'Make' function */
+  }; /* End of 'flat_triangle' structure */
+
+  /* Owned or viewed in place records array class */
+  template<typename Type>
+    class flat_array
+    {
+      stock<Type> Own;            // Owned records
+      const Type *View = nullptr; // Viewed records (nullptr if records are owned)
+      size_t ViewSize = 0;        // Viewed records count
+
+      /* Copy viewed records to own storage function.
+       * ARGUMENTS: None.
+       * RETURNS: None.
+       */
+      VOID Detach( VOID )
+      {
+        if (View == nullptr)
+          return;
+        Own.assign(View, View + ViewSize);
+        View = nullptr;
+        ViewSize = 0;
+      } /* End of 'Detach' function */
+
+    public:
+      using value_type = Type;
+
+      /* View records in place function.
+       * Records memory should live while array is used (see 'flat_shapes::Source').
+       * ARGUMENTS:
+       *   - records and their count:
+       *       const Type *Recs;
+       *       size_t Count;
+       * RETURNS: None.
+       */
+      VOID Attach( const Type *Recs, size_t Count )
+      {
+        stock<Type>().swap(Own);
+        View = Recs;
+        ViewSize = Count;
+      } /* End of 'Attach' function */
+
+      /* Obtain records view flag function.
+       * ARGUMENTS: None.
+       * RETURNS:
+       *   (BOOL) TRUE if records are viewed in place, FALSE if owned.
+       */
+      BOOL IsView( VOID ) const
+      {
+        return View != nullptr;
+      } /* End of 'IsView' function */
+
+      /* Obtain records count function.
+       * ARGUMENTS: None.
+       * RETURNS:
+       *   (size_t) records count.
+       */
+      size_t size( VOID ) const
+      {
+        return View != nullptr ? ViewSize : Own.size();
+      } /* End of 'size' function */
+
+      /* Check array emptiness function.
+       * ARGUMENTS: None.
+       * RETURNS:
+       *   (BOOL) TRUE if there are no records, FALSE otherwise.
+       */
+      BOOL empty( VOID ) const
+      {
+        return size() == 0;
+      } /* End of 'empty' function */
+
+      /* Obtain records pointer function.
+       * ARGUMENTS: None.
+       * RETURNS:
+       *   (const Type *) records.
+       */
+      const Type * data( VOID ) const
+      {
+        return View != nullptr ? View : Own.data();
+      } /* End of 'data' function */
+
+      /* Obtain record function.
+       * ARGUMENTS:
+       *   - record index:
+       *       size_t Index;
+       * RETURNS:
+       *   (const Type &) record.
+       */
+      const Type & operator[]( size_t Index ) const
+      {
+        return data()[Index];
+      } /* End of 'operator[]' function */
+
+      /* Obtain records range bounds functions.
+       * ARGUMENTS: None.
+       * RETURNS:
+       *   (const Type *) first and after last records.
+       */
+      const Type * begin( VOID ) const
+      {
+        return data();
+      } /* End of 'begin' function */
+      const Type * end( VOID ) const
+      {
+        return data() + size();
+      } /* End of 'end' function */
+
+      /* Add record function (viewed records are copied first).
+       * ARGUMENTS:
+       *   - record to add:
+       *       const Type &X;
+       * RETURNS:
+       *   (flat_array &) this array.
+       */
+      flat_array & operator<<( const Type &X )
+      {
+        Detach();
+        Own << X;
+        return *this;
+      } /* End of 'operator<<' function */
+
+      /* Reserve records memory function (viewed records are copied first).
+       * ARGUMENTS:
+       *   - records count:
+       *       size_t Count;
+       * RETURNS: None.
+       */
+      VOID reserve( size_t Count )
+      {
+        Detach();
+        Own.reserve(Count);
+      } /* End of 'reserve' function */
+
+      /* Remove all records function.
+       * ARGUMENTS: None.
+       * RETURNS: None.
+       */
+      VOID clear( VOID )
+      {
+        Own.clear();
+        View = nullptr;
+        ViewSize = 0;
+      } /* End of 'clear' function */
+
+      /* Obtain own records memory function.
+       * ARGUMENTS: None.
+       * RETURNS:
+       *   (size_t) allocated memory in bytes (viewed records are not counted).
+       */
+      size_t Memory( VOID ) const
+      {
+        return mem_report::Of(Own);
+      } /* End of 'Memory' function */
+
+      /* Obtain viewed records memory function.
+       * ARGUMENTS: None.
+       * RETURNS:
+       *   (size_t) viewed records size in bytes.
+       */
+      size_t Mapped( VOID ) const
+      {
+        return ViewSize * sizeof(Type);
+      } /* End of 'Mapped' function */
+
+      /* Add records to hash function (count is hashed too).
+       * ARGUMENTS:
+       *   - hash accumulator:
+       *       hasher &H;
+       * RETURNS: None.
+       */
+      VOID Hash( hasher &H ) const
+      {
+        H << size();
+        H.Add(data(), size() * sizeof(Type));
+      } /* End of 'Hash' function */
+    }; /* End of 'flat_array' class */
+
+  /* Typed shape arrays class */
+  class flat_shapes
+  {
+  public:
+    flat_array<flat_sphere> Spheres;     // Spheres array
+    flat_array<flat_box> Boxes;          // Boxes array
+    flat_array<flat_plane> Planes;       // Planes array
+    flat_array<flat_triangle> Triangles; // Triangles array
+    std::shared_ptr<VOID> Source;        // Viewed records owner (mapped snapshot, see 'Attach')
+
+    /* Obtain shapes count function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (size_t) all arrays shapes count.
+     */
+    size_t Size( VOID ) const
+    {
+      return Spheres.size() + Boxes.size() + Planes.size() + Triangles.size();
+    } /* End of 'Size' function */
+
+    /* Clear all arrays function.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID Clear( VOID )
+    {
+      Spheres.clear();
+      Boxes.clear();
+      Planes.clear();
+      Triangles.clear();
+      Source.reset();
+    } /* End of 'Clear' function */
+
+    /* View records in place function.
+     * Arrays should be empty, records material numbers should be valid
+     * scene material table records (records are not patched). Viewed
+     * arrays are copied on first change.
+     * ARGUMENTS:
+     *   - records memory owner (kept while arrays are used):
+     *       const std::shared_ptr<VOID> &Owner;
+     *   - records and their counts:
+     *       const flat_sphere *S; size_t NumOfS;
+     *       const flat_box *B; size_t NumOfB;
+     *       const flat_plane *P; size_t NumOfP;
+     *       const flat_triangle *T; size_t NumOfT;
+     * RETURNS: None.
+     */
+    VOID Attach( const std::shared_ptr<VOID> &Owner,
+                 const flat_sphere *S, size_t NumOfS, const flat_box *B, size_t NumOfB,
+                 const flat_plane *P, size_t NumOfP, const flat_triangle *T, size_t NumOfT )
+    {
+      Clear();
+      Source = Owner;
+      Spheres.Attach(S, NumOfS);
+      Boxes.Attach(B, NumOfB);
+      Planes.Attach(P, NumOfP);
+      Triangles.Attach(T, NumOfT);
+    } /* End of 'Attach' function */
+
+    /* Add arrays to hash function.
+     * ARGUMENTS:
+     *   - hash accumulator:
+     *       hasher &H;
+     * RETURNS: None.
+     */
+    VOID Hash( hasher &H ) const
+    {
+      Spheres.Hash(H);
+      Boxes.Hash(H);
+      Planes.Hash(H);
+      Triangles.Hash(H);
+    } /* End of 'Hash' function */
+
+    /* Account arrays memory function.
+     * ARGUMENTS:
+     *   - report to fill:
+     *       mem_report &Rep;
+     * RETURNS: None.
+     */
+    VOID Account( mem_report &Rep ) const
+    {
+      Rep.Add("flat", "spheres", Spheres.size(), Spheres.Memory());
+      Rep.Add("flat", "boxes", Boxes.size(), Boxes.Memory());
+      Rep.Add("flat", "planes", Planes.size(), Planes.Memory());
+      Rep.Add("flat", "triangles", Triangles.size(), Triangles.Memory());
+      // Viewed records are file pages shared by processes mapping same snapshot
+      if (Source != nullptr)
+        Rep.Add("mapped", "snapshot tables",
+          Spheres.size() + Boxes.size() + Planes.size() + Triangles.size(),
+          Spheres.Mapped() + Boxes.Mapped() + Planes.Mapped() + Triangles.Mapped());
+    } /* End of 'Account' function */
+
+    /* Build material record function.
+     * ARGUMENTS:
+     *   - shape surface and media:
+     *       const surface &Surf;
+     *       const envi &Media;
+     * RETURNS:
+     *   (flat_mtl) material record.
+     */
+    static flat_mtl MakeMtl( const surface &Surf, const envi &Media )
+    {
+      flat_mtl m {};
+
+      m.Ka = Surf.Ka;
+      m.Kd = Surf.Kd;
+      m.Ks = Surf.Ks;
+      m.Kr = Surf.Kr;
+      m.Kt = Surf.Kt;
+      m.Ph = Surf.Ph;
+      m.Decay = Media.Decay;
+      m.RefractionCoef = Media.RefractionCoef;
+      return m;
+    } /* End of 'MakeMtl' function */
+
+    /* Add material record to scene material table function.
+     * ARGUMENTS:
+     *   - table to add to:
+     *       mtl_table &Mtls;
+     *   - material record:
+     *       const flat_mtl &M;
+     * RETURNS:
+     *   (DWORD) table record number (equal records are merged).
+     */
+    static DWORD AddMtl( mtl_table &Mtls, const flat_mtl &M )
+    {
+      surface s;
+
+      s.Ka = M.Ka;
+      s.Kd = M.Kd;
+      s.Ks = M.Ks;
+      s.Kr = M.Kr;
+      s.Kt = M.Kt;
+      s.Ph = M.Ph;
+      return Mtls.Add(s, envi {M.RefractionCoef, M.Decay});
+    } /* End of 'AddMtl' function */
+
+    /* Move shape to typed arrays function.
+     * Material number is kept (same scene material table).
+     * ARGUMENTS:
+     *   - shape to add:
+     *       const shape *Shp;
+     * RETURNS:
+     *   (BOOL) TRUE if shape is stored (caller can delete it), FALSE for custom shapes.
+     */
+    BOOL Add( const shape *Shp )
+    {
+      if (auto *s = dynamic_cast<const sphere *>(Shp); s != nullptr)
+        Spheres << flat_sphere {s->C, s->R, s->Mtl};
+      else if (auto *b = dynamic_cast<const box *>(Shp); b != nullptr)
+        Boxes << flat_box {b->B1, b->B2, b->Mtl};
+      else if (auto *p = dynamic_cast<const plane *>(Shp); p != nullptr)
+        Planes << flat_plane {p->P, p->N, p->Mtl};
+      else if (auto *t = dynamic_cast<const triangle *>(Shp); t != nullptr)
+        Triangles << flat_triangle::Make(t->P0, t->P1, t->P2, t->N1, t->N2, t->N3, t->Mtl);
+      else
+        return FALSE;
+      return TRUE;
+    } /* End of 'Add' function */
+
+    /* Obtain shape material number function.
+     * ARGUMENTS:
+     *   - shape reference (not custom):
+     *       const shape_ref &Ref;
+     * RETURNS:
+     *   (DWORD) scene material table record number.
+     */
+    DWORD MtlNo( const shape_ref &Ref ) const
+    {
+      switch (Ref.Type)
+      {
+      case shape_ref::Sphere:
+        return Spheres[Ref.Index].Mtl;
+      case shape_ref::Box:
+        return Boxes[Ref.Index].Mtl;
+      case shape_ref::Plane:
+        return Planes[Ref.Index].Mtl;
+      default:
+        return Triangles[Ref.Index].Mtl;
+      }
+    } /* End of 'MtlNo' function */
+
+    /* Evaluate intersection normal function.
+     * ARGUMENTS:
+     *   - intersection data (with point evaluated):
+     *       intr *In;
+     * RETURNS: None.
+     */
+    VOID GetNormal( intr *In ) const
+    {
+      static const vec3 BoxN[6] =
+      {
+        vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0),
+        vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1)
+      };
+
+      switch (In->Ref.Type)
+      {
+      case shape_ref::Sphere:
+        In->N = (In->P - Spheres[In->Ref.Index].C) / Spheres[In->Ref.Index].R;
+        break;
+      case shape_ref::Box:
+        In->N = BoxN[In->I[0]];
+        break;
+      case shape_ref::Plane:
+        In->N = Planes[In->Ref.Index].N;
+        break;
+      case shape_ref::Triangle:
+        {
+          const flat_triangle &t = Triangles[In->Ref.Index];
+          In->N = t.Ns[0] * (1 - In->D[0] - In->D[1]) + t.Ns[1] * In->D[0] + t.Ns[2] * In->D[1];
+        }
+        break;
+      }
+      In->IsN = TRUE;
+    } /* End of 'GetNormal' function */
+
+    /* Box ray intersection function (same as 'box::Intersect').
+     * ARGUMENTS:
+     *   - ray to intersect:
+     *       const ray &R;
+     *   - box record:
+     *       const flat_box &B;
+     *   - result distance and face number:
+     *       DBL *T;
+     *       INT *Face;
+     * RETURNS:
+     *   (BOOL) TRUE if intersected, FALSE otherwise.
+     */
+    static BOOL BoxIntersect( const ray &R, const flat_box &B, DBL *T, INT *Face )
+    {
+      DBL tnear, tfar;
+      INT near_no, far_no;
+
+      if (!mth::Slab(R, B.B1, B.B2, &tnear, &tfar, &near_no, &far_no))
+        return FALSE;
+      *T = tnear > 0 ? tnear : tfar;
+      *Face = tnear > 0 ? near_no : far_no;
+      return TRUE;
+    } /* End of 'BoxIntersect' function */
+
+    /* Sphere ray intersection function (same as 'sphere::Intersect').
+     * ARGUMENTS:
+     *   - ray to intersect:
+     *       const ray &R;
+     *   - sphere record:
+     *       const flat_sphere &S;
+     *   - result distance:
+     *       DBL *T;
+     * RETURNS:
+     *   (BOOL) TRUE if intersected, FALSE otherwise.
+     */
+    static BOOL SphereIntersect( const ray &R, const flat_sphere &S, DBL *T )
+    {
+      vec3 a = S.C - R.Org;
+      DBL ok = a & R.Dir;
+
+      if (ok < 0)
+        return FALSE;
+      DBL oc2 = a & a, r2 = S.R * S.R, h2 = r2 - (oc2 - ok * ok);
+      if (oc2 < r2)
+        *T = ok + std::sqrt(h2);
+      else if (h2 < 0)
+        return FALSE;
+      else
+        *T = ok - std::sqrt(h2);
+      return TRUE;
+    } /* End of 'SphereIntersect' function */
+
+    /* Plane ray intersection function (same as 'plane::Intersect').
+     * ARGUMENTS:
+     *   - ray to intersect:
+     *       const ray &R;
+     *   - plane record:
+     *       const flat_plane &P;
+     *   - result distance:
+     *       DBL *T;
+     * RETURNS:
+     *   (BOOL) TRUE if intersected, FALSE otherwise.
+     */
+    static BOOL PlaneIntersect( const ray &R, const flat_plane &P, DBL *T )
+    {
+      DBL nd = P.N & R.Dir;
+
+      if (fabs(nd) <= Threshold)
+        return FALSE;
+      return (*T = ((P.P & P.N) - (P.N & R.Org)) / nd) >= Threshold;
+    } /* End of 'PlaneIntersect' function */
+
+    /* Triangle ray intersection function (same as 'triangle::Intersect').
+     * ARGUMENTS:
+     *   - ray to intersect:
+     *       const ray &R;
+     *   - triangle record:
+     *       const flat_triangle &Tr;
+     *   - result distance and barycentrics:
+     *       DBL *T, *U, *V;
+     * RETURNS:
+     *   (BOOL) TRUE if intersected, FALSE otherwise.
+     */
+    static BOOL TriangleIntersect( const ray &R, const flat_triangle &Tr, DBL *T, DBL *U, DBL *V )
+    {
+      DBL nd = Tr.N & R.Dir;
+
+      if (fabs(nd) <= Threshold)
+        return FALSE;
+      if ((*T = (Tr.D - (Tr.N & R.Org)) / nd) < Threshold)
+        return FALSE;
+      vec3 p = R(*T);
+      *U = (p & Tr.U1) - Tr.u0;
+      *V = (p & Tr.V1) - Tr.v0;
+      return *U >= 0 && *V >= 0 && *U + *V <= 1;
+    } /* End of 'TriangleIntersect' function */
+
+    /* Single shape ray intersection function.
+     * ARGUMENTS:
+     *   - ray to intersect:
+     *       const ray &R;
+     *   - shape reference (not custom):
+     *       const shape_ref &Ref;
+     *   - result intersection data (as filled by 'Walk'):
+     *       intr *In;
+     * RETURNS:
+     *   (BOOL) TRUE if intersected, FALSE otherwise.
+     */
+    BOOL Intersect( const ray &R, const shape_ref &Ref, intr *In ) const
+    {
+      In->Shp = nullptr;
+      In->Ref = Ref;
+      In->IsP = In->IsN = FALSE;
+      In->IsPlane = Ref.Type == shape_ref::Plane;
+      switch (Ref.Type)
+      {
+      case shape_ref::Sphere:
+        return SphereIntersect(R, Spheres[Ref.Index], &In->T);
+      case shape_ref::Box:
+        return BoxIntersect(R, Boxes[Ref.Index], &In->T, &In->I[0]);
+      case shape_ref::Plane:
+        return PlaneIntersect(R, Planes[Ref.Index], &In->T);
+      case shape_ref::Triangle:
+        return TriangleIntersect(R, Triangles[Ref.Index], &In->T, &In->D[0], &In->D[1]);
+      }
+      return FALSE;
+    } /* End of 'Intersect' function */
+
+    /* Walk all ray intersections function.
+     * ARGUMENTS:
+     *   - ray to intersect:
+     *       const ray &R;
+     *   - hit callback (BOOL Hit( const intr &In ), FALSE to stop walk):
+     *       HitFunc Hit;
+     * RETURNS:
+     *   (BOOL) FALSE if walk was stopped by callback, TRUE otherwise.
+     */
+    template<typename HitFunc>
+      BOOL Walk( const ray &R, HitFunc Hit ) const
+      {
+        intr in;
+
+        in.Shp = nullptr;
+        in.IsP = in.IsN = FALSE;
+
+        // Spheres
+        in.Ref.Type = shape_ref::Sphere;
+        for (DWORD i = 0, n = (DWORD)Spheres.size(); i < n; i++)
+          if (SphereIntersect(R, Spheres[i], &in.T))
+          {
+            in.Ref.Index = i;
+            if (!Hit(in))
+              return FALSE;
+          }
+
+        // Boxes
+        in.Ref.Type = shape_ref::Box;
+        for (DWORD i = 0, n = (DWORD)Boxes.size(); i < n; i++)
+          if (BoxIntersect(R, Boxes[i], &in.T, &in.I[0]))
+          {
+            in.Ref.Index = i;
+            if (!Hit(in))
+              return FALSE;
+          }
+
+        // Planes
+        in.Ref.Type = shape_ref::Plane;
+        in.IsPlane = TRUE;
+        for (DWORD i = 0, n = (DWORD)Planes.size(); i < n; i++)
+          if (PlaneIntersect(R, Planes[i], &in.T))
+          {
+            in.Ref.Index = i;
+            if (!Hit(in))
+              return FALSE;
+          }
+        in.IsPlane = FALSE;
+
+        // Triangles
+        in.Ref.Type = shape_ref::Triangle;
+        for (DWORD i = 0, n = (DWORD)Triangles.size(); i < n; i++)
+          if (TriangleIntersect(R, Triangles[i], &in.T, &in.D[0], &in.D[1]))
+          {
+            in.Ref.Index = i;
+            if (!Hit(in))
+              return FALSE;
+          }
+        return TRUE;
+      } /* End of 'Walk' function */
+  }; /* End of 'flat_shapes' class */
+} /* end of 'gort' namespace */
+
+#endif /* __rt_flat_h_ */
+
+/* END OF 'rt_flat.h' FILE */
@@ -0,0 +1,83 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : rt_irr.cpp
+ * PURPOSE     : Raytracing project.
+ *               Indirect diffuse lighting by irradiance cache module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : Record is one bounce: hemisphere rays are shaded by
+ *               Whitted shading without cache. Whitted shading adds
+ *               'Kd' times indirect irradiance at primary hits.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#include "gort.h"
+#include "rt_def.h"
+#include "rt_scene.h"
+
+/* Application namespace. */
+namespace gort
+{
+  /* Obtain indirect irradiance function.
+   * Cached value is interpolated, new record is sampled if
+   * point is not covered.
+   * ARGUMENTS:
+   *   - surface point and normal (faced to viewer):
+   *       const vec3 &P, &N;
+   *   - point media:
+   *       const envi &Media;
+   *   - ray weight:
+   *       DBL Weight;
+   * RETURNS:
+   *   (vec3) indirect irradiance.
+   */
+  vec3 rt::scene::Indirect( const vec3 &P, const vec3 &N, const envi &Media, DBL Weight )
+  {
+    vec3 E;
+
+    if (Irr.Lookup(P, N, &E))
+      return E;
+
+    // Cosine distributed hemisphere rays
+    vec3
+      a = fabs(N[0]) > 0.9 ? vec3(0, 1, 0) : vec3(1, 0, 0),
+      u = (N % a).Normalizing(),
+      v = u % N,
+      sum(0);
+    UINT seed = (UINT)(INT64)(P[0] * 7919.0 + P[1] * 104729.0 + P[2] * 1299709.0);
+    DBL inv_dist = 0;
+
+    for (INT i = 0; i < Irr.Rays; i++)
+    {
+      path_sampler smp(seed, i);
+      DBL su, sv;
+      intr in;
+
+      smp.Get2D(&su, &sv);
+
+      DBL r = sqrt(su), phi = 2 * PI * sv;
+      vec3 d = u * (r * cos(phi)) + v * (r * sin(phi)) + N * sqrt(max(0.0, 1 - su));
+      ray R(P + d * Threshold, d);
+
+      Cost.Rays++;
+      if (Intersect(R, &in))
+      {
+        sum += ShadeHit(R, &in, Media, Weight, 1);
+        inv_dist += 1 / max(in.T, Threshold);
+      }
+      else
+        sum += BkgColor;
+    }
+    E = sum * (PI / Irr.Rays);
+    Irr.Insert(P, N, E, inv_dist > 0 ? Irr.Rays / inv_dist : Irr.MaxR);
+    return E;
+  } /* End of 'rt::scene::Indirect' function */
+} /* end of 'gort' namespace */
+
+/* END OF 'rt_irr.cpp' FILE */
@@ -0,0 +1,276 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : rt_path.cpp
+ * PURPOSE     : Raytracing project.
+ *               Monte Carlo path tracing module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : Surface is Lambert diffuse ('Kd') plus normalized
+ *               Phong ('Ks', 'Ph') lobes with mirror ('Kr') and
+ *               refraction ('Kt') delta lobes. Lobe is selected by
+ *               coefficient maximal component, the rest is absorbed,
+ *               coefficients are scaled down if their sum exceeds 1.
+ *               Area lights are sampled both by light and surface
+ *               (power heuristic MIS), point and direction lights
+ *               are sampled by light only.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#include "gort.h"
+#include "rt_def.h"
+#include "rt_scene.h"
+
+/* Application namespace. */
+namespace gort
+{
+  /* Build orthonormal basis around direction function.
+   * ARGUMENTS:
+   *   - basis axis (normalized):
+   *       const vec3 &W;
+   *   - result other basis axes:
+   *       vec3 *U, *V;
+   * RETURNS: None.
+   */
+  static VOID PathBasis( const vec3 &W, vec3 *U, vec3 *V )
+  {
+    vec3 a = fabs(W[0]) > 0.9 ? vec3(0, 1, 0) : vec3(1, 0, 0);
+
+    *U = (W % a).Normalizing();
+    *V = *U % W;
+  } /* End of 'PathBasis' function */
+
+  /* Power heuristic MIS weight function.
+   * ARGUMENTS:
+   *   - weighted strategy density:
+   *       DBL Pdf;
+   *   - other strategy density:
+   *       DBL Other;
+   * RETURNS:
+   *   (DBL) sample weight.
+   */
+  static DBL PathMis( DBL Pdf, DBL Other )
+  {
+    return Pdf * Pdf / (Pdf * Pdf + Other * Other);
+  } /* End of 'PathMis' function */
+
+  /* Refract ray on shape surface function.
+   * ARGUMENTS:
+   *   - hit data:
+   *       const intr &In;
+   *   - ray direction and surface normal faced to ray:
+   *       const vec3 &V, &N;
+   *   - shape is entered flag:
+   *       BOOL IsEnter;
+   *   - ray media (changed to shape media or air if refracted):
+   *       envi *Media;
+   * RETURNS:
+   *   (vec3) refracted (or totally reflected) direction.
+   */
+  vec3 rt::scene::Refract( const intr &In, const vec3 &V, const vec3 &N, BOOL IsEnter, envi *Media )
+  {
+    envi inner = Mtls.Medias[MtlNo(In)];
+    DBL
+      eta = Media->RefractionCoef / (IsEnter ? inner.RefractionCoef : Air.RefractionCoef),
+      ci = -V & N,
+      k = 1 - eta * eta * (1 - ci * ci);
+
+    // Total internal reflection keeps media
+    if (k < 0)
+      return V + N * (2 * ci);
+    *Media = IsEnter ? inner : Air;
+    return (V * eta + N * (eta * ci - sqrt(k))).Normalizing();
+  } /* End of 'rt::scene::Refract' function */
+
+  /* Path tracing ray function.
+   * ARGUMENTS:
+   *   - camera ray:
+   *       const ray &R;
+   *   - pixel sample dimensions sequence:
+   *       path_sampler &Smp;
+   * RETURNS:
+   *   (vec3) ray radiance estimate.
+   */
+  vec3 rt::scene::PathTrace( const ray &R, path_sampler &Smp )
+  {
+    vec3 color(0), beta(1);
+    envi media = Air;
+    ray r = R;
+    DBL pdf_prev = 0; // Previous bounce surface sampling density (0 after delta lobe)
+    INT nl = (INT)lights.size();
+
+    for (INT depth = 0; depth < PathMaxDepth; depth++)
+    {
+      intr in;
+      DBL ls, lu, lv, bs, bu, bv, rr;
+
+      // Dimensions are taken in fixed order, so bounces do not share them
+      ls = Smp.Get1D();
+      Smp.Get2D(&lu, &lv);
+      bs = Smp.Get1D();
+      Smp.Get2D(&bu, &bv);
+      rr = Smp.Get1D();
+
+      Cost.Rays++;
+      BOOL is_hit = Intersect(r, &in);
+
+      // Area light hit before shape
+      light_sample ls_hit;
+      DBL lt = is_hit ? in.T : -1;
+      BOOL is_light = FALSE;
+
+      for (auto Lgh : lights)
+      {
+        light_sample s;
+        DBL t;
+
+        if (Lgh->HitSurface(r, &t, &s) && (lt < 0 || t < lt))
+          lt = t, ls_hit = s, is_light = TRUE;
+      }
+      if (is_light)
+      {
+        DBL w = 1, cl = -(ls_hit.N & r.Dir);
+
+        if (cl <= Threshold)
+          break;
+        if (IsPathMis && pdf_prev > 0)
+          w = PathMis(pdf_prev, ls_hit.PdfA * lt * lt / cl / nl);
+        color += beta * ls_hit.Le * (w * exp(-lt * media.Decay));
+        break;
+      }
+      if (!is_hit)
+      {
+        color += beta * BkgColor;
+        break;
+      }
+
+      // Hit point and faced normal
+      in.P = r(in.T);
+      in.IsP = TRUE;
+      if (!in.IsN)
+        if (in.Ref.Type == shape_ref::Custom)
+          in.Shp->GetNormal(&in);
+        else
+          Flat.GetNormal(&in);
+      beta *= exp(-in.T * media.Decay);
+
+      vec3 V = r.Dir, N = in.N, P = in.P;
+      BOOL is_enter = TRUE;
+
+      if ((V & N) > 0)
+        N = -N, is_enter = FALSE;
+
+      // Lobes selection probabilities
+      const surface &surf = Material(in);
+      DBL
+        kd = max(surf.Kd.K[0], max(surf.Kd.K[1], surf.Kd.K[2])),
+        ks = max(surf.Ks.K[0], max(surf.Ks.K[1], surf.Ks.K[2])),
+        kr = max(surf.Kr.K[0], max(surf.Kr.K[1], surf.Kr.K[2])),
+        kt = max(surf.Kt.K[0], max(surf.Kt.K[1], surf.Kt.K[2])),
+        norm = kd + ks + kr + kt > 1 ? 1 / (kd + ks + kr + kt) : 1,
+        pd = kd * norm,
+        ps = ks * norm;
+      vec3 refl = V + N * (2 * (-V & N));
+
+      // Diffuse and Phong lobes value and density
+      auto eval =
+        [&]( const vec3 &Wi, DBL *Pdf )
+        {
+          DBL cn = N & Wi, ca = refl & Wi, ph = ca > 0 ? pow(ca, surf.Ph) : 0;
+
+          if (cn <= 0)
+          {
+            *Pdf = 0;
+            return vec3(0);
+          }
+          *Pdf = pd * cn / PI + ps * (surf.Ph + 1) / (2 * PI) * ph;
+          return (surf.Kd.K / PI + surf.Ks.K * ((surf.Ph + 2) / (2 * PI) * ph)) * norm;
+        };
+
+      // Light sampling
+      if (nl > 0 && pd + ps > 0)
+      {
+        light *Lgh = lights[min((INT)(ls * nl), nl - 1)];
+        light_sample s;
+
+        if (Lgh->SampleSurface(P, lu, lv, &s))
+        {
+          vec3 d = s.P - P;
+          DBL dist = !d, pdf;
+          vec3 wi = d / dist;
+          DBL cl = -(s.N & wi), cn = N & wi;
+
+          if (IsPathMis && cl > Threshold && cn > Threshold)
+          {
+            vec3 f = eval(wi, &pdf);
+            DBL pl = s.PdfA * dist * dist / cl / nl;
+
+            if (!IsOccluded(ray(P + wi * Threshold, wi), dist - 2 * Threshold))
+              color += beta * f * s.Le * (cn / pl * PathMis(pl, pdf) * exp(-dist * media.Decay));
+          }
+        }
+        else
+        {
+          light_info li;
+          DBL sh = Lgh->Shadow(P, &li), pdf, cn = N & li.L;
+
+          // Whitted 'Kd * sh' diffuse shading is 'Kd / PI' lobe with 'PI * sh' irradiance
+          if (cn > Threshold && !IsOccluded(ray(P + li.L * Threshold, li.L), li.Dist))
+            color += beta * eval(li.L, &pdf) * li.Color * (cn * PI * sh * nl);
+        }
+      }
+
+      // Surface sampling
+      vec3 wi;
+
+      if (bs < pd + ps)
+      {
+        vec3 u, v, w = bs < pd ? N : refl;
+        DBL c = bs < pd ? sqrt(1 - bu) : pow(bu, 1 / (surf.Ph + 1)), s = sqrt(max(0.0, 1 - c * c)), pdf;
+
+        PathBasis(w, &u, &v);
+        wi = u * (s * cos(2 * PI * bv)) + v * (s * sin(2 * PI * bv)) + w * c;
+
+        vec3 f = eval(wi, &pdf);
+
+        if (pdf <= 0)
+          break;
+        beta = beta * f * ((N & wi) / pdf);
+        pdf_prev = pdf;
+      }
+      else if (bs < pd + ps + kr * norm)
+      {
+        wi = refl;
+        beta = beta * surf.Kr.K / kr;
+        pdf_prev = 0;
+      }
+      else if (bs < pd + ps + (kr + kt) * norm)
+      {
+        wi = Refract(in, V, N, is_enter, &media);
+        beta = beta * surf.Kt.K / kt;
+        pdf_prev = 0;
+      }
+      else
+        break;
+      r = ray(P + wi * Threshold, wi);
+
+      // Russian roulette
+      if (depth >= 1)
+      {
+        DBL p = min(1.0, max(ColorThresold, max(beta[0], max(beta[1], beta[2]))));
+
+        if (rr >= p)
+          break;
+        beta = beta / p;
+      }
+    }
+    return color;
+  } /* End of 'rt::scene::PathTrace' function */
+} /* end of 'gort' namespace */
+
+/* END OF 'rt_path.cpp' FILE */
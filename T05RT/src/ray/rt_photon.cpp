@@ -0,0 +1,139 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : rt_photon.cpp
+ * PURPOSE     : Raytracing project.
+ *               Caustics photon map pre-pass module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : Photons are emitted by lights (direction lights have
+ *               no photons), only photons passed mirror or refraction
+ *               bounces are stored at first diffuse surface (caustic
+ *               paths), others are dropped. Emitted photons count is
+ *               split equally between lights. Whitted shading adds
+ *               'Kd' times caustic irradiance as for lights.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#include "gort.h"
+#include <atomic>
+#include "rt_def.h"
+#include "rt_scene.h"
+
+/* Application namespace. */
+namespace gort
+{
+  /* Build caustics photon map function.
+   * ARGUMENTS:
+   *   - workers count:
+   *       INT ThreadCount;
+   * RETURNS:
+   *   (INT) stored photons count.
+   */
+  INT rt::scene::BuildCaustics( INT ThreadCount )
+  {
+    timeline_scope ts("photons");
+    auto t0 = std::chrono::steady_clock::now();
+    const INT Chunk = 1024, MaxDepth = 8;
+    INT nl = (INT)lights.size(), per_light = nl > 0 ? CausticPhotons / nl : 0;
+    std::vector<std::vector<photon_map::photon>> found(max(Pool.Count(), 1));
+    std::atomic_int next = 0;
+
+    Caustics.Clear();
+    if (per_light <= 0)
+      return 0;
+    Pool.Run(ThreadCount,
+      [&]( INT Worker )
+      {
+        std::vector<photon_map::photon> &store = found[Worker];
+
+        for (INT i = next.fetch_add(Chunk); i < per_light * nl; i = next.fetch_add(Chunk))
+          for (INT no = i; no < min(i + Chunk, per_light * nl); no++)
+          {
+            path_sampler smp(no % nl, no / nl);
+            ray r;
+            vec3 flux;
+            envi media = Air;
+            BOOL is_caustic = FALSE;
+            DBL u1, v1, u2, v2;
+
+            smp.Get2D(&u1, &v1);
+            smp.Get2D(&u2, &v2);
+            if (!lights[no % nl]->EmitPhoton(u1, v1, u2, v2, &r, &flux))
+              continue;
+            flux = flux / per_light;
+            for (INT depth = 0; depth < MaxDepth; depth++)
+            {
+              intr in;
+
+              Cost.Rays++;
+              if (!Intersect(r, &in))
+                break;
+              in.P = r(in.T);
+              in.IsP = TRUE;
+              if (!in.IsN)
+                if (in.Ref.Type == shape_ref::Custom)
+                  in.Shp->GetNormal(&in);
+                else
+                  Flat.GetNormal(&in);
+              flux *= exp(-in.T * media.Decay);
+
+              const surface &surf = Material(in);
+              vec3 V = r.Dir, N = in.N;
+              BOOL is_enter = TRUE;
+
+              if ((V & N) > 0)
+                N = -N, is_enter = FALSE;
+              if (is_caustic && surf.Kd.IsUsage)
+                store.push_back({{(FLT)in.P[0], (FLT)in.P[1], (FLT)in.P[2]},
+                                 {(FLT)flux[0], (FLT)flux[1], (FLT)flux[2]},
+                                 {(FLT)V[0], (FLT)V[1], (FLT)V[2]}, 0});
+
+              // Only mirror and refraction bounces are followed
+              DBL
+                kr = max(surf.Kr.K[0], max(surf.Kr.K[1], surf.Kr.K[2])),
+                kt = max(surf.Kt.K[0], max(surf.Kt.K[1], surf.Kt.K[2])),
+                norm = kr + kt > 1 ? 1 / (kr + kt) : 1,
+                s = smp.Get1D();
+              vec3 wi;
+
+              if (s < kr * norm)
+              {
+                wi = V + N * (2 * (-V & N));
+                flux = flux * surf.Kr.K / kr;
+              }
+              else if (s < (kr + kt) * norm)
+              {
+                wi = Refract(in, V, N, is_enter, &media);
+                flux = flux * surf.Kt.K / kt;
+              }
+              else
+                break;
+              is_caustic = TRUE;
+              r = ray(in.P + wi * Threshold, wi);
+            }
+          }
+      });
+
+    // Workers photons are merged to one array
+    size_t total = 0;
+    for (auto &f : found)
+      total += f.size();
+
+    std::vector<photon_map::photon> all;
+    all.reserve(total);
+    for (auto &f : found)
+      all.insert(all.end(), f.begin(), f.end());
+    Caustics.Emitted = per_light * nl;
+    Caustics.TraceTime = std::chrono::duration<DBL>(std::chrono::steady_clock::now() - t0).count();
+    Caustics.Build(std::move(all), Pool, ThreadCount);
+    return (INT)Caustics.Size();
+  } /* End of 'rt::scene::BuildCaustics' function */
+} /* end of 'gort' namespace */
+
+/* END OF 'rt_photon.cpp' FILE */
@@ -0,0 +1,226 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : rt_query.cpp
+ * PURPOSE     : Raytracing project.
+ *               Batched ray query C interface implementation module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : Rays are taken by workers in blocks of 256, so each
+ *               occlusion bits byte is written by one worker only.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#include "gort.h"
+#include <atomic>
+#include <unordered_map>
+#include "rt_scene.h"
+#include "snapshot.h"
+#include "query.h"
+
+/* Application namespace. */
+namespace gort
+{
+  /* Run ray blocks on scene workers function.
+   * ARGUMENTS:
+   *   - scene:
+   *       rt::scene &Scene;
+   *   - rays count:
+   *       INT Count;
+   *   - workers count (0 for all):
+   *       INT Threads;
+   *   - block callback (gets first ray and rays count):
+   *       const std::function<VOID ( INT, INT )> &Block;
+   * RETURNS: None.
+   */
+  static VOID QueryRun( rt::scene &Scene, INT Count, INT Threads, const std::function<VOID ( INT, INT )> &Block )
+  {
+    const INT BlockSize = 256;
+    std::atomic_int Next = 0;
+
+    Scene.Pool.Run(Threads,
+      [&]( INT )
+      {
+        for (INT i = Next.fetch_add(BlockSize); i < Count; i = Next.fetch_add(BlockSize))
+          Block(i, min(BlockSize, Count - i));
+      });
+  } /* End of 'QueryRun' function */
+
+  /* Build query ray function.
+   * Ray origin is moved to range start.
+   * ARGUMENTS:
+   *   - rays origins, directions and ranges:
+   *       const DBL *Org, *Dir, *TRange;
+   *   - ray number:
+   *       INT No;
+   * RETURNS:
+   *   (ray) ray starting at 'tmin'.
+   */
+  static ray QueryRay( const DBL *Org, const DBL *Dir, const DBL *TRange, INT No )
+  {
+    vec3 d = vec3(Dir[No * 3], Dir[No * 3 + 1], Dir[No * 3 + 2]).Normalizing();
+
+    return ray(vec3(Org[No * 3], Org[No * 3 + 1], Org[No * 3 + 2]) + d * TRange[No * 2], d);
+  } /* End of 'QueryRay' function */
+} /* end of 'gort' namespace */
+
+using namespace gort;
+
+/* Load snapshot scene function.
+ * ARGUMENTS:
+ *   - snapshot file name ('.gsnp'):
+ *       const char *FileName;
+ * RETURNS:
+ *   (gortSCENE *) loaded scene or NULL if failed.
+ */
+gortSCENE * GORT_SceneLoad( const char *FileName )
+{
+  rt::scene *Scene = new rt::scene;
+  camera Cam;
+
+  if (!snapshot::Load(*Scene, Cam, FileName))
+  {
+    Scene->Clear();
+    delete Scene;
+    return nullptr;
+  }
+  return (gortSCENE *)Scene;
+} /* End of 'GORT_SceneLoad' function */
+
+/* Free scene function.
+ * ARGUMENTS:
+ *   - scene to free (loaded by 'GORT_SceneLoad'):
+ *       gortSCENE *Scene;
+ * RETURNS: None.
+ */
+void GORT_SceneFree( gortSCENE *Scene )
+{
+  if (Scene == nullptr)
+    return;
+  ((rt::scene *)Scene)->Clear();
+  delete (rt::scene *)Scene;
+} /* End of 'GORT_SceneFree' function */
+
+/* Find closest hits function.
+ * ARGUMENTS:
+ *   - scene:
+ *       gortSCENE *Scene;
+ *   - rays count:
+ *       int Count;
+ *   - rays origins, directions and distance ranges:
+ *       const double *Org, *Dir, *TRange;
+ *   - result hits ('Count' records):
+ *       gortHIT *Hits;
+ *   - workers count (0 for all scene pool workers):
+ *       int Threads;
+ * RETURNS:
+ *   (int) rays with hit count.
+ */
+int GORT_Intersect( gortSCENE *Scene, int Count, const double *Org, const double *Dir,
+                    const double *TRange, gortHIT *Hits, int Threads )
+{
+  rt::scene &scn = *(rt::scene *)Scene;
+  std::unordered_map<const shape *, INT> nums;
+  std::atomic_int hits = 0;
+
+  for (INT i = 0; i < (INT)scn.Shapes.size(); i++)
+    nums[scn.Shapes[i]] = i;
+  QueryRun(scn, Count, Threads,
+    [&]( INT First, INT N )
+    {
+      INT h = 0;
+
+      for (INT i = First; i < First + N; i++)
+      {
+        ray R = QueryRay(Org, Dir, TRange, i);
+        gortHIT &hit = Hits[i];
+        intr in;
+
+        hit.T = -1;
+        hit.N[0] = hit.N[1] = hit.N[2] = 0;
+        hit.U = hit.V = 0;
+        hit.Type = hit.Shape = 0;
+        hit.Prim = -1;
+        if (!scn.Intersect(R, &in) || TRange[i * 2] + in.T > TRange[i * 2 + 1])
+          continue;
+        in.P = R(in.T);
+        in.IsP = TRUE;
+        if (in.Ref.Type == shape_ref::Custom)
+        {
+          in.Shp->GetNormal(&in);
+          hit.Shape = nums.find(in.Shp)->second;
+          if (dynamic_cast<const g3dm *>(in.Shp) != nullptr)
+            hit.Prim = in.I[0], hit.U = in.D[0], hit.V = in.D[1];
+          else if (dynamic_cast<const triangle *>(in.Shp) != nullptr)
+            hit.U = in.D[0], hit.V = in.D[1];
+          else if (dynamic_cast<const sphere_cloud *>(in.Shp) != nullptr)
+            hit.Prim = static_cast<const sphere_cloud *>(in.Shp)->SphereNo(in.I[0]);
+          else if (dynamic_cast<const box *>(in.Shp) != nullptr)
+            hit.Prim = in.I[0];
+        }
+        else
+        {
+          scn.Flat.GetNormal(&in);
+          hit.Shape = in.Ref.Index;
+          if (in.Ref.Type == shape_ref::Box)
+            hit.Prim = in.I[0];
+          else if (in.Ref.Type == shape_ref::Triangle)
+            hit.U = in.D[0], hit.V = in.D[1];
+        }
+        hit.T = TRange[i * 2] + in.T;
+        hit.Type = in.Ref.Type;
+        for (INT k = 0; k < 3; k++)
+          hit.N[k] = in.N[k];
+        h++;
+      }
+      hits += h;
+    });
+  return hits;
+} /* End of 'GORT_Intersect' function */
+
+/* Check rays occlusion function.
+ * ARGUMENTS:
+ *   - scene:
+ *       gortSCENE *Scene;
+ *   - rays count:
+ *       int Count;
+ *   - rays origins, directions and distance ranges:
+ *       const double *Org, *Dir, *TRange;
+ *   - result occlusion bits ('(Count + 7) / 8' bytes, ray N is bit 'N % 8' of byte 'N / 8'):
+ *       unsigned char *Bits;
+ *   - workers count (0 for all scene pool workers):
+ *       int Threads;
+ * RETURNS:
+ *   (int) occluded rays count.
+ */
+int GORT_Occluded( gortSCENE *Scene, int Count, const double *Org, const double *Dir,
+                   const double *TRange, unsigned char *Bits, int Threads )
+{
+  rt::scene &scn = *(rt::scene *)Scene;
+  std::atomic_int occluded = 0;
+
+  QueryRun(scn, Count, Threads,
+    [&]( INT First, INT N )
+    {
+      INT o = 0;
+
+      for (INT i = First; i < First + N; i += 8)
+      {
+        BYTE b = 0;
+
+        for (INT k = 0; k < 8 && i + k < First + N; k++)
+          if (scn.IsOccluded(QueryRay(Org, Dir, TRange, i + k), TRange[(i + k) * 2 + 1] - TRange[(i + k) * 2]))
+            b |= 1 << k, o++;
+        Bits[i / 8] = b;
+      }
+      occluded += o;
+    });
+  return occluded;
+} /* End of 'GORT_Occluded' function */
+
+/* END OF 'rt_query.cpp' FILE */
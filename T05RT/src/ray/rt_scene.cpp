@@ -8,7 +8,7 @@
  *               Raytracing scene module.
  * PROGRAMMER  : CGSG-SummerCamp'2024.
  *               Vladislav A. Golubov (VG6).
- * LAST UPDATE : 27.07.2024.
+ * LAST UPDATE : 19.10.2026.
  * NOTE        : None.
  *
  * No part of this file may be changed without agreement of
@@ -22,6 +22,9 @@
 /* Application namespace. */
 namespace gort
 {
+  /* Per thread tracing cost counters */
+  thread_local cost rt::scene::Cost;
+
   /* Scene ray intersection calculation function
    * ARGUMENTS:
    *   - ray to intersect:
@@ -36,6 +39,7 @@ namespace gort
     intr best_intr;
     best_intr.T = -1;
 
+    Cost.Tests += Shapes.size() + Flat.Size();
     for (auto shp : Shapes )
     {
       intr current_intr;
@@ -43,6 +47,13 @@ namespace gort
       if (shp->Intersect(R, &current_intr) && (best_intr.T == -1 || current_intr.T < best_intr.T))
         best_intr = current_intr;
     }
+    Flat.Walk(R,
+      [&]( const intr &In )
+      {
+        if (best_intr.T == -1 || In.T < best_intr.T)
+          best_intr = In;
+        return TRUE;
+      });
     if (best_intr.T == -1)
       return FALSE;
     *In = best_intr;
@@ -61,9 +72,17 @@ namespace gort
   INT rt::scene::AllIntersect( const ray &R, intr_list *Il )
   {
     intr in;
+    Cost.Tests += Shapes.size() + Flat.Size();
     for (auto shd : Shapes)
       if (shd->Intersect(R, &in))
         Il->operator<<(in);
+    Flat.Walk(R,
+      [&]( const intr &In )
+      {
+        Il->operator<<(In);
+        return TRUE;
+      });
+    Cost.HitBytes = max(Cost.HitBytes, Il->capacity() * sizeof(intr));
     return Il->size();
   } /* End of 'rt::scene::AllIntersect' function */
 
@@ -79,15 +98,57 @@ namespace gort
   INT rt::scene::IsIntersect( const ray &R, intr_list *Il )
   {
     intr in;
+    Cost.Rays++;
     for (auto shd : Shapes)
+    {
+      Cost.Tests++;
       if (shd->Intersect(R, &in))
       {
         in.Shp = shd;
         Il->operator<<(in);
         return Il->size();
       }
-    return 0;
-  } /* End of 'rt::scene::AllIntersect' function
+    }
+    // Any hit is enough, so walk stops on first one
+    Cost.Tests += Flat.Size();
+    Flat.Walk(R,
+      [&]( const intr &In )
+      {
+        Il->operator<<(In);
+        return FALSE;
+      });
+    return Il->size();
+  } /* End of 'rt::scene::IsIntersect' function */
+
+  /* Check any intersection in distance range function.
+   * ARGUMENTS:
+   *   - tracing ray:
+   *       ray &R;
+   *   - maximal hit distance:
+   *       DBL TMax;
+   * RETURNS:
+   *   (BOOL) TRUE if any shape is hit closer than 'TMax', FALSE otherwise.
+   */
+  BOOL rt::scene::IsOccluded( const ray &R, DBL TMax )
+  {
+    Cost.Rays++;
+    for (auto shp : Shapes)
+    {
+      intr in;
+
+      Cost.Tests++;
+      in.Shp = shp;
+      if (shp->Intersect(R, &in) && in.T <= TMax)
+        return TRUE;
+    }
+    // Walk stops on first hit in range
+    Cost.Tests += Flat.Size();
+    return !Flat.Walk(R,
+      [&]( const intr &In )
+      {
+        return In.T > TMax;
+      });
+  } /* End of 'rt::scene::IsOccluded' function */
 
   /* Tracing ray function
     * ARGUMENTS:
@@ -98,28 +159,210 @@ namespace gort
     */
   vec3 rt::scene::Trace( const ray &R, const envi &Media, DBL Weight, INT RecLevel )
   {
-    vec3 color = BkgColor;
     intr best_intr;
 
+    Cost.Rays++;
     if (Intersect(R, &best_intr))
-      if (RecLevel < RecMaxLevel)
+      return ShadeHit(R, &best_intr, Media, Weight, RecLevel);
+    return BkgColor;
+} /* End of rt'::scene::Trace' function */
+
+  /* Shade found ray hit function.
+   * ARGUMENTS:
+   *   - traced ray:
+   *       const ray &R;
+   *   - ray closest intersection data:
+   *       intr *In;
+   *   - ray media:
+   *       const envi &Media;
+   *   - ray weight and recursion level:
+   *       DBL Weight;
+   *       INT RecLevel;
+   * RETURNS:
+   *   (vec3) ray color.
+   */
+  vec3 rt::scene::ShadeHit( const ray &R, intr *In, const envi &Media, DBL Weight, INT RecLevel )
+  {
+    if (RecLevel >= RecMaxLevel)
+      return BkgColor;
+    if (!In->IsP)
+    {
+      In->P = R(In->T);
+      In->IsP = TRUE;
+    }
+    if (!In->IsN)
+      if (In->Ref.Type == shape_ref::Custom)
+        In->Shp->GetNormal(In);
+      else
+        Flat.GetNormal(In);
+    return Shade(R.Dir, Media, In, Weight, RecLevel + 1) * exp(-In->T * Media.Decay);
+  } /* End of 'rt::scene::ShadeHit' function */
+
+  /* Material specialized shading function.
+   * Only features selected by 'Kernel' bits are compiled in.
+   * ARGUMENTS:
+   *   - ray direction:
+   *       vec3 &V;
+   *   - shape material:
+   *       envi &Media;
+   *   - intersection data:
+   *       intr *In;
+   * RETURNS: 
+   *   (vec3) result color.
+   */
+  template<DWORD Kernel>
+    vec3 rt::scene::ShadeKernel( const vec3 &V, const envi &Media, intr *I, DBL Weight, INT RecLevel )
+    {
+      const surface &Surf = Material(*I);
+      vec3 P = I->P, N = I->N;
+
+      // face forward (N):
+      BOOL IsEnter = TRUE;
+      if ((V & N) > 0)
       {
-        RecLevel++;
-        if (!best_intr.IsP)
+        N = -N;
+        IsEnter = FALSE;
+      }
+
+      vec3 color;
+      if constexpr ((Kernel & ShadeChecker) != 0)
+      {
+        if ((((INT)std::floor(P[0] + 1000) + (INT)std::floor(P[2] + 1000)) & 1) != 0)
+          color = Surf.Ka.K * AmbientColor;
+        else
+          color = (-Surf.Ka.K + 1) * AmbientColor;
+      }
+      else
+        color = Surf.Ka.K * AmbientColor;
+      vec3 R = V + N * (2 * (-V & N));
+
+      // Not shadowed light sample contribution
+      auto direct =
+        [&]( const light_info &li, DBL sh )
         {
-          best_intr.P = R(best_intr.T);
-          best_intr.IsP = TRUE;
+          vec3 c(0);
+
+          // diffuse
+          if (DBL nl = N & li.L; nl > Threshold)
+          {
+            c = Surf.Kd.K * li.Color * nl * sh;
+
+            // specular
+            if constexpr ((Kernel & ShadeSpecular) != 0)
+              if (DBL rl = R & -li.L; rl > Threshold)
+                c += Surf.Ks.K * li.Color * pow(rl, Surf.Ph) * sh;
+          }
+          return c;
+        };
+
+      for (auto Lgh : lights)
+      {
+        if (Lgh->Strata > 0)
+        {
+          color += AreaShade(Lgh, P, direct);
+          continue;
+        }
+        light_info li;
+        DBL sh = Lgh->Shadow(P, &li);
+
+        // cast shadow
+        intr_list il;
+        if (IsIntersect(ray(P + -li.L * Threshold, -li.L), &il) > 0 &&
+            il[0].T < li.Dist)
+        {
+          // Light through transparent blocker is in caustics photon map if it is on
+          if (coef Kt = Material(il[0]).Kt; !IsCaustics && Kt.MaxComponent() > Threshold)
+            color += Kt.K * Trace(ray(P + -li.L * Threshold, -li.L), Media, Weight, RecLevel);
+          continue; // point in shadow
         }
-        if (!best_intr.IsN)
-          best_intr.Shp->GetNormal(&best_intr);
-        color = Shade(R.Dir, Media, &best_intr, Weight, RecLevel );
-        color *= exp(-best_intr.T * Media.Decay);
-        RecLevel--;
+        color += direct(li, sh);
       }
-    return color;
-} /* End of rt'::scene::Trace' function */
+      if (IsCaustics && Surf.Kd.IsUsage)
+        color += Surf.Kd.K * Caustics.Irradiance(P, N, CausticRadius, CausticK);
+      // Indirect diffuse lighting at primary hits only
+      if (IsIrrCache && RecLevel == 1 && Surf.Kd.IsUsage)
+        color += Surf.Kd.K * Indirect(P, N, Media, Weight);
+      // Reflection other scene shapes
+      if constexpr ((Kernel & ShadeMirror) != 0)
+        if (coef(Surf.Kr.K * Weight).IsUsage)
+          color += Surf.Kr.K * Trace(ray(P + R * Threshold, R), Media, Weight, RecLevel);
+
+      // Refracted ray accounting
+      if constexpr ((Kernel & ShadeDielectric) != 0)
+        if (DBL w = max(Surf.Kt.K[0], max(Surf.Kt.K[1], Surf.Kt.K[2])) * Weight; w > ColorThresold)
+        {
+          DBL eta = IsEnter ? 1 : Air.RefractionCoef / Media.RefractionCoef;
+          DBL a1 = -V & N;
+          vec3 T = (V - N * (V & N)) * eta - N * sqrt(1 - (1 - cos(a1) * cos(a1)) * eta * eta);
+
+          color += Surf.Kt.K * Trace(ray(P + (T * Threshold), T),
+                                     IsEnter ? Media : Air, w, RecLevel);
+        }
+      return color;
+    } /* End of 'rt::scene::ShadeKernel' function */
 
-  /* Fake light function
+  /* Area light adaptive soft shadow function.
+   * Light is sampled once per 2 x 2 quadrant first. If all samples
+   * agree (point is fully lit or fully shadowed) the estimate is kept,
+   * otherwise (penumbra) 'Strata' x 'Strata' strata are sampled too.
+   * Sample is jittered in stratum by R2 sequence rotated by point hash,
+   * so neighbour pixels do not share pattern.
+   * ARGUMENTS:
+   *   - area light:
+   *       light *Lgh;
+   *   - shading point:
+   *       const vec3 &P;
+   *   - not shadowed sample contribution callback:
+   *       DirectFunc Direct;
+   * RETURNS:
+   *   (vec3) light contribution.
+   */
+  template<typename DirectFunc>
+    vec3 rt::scene::AreaShade( light *Lgh, const vec3 &P, DirectFunc Direct )
+    {
+      auto frac =
+        []( DBL X )
+        {
+          return X - floor(X);
+        };
+      DBL
+        ru = frac(sin(P & vec3(12.9898, 78.233, 37.719)) * 43758.5453),
+        rv = frac(sin(P & vec3(39.3468, 11.135, 83.155)) * 24634.6345);
+      INT lit = 0, n = 0;
+      vec3 sum(0);
+
+      auto sample =
+        [&]( INT No, INT Side )
+        {
+          light_info li;
+          intr_list il;
+          DBL
+            u = (No % Side + frac(ru + No * 0.7548776662466927)) / Side,
+            v = (No / Side + frac(rv + No * 0.5698402909980532)) / Side,
+            sh = Lgh->Sample(P, u, v, &li);
+
+          n++;
+          if (IsIntersect(ray(P + li.L * Threshold, li.L), &il) > 0 && il[0].T < li.Dist)
+          {
+            // Transparent blocker passes light attenuated
+            if (const coef &Kt = Material(il[0]).Kt; !IsCaustics && Kt.IsUsage)
+              sum += Kt.K * Direct(li, sh);
+            return;
+          }
+          lit++;
+          sum += Direct(li, sh);
+        };
+
+      for (INT i = 0; i < 4; i++)
+        sample(i, 2);
+      if (lit != 0 && lit != 4)
+        for (INT i = 0, s = Lgh->Strata; i < s * s; i++)
+          sample(i, s);
+      return sum / n;
+    } /* End of 'rt::scene::AreaShade' function */
+
+  /* Fake light function.
+   * Dispatches to shading kernel selected for material by material table (see 'mtl_table').
    * ARGUMENTS:
    *   - ray direction:
    *       vec3 &V;
@@ -132,75 +375,338 @@ namespace gort
    */
   vec3 rt::scene::Shade( const vec3 &V, const envi &Media, intr *I, DBL Weight, INT RecLevel )
   {
-    shade_info si {I->P, I->N, I->Shp, I->Shp->Material, Media, {1, 0, 0}, {0, 1, 0}};
-    //modifiers
-
-    // face forward (si.N):
-    DBL vn = V & si.N;
-    BOOL IsEnter = TRUE;
-    if (vn > 0)
+    // Kernels table, index is 'SHADE_KERNEL' bits
+    static vec3 (rt::scene::* const Kernels[ShadeKernelCount])( const vec3 &, const envi &, intr *, DBL, INT ) =
     {
-      vn = -vn;
-      si.N = -si.N;
-      IsEnter = FALSE;
-    }
+      &rt::scene::ShadeKernel<0>,  &rt::scene::ShadeKernel<1>,
+      &rt::scene::ShadeKernel<2>,  &rt::scene::ShadeKernel<3>,
+      &rt::scene::ShadeKernel<4>,  &rt::scene::ShadeKernel<5>,
+      &rt::scene::ShadeKernel<6>,  &rt::scene::ShadeKernel<7>,
+      &rt::scene::ShadeKernel<8>,  &rt::scene::ShadeKernel<9>,
+      &rt::scene::ShadeKernel<10>, &rt::scene::ShadeKernel<11>,
+      &rt::scene::ShadeKernel<12>, &rt::scene::ShadeKernel<13>,
+      &rt::scene::ShadeKernel<14>, &rt::scene::ShadeKernel<15>,
+    };
+    DWORD k = Mtls.Kernels[MtlNo(*I)];
+
+    return (this->*Kernels[k | (I->IsPlane ? ShadeChecker : 0)])(V, Media, I, Weight, RecLevel);
+  } /* End of 'rt::scene::Shade' function */
+
+  /* Render frame function.
+   * ARGUMENTS:
+   *   - frame to render to (camera frame size should match):
+   *       frame &Frm;
+   *   - camera:
+   *       camera &Cam;
+   *   - render threads count:
+   *       INT ThreadCount;
+   *   - per-pixel cost store (nullptr if not needed, should be sized to frame):
+   *       heatmap *CostMap;
+   *   - color and feature buffers (nullptr if not needed, should be sized to frame):
+   *       gbuffer *Feature;
+   * RETURNS:
+   *   (cost) frame total tracing cost.
+   */
+  cost rt::scene::Render( frame &Frm, camera &Cam, INT ThreadCount, heatmap *CostMap, gbuffer *Feature )
+  {
+    // Photons are emitted again for each frame
+    Caustics.Clear();
+    if (!IsIrrCacheKeep)
+      Irr.Clear();
+    return RenderRect(Frm, Cam, ThreadCount, 0, 0, Frm.W, Frm.H, IsPath ? PathSamples : 1, CostMap, Feature);
+  } /* End of 'rt::scene::Render' function */
+
+  /* Evaluate first hit denoiser features function.
+   * ARGUMENTS:
+   *   - primary ray:
+   *       const ray &R;
+   *   - result first hit diffuse color, normal (faced to ray) and distance
+   *     (background color, zero normal and distance if nothing is hit):
+   *       vec3 *Albedo, *N;
+   *       DBL *Depth;
+   * RETURNS: None.
+   */
+  VOID rt::scene::Features( const ray &R, vec3 *Albedo, vec3 *N, DBL *Depth )
+  {
+    intr in;
 
-    vec3 color;
-    if (I->IsPlane)
+    if (!Intersect(R, &in))
     {
-      if ((INT)std::floor(si.P[0] + 1000) % 2 == 0 && (INT)std::floorf(si.P[2] + 1000) % 2 == 1 || (INT)std::floor(si.P[0] + 1000) % 2 == 1 && (INT)std::floorf(si.P[2] + 1000) % 2 == 0)
-        color = si.Surf.Ka.K * AmbientColor;
-      else
-        color = (-si.Surf.Ka.K + 1) * AmbientColor;
+      *Albedo = BkgColor;
+      *N = vec3(0);
+      *Depth = 0;
+      return;
     }
-    else
-      color = si.Surf.Ka.K * AmbientColor;
-    vec3 R = V + si.N * (2 * (-V & si.N));
-    for (auto Lgh : lights)
+    if (!in.IsP)
     {
-      light_info li;
-      DBL sh = Lgh->Shadow(si.P, &li);
+      in.P = R(in.T);
+      in.IsP = TRUE;
+    }
+    if (!in.IsN)
+      if (in.Ref.Type == shape_ref::Custom)
+        in.Shp->GetNormal(&in);
+      else
+        Flat.GetNormal(&in);
+    *Albedo = Material(in).Kd.K;
+    *N = (in.N & R.Dir) > 0 ? -in.N : in.N;
+    *Depth = in.T;
+  } /* End of 'rt::scene::Features' function */
 
-      // cast shadow
-      intr_list il;
-      if (IsIntersect(ray(si.P + -li.L * Threshold, -li.L), &il) > 0 &&
-          il[0].T < li.Dist)
-      {
-        if (il[0].Shp->Material.Kt.MaxComponent() > Threshold)
-          color += il[0].Shp->Material.Kt.K * Trace(ray(si.P + -li.L * Threshold, -li.L), Media, Weight, RecLevel);
-        continue; // point in shadow
-      }
-      // diffuse
-      DBL nl = si.N & li.L;
-      if (nl > Threshold)
-      {
-        //color += si.Surf.Kd.K * li.Color * nl; // ??? * sh
-        color += si.Surf.Kd.K * li.Color * nl * sh;
+  /* Render frame rectangle function.
+   * Pixels outside rectangle are kept. Samples are placed by R2
+   * low discrepancy sequence, first sample is pixel center
+   * (path tracing takes pixel position from path sampler).
+   * Caustics photon map is built if it is on and empty.
+   * ARGUMENTS:
+   *   - frame to render to (camera frame size should match):
+   *       frame &Frm;
+   *   - camera:
+   *       camera &Cam;
+   *   - render threads count:
+   *       INT ThreadCount;
+   *   - rectangle corners (X1, Y1 are excluded, clipped by frame):
+   *       INT X0, Y0, X1, Y1;
+   *   - samples per pixel:
+   *       INT Samples;
+   *   - per-pixel cost store (nullptr if not needed, should be sized to frame):
+   *       heatmap *CostMap;
+   *   - color and feature buffers (nullptr if not needed, should be sized to frame):
+   *       gbuffer *Feature;
+   * RETURNS:
+   *   (cost) rectangle total tracing cost.
+   */
+  cost rt::scene::RenderRect( frame &Frm, camera &Cam, INT ThreadCount, INT X0, INT Y0, INT X1, INT Y1,
+                              INT Samples, heatmap *CostMap, gbuffer *Feature )
+  {
+    timeline_scope ts("trace");
+    std::atomic<UINT64> Tests = 0, Rays = 0;
 
-        // specular
-        if (DBL rl = R & -li.L; rl > Threshold)
-          //color += si.Surf.Ks.K * li.Color * pow(rl, si.Surf.Ph); // ??? * sh
-          color += si.Surf.Ks.K * li.Color * pow(rl, si.Surf.Ph) * sh;
-      }
+    X0 = max(X0, 0), Y0 = max(Y0, 0);
+    X1 = min(X1, Frm.W), Y1 = min(Y1, Frm.H);
+    Samples = max(Samples, 1);
+    if (X0 >= X1 || Y0 >= Y1)
+      return cost();
+    if (IsCaustics && !IsPath && Caustics.Emitted == 0)
+      BuildCaustics(ThreadCount);
+
+    // Primary hits are taken from rasterized visibility buffer
+    BOOL is_vis = IsRaster && Samples == 1 && !IsPath;
+    if (is_vis)
+    {
+      timeline_scope tr("raster");
+      Vis.Build(Shapes, Flat, Cam, X0, Y0, X1, Y1, Pool, ThreadCount);
     }
-    // Reflection other scene shapes
-    if (si.Surf.Kr.IsUsage && coef(si.Surf.Kr.K * Weight).IsUsage)
-      color += si.Surf.Kr.K * Trace(ray(si.P + R * Threshold, R), Media, Weight, RecLevel);
 
-    // Refracted ray accounting
-    if (DBL w = si.Surf.Kt.MaxComponent() * Weight; w > ColorThresold)
+    // Rows are split to one band per NUMA node, worker takes rows of own node band first
+    INT nodes = Pool.Count() > 0 ? Pool.NodeCount() : 1;
+    std::vector<std::atomic_int> Next(nodes);
+    for (INT b = 0; b < nodes; b++)
+      Next[b] = Y0 + (Y1 - Y0) * b / nodes;
+
+    Pool.Run(ThreadCount,
+      [&]( INT i )
+        {
+          timeline::Get().SetThread(i + 2, "worker");
+          cost Start = Cost;
+          vec3 *Line = (vec3 *)Pool.Scratch(i, (X1 - X0) * (sizeof(vec3) + sizeof(DWORD)));
+          std::vector<vec3> Heap;
+          INT band = 0, y;
+
+          // No scratch memory - use heap line (vec3 per pixel is enough for pixels too)
+          if (Line == nullptr)
+          {
+            Heap.resize((size_t)(X1 - X0) * 2);
+            Line = Heap.data();
+          }
+          DWORD *Pixels = (DWORD *)(Line + (X1 - X0));
+          while (band < nodes && !IsToBeStop)
+          {
+            INT b = (Pool.Node(i) + band) % nodes;
+
+            y = Next[b]++;
+            if (y >= Y0 + (Y1 - Y0) * (b + 1) / nodes)
+            {
+              band++;
+              continue;
+            }
+            timeline_scope row("row", y);
+            {
+              timeline_scope tr("row trace", y);
+              for (INT xs = X0; xs < X1 && !IsToBeStop; xs++)
+              {
+                cost c = Cost;
+                auto t0 = CostMap != nullptr ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+                vec3 color(0);
+
+                for (INT s = 0; s < Samples && is_vis; s++)
+                {
+                  ray r = Cam.FrameRay(xs + 0.5, y - 0.5);
+                  intr in;
+                  INT res = Vis.Intersect(r, xs, y, &in, &Cost.Tests);
+
+                  if (res < 0)
+                    color += Trace(r, Air, 1, 0);
+                  else
+                  {
+                    Cost.Rays++;
+                    color += res > 0 ? ShadeHit(r, &in, Air, 1, 0) : BkgColor;
+                  }
+                }
+                for (INT s = 0; s < Samples && IsPath; s++)
+                {
+                  path_sampler smp(y * Frm.W + xs, s);
+                  DBL u, v;
+
+                  smp.Get2D(&u, &v);
+                  color += PathTrace(Cam.FrameRay(xs + u, y - 1 + v), smp);
+                }
+                for (INT s = 0; s < Samples && !is_vis && !IsPath; s++)
+                {
+                  DBL
+                    u = 0.5 + s * 0.7548776662466927,
+                    v = 0.5 + s * 0.5698402909980532;
+                  color += Trace(Cam.FrameRay(xs + u - floor(u), y - 1 + v - floor(v)), Air, 1, 0);
+                }
+                Line[xs - X0] = color / Samples;
+                if (Feature != nullptr)
+                {
+                  vec3 a, n;
+                  DBL z;
+
+                  Features(Cam.FrameRay(xs + 0.5, y - 0.5), &a, &n, &z);
+                  Feature->Put(xs, y, Line[xs - X0], a, n, z);
+                }
+                if (CostMap != nullptr)
+                {
+                  auto t1 = std::chrono::steady_clock::now();
+
+                  c.Tests = Cost.Tests - c.Tests;
+                  c.Rays = Cost.Rays - c.Rays;
+                  CostMap->Put(xs, y, (DBL)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count(), c);
+                }
+              }
+            }
+            if (IsToBeStop)
+              break;
+            timeline_scope tone("tone conversion", y);
+            for (INT xs = 0; xs < X1 - X0; xs++)
+              Pixels[xs] = frame::ToRGB(Line[xs][0], Line[xs][1], Line[xs][2]);
+            Frm.PutSpan(X0, y, X1 - X0, Pixels);
+          }
+          Tests += Cost.Tests - Start.Tests;
+          Rays += Cost.Rays - Start.Rays;
+          Pool.NoteHeap(i, Cost.HitBytes + mem_report::Of(Heap));
+        });
+
+    cost Total;
+    Total.Tests = Tests;
+    Total.Rays = Rays;
+    return Total;
+  } /* End of 'rt::scene::RenderRect' function */
+
+  /* Move spheres, boxes, planes and triangles to typed arrays function.
+   * Other shapes stay in 'Shapes' and are intersected virtually.
+   * ARGUMENTS: None.
+   * RETURNS:
+   *   (INT) moved shapes count.
+   */
+  INT rt::scene::Flatten( VOID )
+  {
+    INT moved = 0;
+    stock<shape *> rest;
+    mem_report before, after, gone;
+
+    // Accounted budget use is kept: moved shapes are replaced by typed arrays growth
+    if (BudgetUsed != 0)
+      Flat.Account(before);
+    for (auto shp : Shapes)
+      if (Flat.Add(shp))
+      {
+        if (BudgetUsed != 0)
+          shp->Account(gone);
+        delete shp, moved++;
+      }
+      else
+        rest << shp;
+    Shapes = rest;
+    if (BudgetUsed != 0)
     {
-      DBL eta = IsEnter ?
-                si.Media.RefractionCoef / Media.RefractionCoef :
-                Air.RefractionCoef / Media.RefractionCoef;
-      DBL a1 = -V & si.N;
-      vec3 T = (V - si.N * (V & si.N)) * eta - si.N * sqrt(1 - (1 - cos(a1) * cos(a1)) * eta * eta);
-
-      color += si.Surf.Kt.K * Trace(ray(si.P + (T * Threshold), T),
-                                    IsEnter ? si.Media : Air, w, RecLevel);
+      Flat.Account(after);
+      BudgetUsed = BudgetUsed + after.Total() - before.Total() - gone.Total();
     }
-    return color;
-  } /* End of 'rt::scene::Shade' function */
+    return moved;
+  } /* End of 'rt::scene::Flatten' function */
+
+  /* Update shapes acceleration data after per frame shapes changes function.
+   * Should be called between renders after shapes are moved.
+   * ARGUMENTS:
+   *   - workers count:
+   *       INT ThreadCount;
+   * RETURNS:
+   *   (INT) rebuilt (not refitted) shapes count.
+   */
+  INT rt::scene::Refit( INT ThreadCount )
+  {
+    timeline_scope ts("refit");
+    INT rebuilt = 0;
+
+    for (auto shp : Shapes)
+      rebuilt += shp->Refit(Pool, ThreadCount);
+    // Kept irradiance is valid for static geometry only
+    Irr.Clear();
+    return rebuilt;
+  } /* End of 'rt::scene::Refit' function */
+
+  /* Account scene memory function.
+   * Should be called between renders.
+   * ARGUMENTS:
+   *   - report to fill:
+   *       mem_report &Rep;
+   * RETURNS: None.
+   */
+  VOID rt::scene::Account( mem_report &Rep )
+  {
+    Rep.Add("scene", "shape list", Shapes.size(), mem_report::Of(Shapes));
+    Rep.Add("scene", "lights", lights.size(), mem_report::Of(lights) + lights.size() * sizeof(light));
+    for (auto shp : Shapes)
+      shp->Account(Rep);
+    Flat.Account(Rep);
+    Mtls.Account(Rep);
+    Rep.Add("scene", "caustics", Caustics.Size(), Caustics.Memory());
+    Rep.Add("scene", "irradiance", Irr.Size(), Irr.Memory());
+    Rep.Add("scene", "visibility", 1, Vis.Memory());
+    Pool.Account(Rep);
+  } /* End of 'rt::scene::Account' function */
+
+  /* Hash scene content and render settings function.
+   * Equal hashes mean equal rendered images (for same camera).
+   * ARGUMENTS:
+   *   - hash to add to:
+   *       hasher &H;
+   * RETURNS:
+   *   (BOOL) TRUE if scene is hashed, FALSE if some shape or light can't be hashed.
+   */
+  BOOL rt::scene::Hash( hasher &H )
+  {
+    timeline_scope ts("scene hash");
+
+    H << Shapes.size();
+    for (auto shp : Shapes)
+      if (!shp->Hash(H))
+        return FALSE;
+    H << lights.size();
+    for (auto lgh : lights)
+      if (!lgh->Hash(H))
+        return FALSE;
+    // Typed arrays records have no padding bytes
+    Flat.Hash(H);
+    Mtls.Hash(H);
+    H << AmbientColor << BkgColor << RecMaxLevel << ColorThresold << Air.RefractionCoef << Air.Decay;
+    H << IsRaster << IsPath << IsPathMis << PathSamples << PathMaxDepth;
+    H << IsCaustics << CausticPhotons << CausticK << CausticRadius;
+    H << IsIrrCache << IsIrrCacheKeep << Irr.Error << Irr.MinR << Irr.MaxR << Irr.Extent << Irr.Rays;
+    return TRUE;
+  } /* End of 'rt::scene::Hash' function */
 
   /* Shape class destructor. */
   shape::~shape()
@@ -8,7 +8,7 @@
  *               Raytracing declaration module.
  * PROGRAMMER  : CGSG-SummerCamp'2024.
  *               Vladislav A. Golubov (VG6).
- * LAST UPDATE : 27.07.2024.
+ * LAST UPDATE : 19.10.2026.
  * NOTE        : None.
  *
  * No part of this file may be changed without agreement of
@@ -18,7 +18,17 @@
 #ifndef __rt_scene_h_
 #define __rt_scene_h_
 #include <thread>
+#include <iostream>
 #include "rt_def.h"
+#include "heatmap.h"
+#include "denoise.h"
+#include "timeline.h"
+#include "rt_flat.h"
+#include "pool.h"
+#include "visbuf.h"
+#include "sampler.h"
+#include "photon.h"
+#include "irrcache.h"
 
 /* Application namespace */
 namespace gort
@@ -31,6 +41,26 @@ namespace gort
     {
     public:
       stock<shape *> Shapes; // Shapes stock
+      flat_shapes Flat;      // Typed shape arrays (see 'Flatten')
+      mtl_table Mtls;        // Shapes and typed arrays materials (shape 'Mtl' is record number)
+      thread_pool Pool;      // Render workers
+      visbuf Vis;            // Primary visibility buffer (see 'IsRaster')
+      BOOL IsRaster = FALSE; // Rasterize primary visibility flag (one sample per pixel only)
+      BOOL IsPath = FALSE;   // Monte Carlo path tracing flag (see 'PathTrace')
+      BOOL IsPathMis = TRUE; // Path tracing light sampling flag (surface sampling only otherwise)
+      INT PathSamples = 16;  // Path tracing samples per pixel
+      INT PathMaxDepth = 12; // Path tracing maximal bounces count
+      photon_map Caustics;         // Caustic photons (see 'BuildCaustics')
+      BOOL IsCaustics = FALSE;     // Caustics photon map flag (shadows are opaque then)
+      INT CausticPhotons = 200000; // Emitted caustic photons count (for all lights)
+      INT CausticK = 64;           // Caustic irradiance nearest photons count
+      DBL CausticRadius = 0.5;     // Caustic irradiance maximal gather radius
+      irr_cache Irr;               // Indirect irradiance cache (see 'Indirect')
+      BOOL IsIrrCache = FALSE;     // Indirect diffuse lighting flag
+      BOOL IsIrrCacheKeep = FALSE; // Keep cache records between frames (static geometry and lights only)
+      size_t MemoryBudget = 0;     // Scene memory limit in bytes (0 for no limit, see 'IsInBudget', 'Add')
+      size_t BudgetUsed = 0;       // Accounted scene memory without shape list and materials (0 if not accounted yet, see 'Add')
+      BOOL IsOverBudget = FALSE;   // Some shape was refused by memory budget flag (see 'Add')
       stock<light *> lights;
       // Color def params
       vec3 
@@ -46,23 +76,128 @@ namespace gort
       std::atomic_bool IsToBeStop = FALSE;
       std::atomic_bool IsReadyToFinish = FALSE;
       std::atomic_int StartRow = 0;
+      // Per thread tracing cost counters
+      static thread_local cost Cost;
 
       BOOL Intersect( const ray &R, intr *Intr );
       INT AllIntersect( const ray &R, intr_list *Il );
       INT IsIntersect( const ray &R, intr_list *Il );
+      BOOL IsOccluded( const ray &R, DBL TMax );
       vec3 Shade( const vec3 &V, const envi &Media, intr *I, DBL Weight, INT RecLevel );
+      template<DWORD Kernel>
+        vec3 ShadeKernel( const vec3 &V, const envi &Media, intr *I, DBL Weight, INT RecLevel );
+      template<typename DirectFunc>
+        vec3 AreaShade( light *Lgh, const vec3 &P, DirectFunc Direct );
       vec3 Trace( const ray &R, const envi &Media, DBL Weight, INT RecLevel );
+      vec3 ShadeHit( const ray &R, intr *In, const envi &Media, DBL Weight, INT RecLevel );
+      vec3 PathTrace( const ray &R, path_sampler &Smp );
+      vec3 Refract( const intr &In, const vec3 &V, const vec3 &N, BOOL IsEnter, envi *Media );
+      INT BuildCaustics( INT ThreadCount );
+      vec3 Indirect( const vec3 &P, const vec3 &N, const envi &Media, DBL Weight );
+      VOID Features( const ray &R, vec3 *Albedo, vec3 *N, DBL *Depth );
+      cost Render( frame &Frm, camera &Cam, INT ThreadCount, heatmap *CostMap = nullptr,
+                   gbuffer *Feature = nullptr );
+      cost RenderRect( frame &Frm, camera &Cam, INT ThreadCount, INT X0, INT Y0, INT X1, INT Y1,
+                       INT Samples = 1, heatmap *CostMap = nullptr, gbuffer *Feature = nullptr );
+      INT Flatten( VOID );
+      INT Refit( INT ThreadCount );
+      VOID Account( mem_report &Rep );
+      BOOL Hash( hasher &H );
+
+      /* Obtain intersected shape material function.
+       * ARGUMENTS:
+       *   - intersection data:
+       *       const intr &In;
+       * RETURNS:
+       *   (const surface &) shape surface.
+       */
+      const surface & Material( const intr &In ) const
+      {
+        return Mtls.Surfs[MtlNo(In)];
+      } /* End of 'Material' function */
+
+      /* Obtain intersected shape material number function.
+       * ARGUMENTS:
+       *   - intersection data:
+       *       const intr &In;
+       * RETURNS:
+       *   (DWORD) material table record number (see 'Mtls').
+       */
+      DWORD MtlNo( const intr &In ) const
+      {
+        if (In.Ref.Type == shape_ref::Custom)
+          return In.Shp->MtlNo(In);
+        return Flat.MtlNo(In.Ref);
+      } /* End of 'MtlNo' function */
+
+      /* Check scene memory budget function.
+       * ARGUMENTS:
+       *   - memory to be added in bytes:
+       *       size_t Extra;
+       * RETURNS:
+       *   (BOOL) TRUE if scene with added memory fits budget (or there is no budget), FALSE otherwise.
+       */
+      BOOL IsInBudget( size_t Extra = 0 )
+      {
+        if (MemoryBudget == 0)
+          return TRUE;
+
+        mem_report rep;
+        Account(rep);
+        // Shape list and materials are taken as is by 'Add'
+        BudgetUsed = rep.Total() - rep.Items["scene/shape list"].Bytes - rep.Items["scene/materials"].Bytes;
+        return rep.Total() + Extra <= MemoryBudget;
+      } /* End of 'IsInBudget' function */
+
+      /* Add shape to stock function.
+       * Shape over memory budget is deleted and 'IsOverBudget' is set.
+       * Scene is accounted once, then added shapes memory is summed
+       * ('Flatten' updates sum by typed arrays growth), shape list
+       * growth and materials table are counted on each call.
+       * ARGUMENTS:
+       *   - new shape (owned by scene after call):
+       *       shape *Shp;
+       * RETURNS:
+       *   (BOOL) TRUE if shape is added, FALSE if it is refused by budget.
+       */
+      BOOL Add( shape *Shp )
+      {
+        if (MemoryBudget != 0)
+        {
+          mem_report rep;
+          size_t
+            list = (Shapes.size() < Shapes.capacity() ? Shapes.capacity() : max(Shapes.size() * 2, (size_t)1)) * sizeof(shape *),
+            bytes;
+
+          if (BudgetUsed == 0)
+            IsInBudget();
+          Shp->Account(rep);
+          bytes = rep.Total();
+          Mtls.Account(rep);
+          if (BudgetUsed + rep.Total() + list > MemoryBudget)
+          {
+            delete Shp;
+            IsOverBudget = TRUE;
+            return FALSE;
+          }
+          BudgetUsed += bytes;
+        }
+        Shapes << Shp;
+        return TRUE;
+      } /* End of 'Add' function */
 
       /* Obtion add shape to stock function
+       * Refused shape is reported to console, as pointer to it is no longer valid.
        * ARGUMENTS:
-       *   - new shape:
+       *   - new shape (deleted if over memory budget, see 'Add'):
        *       shape *Shp;
        * RETURN:
        *   (scene &) this scene.
        */
       scene & operator<<( shape *Shp )
       {
-        Shapes << Shp;
+        if (!Add(Shp))
+          std::cout << "Shape is over scene memory budget (" << MemoryBudget << " bytes), it is deleted" << std::endl;
         return *this;
       } /* End of 'operator<<' function */
 
@@ -89,6 +224,14 @@ namespace gort
           delete x;
         for (auto x : lights)
           delete x;
+        Shapes.clear();
+        lights.clear();
+        Flat.Clear();
+        Mtls.Clear();
+        Caustics.Clear();
+        Irr.Clear();
+        BudgetUsed = 0;
+        IsOverBudget = FALSE;
       } /* End of 'Clear' function */
 
     }; /* End of 'Scene' class */
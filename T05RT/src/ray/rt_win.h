@@ -8,7 +8,7 @@
  *               Ray tracing handle module.
  * PROGRAMMER  : CGSG-SummerCamp'2024.
  *               Vladislav A. Golubov (VG6).
- * LAST UPDATE : 26.07.2024.
+ * LAST UPDATE : 19.10.2026.
  * NOTE        : None.
  *
  * No part of this file may be changed without agreement of
@@ -20,12 +20,20 @@
 #include "def.h"
 
 #include <iostream>
+#include <chrono>
 #include "win/win.h"
 #include "frame.h"
 #include "rt_scene.h"
 #include "shp/shapes.h"
 #include "lgh/lights.h"
 #include "timer.h"
+#include "heatmap.h"
+#include "timeline.h"
+#include "snapshot.h"
+#include "preview.h"
+#include "sequence.h"
+#include "job.h"
+#include "rcache.h"
 
 #define RENDER_SECONDS 5
 #define COUNT_IN_SECOND 48
@@ -41,12 +49,37 @@ namespace gort
     camera Cam;        // Camera
     rt::scene Scene;   // Scene class
     timer Time;        // Timer class
+    heatmap CostMap;   // Per-pixel render cost
+    BOOL IsCostMode = FALSE; // Per-pixel cost recording flag (heatmap metric is switched by 'H' key too)
+    BOOL IsAnti = FALSE; // Anti-aliased frame render flag (see 'RenderAnti')
+    INT AntiSamples = 4; // Anti-aliased frame samples per pixel
+    gbuffer Features;  // Color and denoiser feature buffers
+    BOOL IsDenoise = FALSE;  // Denoise rendered frame flag
+    preview Preview;   // Interactive navigation preview
+    BOOL IsFreeCam = FALSE;  // Camera was set by navigation flag
+    BOOL IsAnimGeom = FALSE; // Movable shapes animation flag (see 'AnimateGeometry')
+    DBL NavSpeed = 1;  // Navigation step per key press
+    INT RenderThreads = 0; // Render threads count (0 for all pool workers but one)
+    seq_writer Seq;    // Animation sequence file writer
+    BOOL IsSeqMode = FALSE;  // Store animation to one sequence file (TGA per frame otherwise)
+    render_job Job;    // Animation render job (frames are claimed from manifest)
+    std::string JobFile = "bin/images/Saves/anim.gjob"; // Animation job manifest file
+    std::string SceneFile;   // Loaded scene snapshot file (empty for default scene)
+    render_cache Cache;      // Rendered strips disk cache
+    BOOL IsCacheMode = FALSE; // Load unchanged strips from cache (not with cost map or denoise)
 
     // Background brush
     HBRUSH hBrBack;
 
     // Mouse store coordinates
     INT MouseX, MouseY;
+
+    // Region of interest re-render data
+    BOOL IsRoiSelect = FALSE;    // Rectangle selection (Ctrl + left drag) flag
+    INT
+      RoiX0 = 0, RoiY0 = 0,      // Selection start frame point
+      RoiX1 = 0, RoiY1 = 0,      // Selection end frame point
+      RoiSamples = 16;           // Region samples per pixel
  
     // Image data
     INT
@@ -58,8 +91,35 @@ namespace gort
     /* Ray tracing window destructor */
     ~rt_win()
     {
+      Preview.Stop();
       Scene.Clear();
     }
+
+    /* Start animation job render function (frames are rendered till job end or stop).
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID StartJob( VOID )
+    {
+      PostMessage(hWnd, WM_TIMER, 30, 0);
+    } /* End of 'StartJob' function */
+
+    /* Print scene and window buffers memory function (no render should be active).
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID PrintMemory( VOID )
+    {
+      mem_report rep;
+
+      Scene.Account(rep);
+      rep.Add("frame", "color", 1, Frm.Memory());
+      rep.Add("frame", "cost map", 1, CostMap.Memory());
+      rep.Add("frame", "features", 1, Features.Memory());
+      rep.Print(std::cout, Scene.MemoryBudget);
+      if (Scene.IsOverBudget)
+        std::cout << "Scene is over memory budget, some shapes are not added" << std::endl;
+    } /* End of 'PrintMemory' function */
   private:
     /* Update frame image drawing data function.
      * ARGUMENTS: None.
@@ -175,6 +235,50 @@ namespace gort
       }
 } /* End of 'FlipFullScreen' function */
 
+    /* Window point to frame point conversion function.
+     * ARGUMENTS:
+     *   - window point to convert:
+     *       INT *X, *Y;
+     * RETURNS: None.
+     */
+    VOID WinToFrame( INT *X, INT *Y )
+    {
+      *X -= ImgX;
+      *Y -= ImgY;
+      if (ImgZoom < 0)
+      {
+        *X *= -ImgZoom;
+        *Y *= -ImgZoom;
+      }
+      else
+      {
+        *X /= ImgZoom;
+        *Y /= ImgZoom;
+      }
+    } /* End of 'WinToFrame' function */
+
+    /* Frame point to window point conversion function.
+     * ARGUMENTS:
+     *   - frame point to convert:
+     *       INT *X, *Y;
+     * RETURNS: None.
+     */
+    VOID FrameToWin( INT *X, INT *Y )
+    {
+      if (ImgZoom < 0)
+      {
+        *X /= -ImgZoom;
+        *Y /= -ImgZoom;
+      }
+      else
+      {
+        *X *= ImgZoom;
+        *Y *= ImgZoom;
+      }
+      *X += ImgX;
+      *Y += ImgY;
+    } /* End of 'FrameToWin' function */
+
     /* Ray tracing frame resize function
      * ARGUMENTS: 
      *   - new frame size:
@@ -187,83 +291,303 @@ namespace gort
       Cam.Resize(NewW, NewH);
     }
 
+    /* Obtain render threads count function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (INT) threads count (one pool worker is left for interface by default).
+     */
+    INT Threads( VOID )
+    {
+      if (RenderThreads > 0)
+        return RenderThreads;
+      return max(Scene.Pool.Count() - 1, 1);
+    } /* End of 'Threads' function */
+
+    /* Place movable shapes by frame time function.
+     * Shapes are turned around world Y axis from their rest pose (see
+     * 'shape::SetTransform'), so geometry depends on frame time only and
+     * job frames may be rendered in any order. Shapes acceleration data
+     * is refitted after move.
+     * ARGUMENTS:
+     *   - frame time in seconds:
+     *       DBL T;
+     * RETURNS: None.
+     */
+    VOID AnimateGeometry( DBL T )
+    {
+      timeline_scope ts("geometry animation");
+      matr m = matr::RotateY(T * 30);
+      INT moved = 0;
+
+      for (auto shp : Scene.Shapes)
+        moved += shp->SetTransform(m);
+      if (moved > 0)
+        Scene.Refit(Threads());
+    } /* End of 'AnimateGeometry' function */
+
     /* Render ray tacing frame function
      * ARGUMENTS: None.
      * RETURNS: None.
      */
     VOID Render( VOID )
     {
-      Cam.SetLocAtUp(vec3(sin(Time.SyncTime) * 5, 17, -20), vec3(0, 0, 0), vec3(0, 1, 0));
-      INT n = std::thread::hardware_concurrency() - 1;
+      {
+        timeline_scope ts("camera setup");
+        if (!IsFreeCam)
+          Cam.SetLocAtUp(vec3(sin(Time.SyncTime) * 5, 17, -20), vec3(0, 0, 0), vec3(0, 1, 0));
+      }
+      if (IsAnimGeom)
+        AnimateGeometry(Time.SyncTime);
+      INT n = Threads();
 #ifndef NDEBUG
       //n = 1;
       std::cout << "Debug mode." << std::endl;
 #endif /* NDEBUG */
-      std::vector<std::thread> Ths;
-      Ths.resize(n);
-      Scene.StartRow = 0;
-      for (INT i = 0; i < n; i++)
+      if (IsCostMode)
+        CostMap.Resize(Frm.W, Frm.H);
+      if (IsDenoise)
+        Features.Resize(Frm.W, Frm.H);
+      if (IsCacheMode && !IsCostMode && !IsDenoise)
+        Cache.Render(Scene, Frm, Cam, n);
+      else
+        Scene.Render(Frm, Cam, n, IsCostMode ? &CostMap : nullptr, IsDenoise ? &Features : nullptr);
+      if (Scene.IsCaustics && Scene.Caustics.Emitted > 0)
+        std::cout << "Caustics: " << Scene.Caustics.Size() << " of " << Scene.Caustics.Emitted << " photons stored, " <<
+          Scene.Caustics.Memory() / (1024.0 * 1024.0) << " MB, trace " << Scene.Caustics.TraceTime * 1000 <<
+          " ms, kd-tree " << Scene.Caustics.BuildTime * 1000 << " ms" << std::endl;
+      if (Scene.IsIrrCache)
+        std::cout << "Irradiance cache: " << Scene.Irr.Size() << " records, " <<
+          Scene.Irr.Memory() / (1024.0 * 1024.0) << " MB" << std::endl;
+      if (IsDenoise && !Scene.IsToBeStop)
+      {
+        timeline_scope ts("denoise");
+        Features.Denoise(Scene.Pool, n + 1);
+        Features.ToFrame(Frm);
+      }
+    } /* End of 'Render' function */
+
+    /* Re-render frame rectangle in background function.
+     * Rest of frame is kept, camera is not changed.
+     * ARGUMENTS:
+     *   - frame rectangle corners (X1, Y1 are excluded):
+     *       INT X0, Y0, X1, Y1;
+     * RETURNS: None.
+     */
+    VOID RenderRoi( INT X0, INT Y0, INT X1, INT Y1 )
+    {
+      if (Scene.IsRenderActive)
+        return;
+      Scene.IsRenderActive = TRUE;
+      Scene.IsToBeStop = FALSE;
+      Scene.IsReadyToFinish = FALSE;
+      std::thread Th;
+      Th = std::thread(
+        [&, X0, Y0, X1, Y1]( VOID )
+        {
+          timeline::Get().SetThread(1, "render");
+          timeline_scope ts("region");
+          INT n = Threads();
+          BOOL IsCost = IsCostMode && CostMap.W == Frm.W && CostMap.H == Frm.H;
+          auto t0 = std::chrono::steady_clock::now();
+          cost c = IsCacheMode && !IsCost ?
+            Cache.RenderRect(Cache.Key(Scene, Cam, RoiSamples), Scene, Frm, Cam, n, X0, Y0, X1, Y1, RoiSamples) :
+            Scene.RenderRect(Frm, Cam, n, X0, Y0, X1, Y1, RoiSamples, IsCost ? &CostMap : nullptr);
+          auto t1 = std::chrono::steady_clock::now();
+
+          std::cout << "Region (" << X0 << "," << Y0 << ")-(" << X1 << "," << Y1 << ") " <<
+            RoiSamples << " spp rendered. Time: " <<
+            std::chrono::duration<DBL>(t1 - t0).count() << " s, rays: " << c.Rays << std::endl;
+          if (X1 - X0 == 1 && Y1 - Y0 == 1)
+            printf("c: %08X x:%5d y:%5d\n", Frm.GetPixel(X0, Y0), X0, Y0);
+          InvalidateRect(hWnd, NULL, FALSE);
+          Scene.IsRenderActive = FALSE;
+          Scene.IsToBeStop = FALSE;
+          Scene.IsReadyToFinish = TRUE;
+        });
+      Th.detach();
+    } /* End of 'RenderRoi' function */
+
+    /* Switch interactive navigation mode function.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID FlipInteractive( VOID )
+    {
+      if (Preview.IsActive)
+      {
+        Cam = Preview.Stop();
+        Scene.IsRenderActive = FALSE;
+        Scene.IsReadyToFinish = TRUE;
+        std::cout << "Interactive mode off" << std::endl;
+      }
+      else if (!Scene.IsRenderActive)
       {
-        Ths[i] = std::thread(
-        [&]( VOID )
+        Scene.IsRenderActive = TRUE;
+        Scene.IsReadyToFinish = FALSE;
+        IsFreeCam = TRUE;
+        Preview.Samples = RoiSamples;
+        Preview.Start(Scene, Cam, Threads(),
+          [this]( VOID )
           {
-            INT y = 0;
-            while (y < Frm.H)
-            {
-              y = Scene.StartRow++;
-              for (INT xs = 0; xs < Frm.W; xs++)
-              {
-                if (Scene.IsToBeStop)
-                  return;
-                ray R = Cam.FrameRay(xs + 0.5, y - 0.5);
-                vec3 color = Scene.Trace(R, Scene.Air, 1, 0);
-                Frm.PutPixel(xs, y, frame::ToRGB(color[0], color[1], color[2]));
-              }
-            }
+            InvalidateRect(hWnd, NULL, FALSE);
           });
+        std::cout << "Interactive mode on: left drag - turn, wheel/arrows/PgUp/PgDn - move" << std::endl;
       }
-      for (INT i = 0; i < n; i++)
-        Ths[i].join();
-    } /* End of 'Render' function */
+      InvalidateRect(hWnd, NULL, FALSE);
+    } /* End of 'FlipInteractive' function */
 
-    /* Render ray tacing frame function
+    /* Store timeline trace and stop tracing function.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID SaveTimeline( VOID )
+    {
+      if (!timeline::Get().IsEnabled)
+        return;
+      timeline::Get().IsEnabled = FALSE;
+
+      std::string Name = frame::AutoSaveName() + "_trace.json";
+      if (timeline::Get().SaveJSON(Name))
+        std::cout << "Timeline saved to " << Name << std::endl;
+    } /* End of 'SaveTimeline' function */
+
+    /* Create animation job or open existing one function.
+     * New job is all animation frames of current frame size, finished
+     * job is started again.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise.
+     */
+    BOOL OpenJob( VOID )
+    {
+      job_header desc {};
+
+      strncpy(desc.Scene, SceneFile.c_str(), sizeof(desc.Scene) - 1);
+      strcpy(desc.Output, "bin/images/Saves/%d.tga");
+      desc.FirstFrame = 0;
+      desc.LastFrame = RENDER_SECONDS * COUNT_IN_SECOND - 1;
+      desc.W = Frm.W;
+      desc.H = Frm.H;
+      desc.FramesPerSecond = COUNT_IN_SECOND;
+      desc.StripH = 64;
+      std::filesystem::create_directories("bin/images/Saves");
+      if (!Job.Create(JobFile, desc))
+      {
+        std::cout << "Can't open animation job " << JobFile << std::endl;
+        return FALSE;
+      }
+      if (Job.Left() == 0)
+      {
+        // Job is done by this or other workers, so animation is rendered anew
+        std::cout << "Animation job " << JobFile << " is finished, starting new one (frames are overwritten)" << std::endl;
+        if (!Job.Restart(desc))
+        {
+          std::cout << "Can't restart animation job " << JobFile << std::endl;
+          Job.Close();
+          return FALSE;
+        }
+      }
+      std::cout << "Animation job " << JobFile << ": " << Job.Left() << " of " << Job.Count() << " frames left" << std::endl;
+      return TRUE;
+    } /* End of 'OpenJob' function */
+
+    /* Render claimed job frame by checkpointed rows strips function.
+     * Rows stored by previous (stopped or crashed) render are loaded.
+     * ARGUMENTS:
+     *   - frame number:
+     *       INT FrameNo;
+     * RETURNS:
+     *   (BOOL) TRUE if frame is finished, FALSE if render was stopped.
+     */
+    BOOL RenderJobFrame( INT FrameNo )
+    {
+      const job_header &h = Job.Header();
+      INT n = Threads(), y, samples = Scene.IsPath ? Scene.PathSamples : 1;
+      UINT64 key = 0;
+
+      {
+        timeline_scope ts("camera setup");
+        if (Frm.W != h.W || Frm.H != h.H)
+        {
+          Frm.Resize(h.W, h.H);
+          Cam.Resize(h.W, h.H);
+        }
+        if (!IsFreeCam)
+          Cam.SetLocAtUp(vec3(sin(Time.SyncTime) * 5, 17, -20), vec3(0, 0, 0), vec3(0, 1, 0));
+      }
+      if (IsAnimGeom)
+        AnimateGeometry(Time.SyncTime);
+      if (IsCostMode)
+        CostMap.Resize(Frm.W, Frm.H);
+      // Photons and irradiance records are per frame (see 'rt::scene::Render')
+      Scene.Caustics.Clear();
+      if (!Scene.IsIrrCacheKeep)
+        Scene.Irr.Clear();
+      if ((y = Job.LoadRows(FrameNo, Frm)) > 0)
+        std::cout << "Frame " << FrameNo << " resumed from row " << y << std::endl;
+      // Scene is hashed once per frame
+      if (IsCacheMode && !IsCostMode)
+        key = Cache.Key(Scene, Cam, samples);
+      for (; y < h.H; y += h.StripH)
+      {
+        INT y1 = min(y + h.StripH, h.H);
+
+        if (key != 0)
+          Cache.RenderRect(key, Scene, Frm, Cam, n, 0, y, h.W, y1, samples);
+        else
+          Scene.RenderRect(Frm, Cam, n, 0, y, h.W, y1, samples, IsCostMode ? &CostMap : nullptr);
+        // Stopped strip is not complete
+        if (Scene.IsToBeStop)
+          return FALSE;
+        Job.StoreRows(FrameNo, Frm, y, y1);
+      }
+      return TRUE;
+    } /* End of 'RenderJobFrame' function */
+
+    /* Store scene snapshot function.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID SaveSnapshot( VOID )
+    {
+      std::string Name = frame::AutoSaveName() + ".gsnp";
+      INT skipped = snapshot::Save(Scene, Cam, Name);
+
+      if (skipped < 0)
+        std::cout << "Snapshot write failed: " << Name << std::endl;
+      else
+        std::cout << "Snapshot saved to " << Name << " (" << skipped << " custom shapes skipped)" << std::endl;
+    } /* End of 'SaveSnapshot' function */
+
+    /* Render anti-aliased ray tacing frame function.
+     * Frame is rendered by 'AntiSamples' samples per pixel, cost map is filled
+     * as in 'Render'.
      * ARGUMENTS: None.
      * RETURNS: None.
      */
     VOID RenderAnti( VOID )
     {
-      Cam.SetLocAtUp(vec3(sin(Time.SyncTime) * 5, 17, -20), vec3(0, 0, 0), vec3(0, 1, 0));
-      INT n = std::thread::hardware_concurrency() - 1;
+      {
+        timeline_scope ts("camera setup");
+        if (!IsFreeCam)
+          Cam.SetLocAtUp(vec3(sin(Time.SyncTime) * 5, 17, -20), vec3(0, 0, 0), vec3(0, 1, 0));
+      }
+      if (IsAnimGeom)
+        AnimateGeometry(Time.SyncTime);
+      INT n = Threads();
 #ifndef NDEBUG
       //n = 1;
       std::cout << "Debug mode." << std::endl;
 #endif /* NDEBUG */
-      std::vector<std::thread> Ths;
-      Ths.resize(n);
-      Scene.StartRow = 0;
-      for (INT i = 0; i < n; i++)
-      {
-        Ths[i] = std::thread(
-        [&]( VOID )
-          {
-            INT y = 0;
-            while (y < Frm.H)
-            {
-              y = Scene.StartRow++;
-              for (INT xs = 0; xs < Frm.W; xs++)
-              {
-                if (Scene.IsToBeStop)
-                  return;
-                ray R = Cam.FrameRay(xs + 0.5, y - 0.5);
-                vec3 color = Scene.Trace(R, Scene.Air, 1, 0);
-                Frm.PutPixel(xs, y, frame::ToRGB(color[0], color[1], color[2]));
-              }
-            }
-          });
-      }
-      for (INT i = 0; i < n; i++)
-        Ths[i].join();
-    } /* End of 'Render' function */
+      if (IsCostMode)
+        CostMap.Resize(Frm.W, Frm.H);
+      // Per frame data as in 'rt::scene::Render'
+      Scene.Caustics.Clear();
+      if (!Scene.IsIrrCacheKeep)
+        Scene.Irr.Clear();
+      Scene.RenderRect(Frm, Cam, n, 0, 0, Frm.W, Frm.H, Scene.IsPath ? Scene.PathSamples : AntiSamples,
+        IsCostMode ? &CostMap : nullptr);
+    } /* End of 'RenderAnti' function */
 
     /* WM_SIZE window message handle function.
      * ARGUMENTS:
@@ -314,7 +638,25 @@ namespace gort
         // Draw bottom rect
         if (H - ImgY - ImgZoomH > 0)
           Rectangle(hDC, 0, ImgY + ImgZoomH, W + 1, H + 1);
-        Frm.Draw(hDC, ImgX, ImgY, ImgZoomW, ImgZoomH);
+        timeline_scope ts("frame draw");
+        if (Preview.IsActive)
+          Preview.Draw(hDC, ImgX, ImgY, ImgZoomW, ImgZoomH);
+        else
+          Frm.Draw(hDC, ImgX, ImgY, ImgZoomW, ImgZoomH);
+
+        // Draw region of interest selection
+        if (IsRoiSelect)
+        {
+          INT
+            x0 = min(RoiX0, RoiX1), y0 = min(RoiY0, RoiY1),
+            x1 = max(RoiX0, RoiX1) + 1, y1 = max(RoiY0, RoiY1) + 1;
+
+          FrameToWin(&x0, &y0);
+          FrameToWin(&x1, &y1);
+          SelectObject(hDC, GetStockObject(NULL_BRUSH));
+          SelectObject(hDC, GetStockObject(WHITE_PEN));
+          Rectangle(hDC, x0, y0, x1, y1);
+        }
       }
       else
         Rectangle(hDC, 0, 0, W + 1, H + 1); 
@@ -329,49 +671,109 @@ namespace gort
      */
     VOID OnTimer( INT Id ) override
     {
-      if (Id == 30)
+      if (Id == 30 && !Scene.IsRenderActive)
       {
-        static INT cnt = 0;
-        if (cnt < RENDER_SECONDS * COUNT_IN_SECOND)
+        // Frames are claimed from job manifest, so stopped or crashed animation is resumed
+        INT FrameNo = Job.IsOpen() || OpenJob() ? Job.Claim() : -1;
+
+        if (FrameNo < 0)
         {
-          if (!Scene.IsRenderActive)
+          if (Seq.IsOpen())
           {
-            Time.SyncTime = cnt * 1.0 / COUNT_IN_SECOND;
-            Scene.IsRenderActive = TRUE;
-            Scene.IsToBeStop = FALSE;
-            Scene.IsReadyToFinish = FALSE;
-            std::cout << "Start render scene" << std::endl;
-            std::thread Th;
-            Th = std::thread(
-              [&]( VOID )
+            Seq.Close();
+            std::cout << "Sequence part stored: " << Seq.Count() << " frames, " <<
+              Seq.Size() / (1024.0 * 1024.0) << " MB" << std::endl;
+          }
+          if (Job.IsOpen())
+          {
+            std::cout << "Animation job " << JobFile << ": " << Job.Left() << " frames left for other workers" << std::endl;
+            // Last finished worker joins all workers parts
+            INT Merged = Job.MergeSeq(
+              []( const std::vector<std::string> &Parts, const std::string &Name )
               {
-                LONG tt = clock();
-                Render();
-                tt = clock() - tt;
-                INT Seconds = (INT)((DBL)tt / CLOCKS_PER_SEC);
-
-                std::cout <<
-                  std::fixed << (DBL)tt / CLOCKS_PER_SEC <<
-                  " :: " << std::setfill('0') << std::setw(2) <<
-                                                  Seconds / 60 / 60 <<
-                  ":" << std::setfill('0') << std::setw(2) <<
-                                                  Seconds / 60 % 60 <<
-                  ":" << std::setfill('0') << std::setw(2) <<
-                                                  Seconds % 60 << "\r";
-                
-                Frm.SaveTGA(std::string("bin/images/Saves/") + std::to_string(cnt) + std::string(".tga"), "VG6 Ray Tracing", 
-                  {Seconds / 60 / 60, Seconds / 60 % 60, Seconds % 60});
-                std::cout << "Scene rendered" << Seconds / 60 / 60 << ", " << Seconds / 60 % 60 << ", " << Seconds % 60 << std::endl;
-                InvalidateRect(hWnd, NULL, FALSE);
-                UpdateWindow(hWnd);
-                Scene.IsRenderActive = FALSE;
-                Scene.IsReadyToFinish = TRUE;
-                if (!Scene.IsToBeStop)
-                  SendMessage(hWnd, WM_TIMER, 30, 0);
+                return seq_writer().Merge(Parts, Name);
               });
-            Th.detach();
-            cnt++;
+
+            if (Merged > 0)
+              std::cout << "Sequence " << Job.SeqName() << " merged: " << Merged << " frames" << std::endl;
+            else if (Merged < 0)
+              std::cout << "Can't merge sequence " << Job.SeqName() << std::endl;
           }
+          Job.Close();
+          if (IsCacheMode)
+            Cache.Print(std::cout);
+          SaveTimeline();
+        }
+        else
+        {
+          Time.SyncTime = FrameNo * 1.0 / Job.Header().FramesPerSecond;
+          Scene.IsRenderActive = TRUE;
+          Scene.IsToBeStop = FALSE;
+          Scene.IsReadyToFinish = FALSE;
+          std::cout << "Start render frame " << FrameNo << std::endl;
+          std::thread Th;
+          Th = std::thread(
+            [&, FrameNo]( VOID )
+            {
+              timeline::Get().SetThread(1, "render");
+              timeline_scope ts("frame", FrameNo);
+              LONG tt = clock();
+              BOOL IsDone = RenderJobFrame(FrameNo);
+              tt = clock() - tt;
+              INT Seconds = (INT)((DBL)tt / CLOCKS_PER_SEC);
+
+              std::cout <<
+                std::fixed << (DBL)tt / CLOCKS_PER_SEC <<
+                " :: " << std::setfill('0') << std::setw(2) <<
+                                                Seconds / 60 / 60 <<
+                ":" << std::setfill('0') << std::setw(2) <<
+                                                Seconds / 60 % 60 <<
+                ":" << std::setfill('0') << std::setw(2) <<
+                                                Seconds % 60 << "\r";
+
+              std::string Name = Job.FrameName(FrameNo);
+              if (!IsDone)
+              {
+                // Stored rows are kept for resume
+                Job.Release(FrameNo);
+                std::cout << "Frame " << FrameNo << " stopped" << std::endl;
+              }
+              else
+              {
+                if (IsSeqMode)
+                {
+                  // Frame is compressed and written by sequence writer thread to this worker part of job sequence
+                  if (!Seq.IsOpen() && !Seq.Open(Job.SeqPartName(), Frm.W, Frm.H))
+                    std::cout << "Can't create " << Job.SeqPartName() << std::endl;
+                  // Frame is finished only when it is on disk
+                  Seq.Push(Frm, FrameNo);
+                  Seq.Flush();
+                }
+                else
+                {
+                  timeline_scope tga("tga write", FrameNo);
+                  Frm.SaveTGA(Name, "VG6 Ray Tracing",
+                    {Seconds / 60 / 60, Seconds / 60 % 60, Seconds % 60});
+                }
+                if (IsCostMode)
+                  CostMap.Save(Name);
+                Job.Finish(FrameNo);
+                std::cout << "Scene rendered" << Seconds / 60 / 60 << ", " << Seconds / 60 % 60 << ", " << Seconds % 60 << std::endl;
+              }
+              InvalidateRect(hWnd, NULL, FALSE);
+              UpdateWindow(hWnd);
+              Scene.IsRenderActive = FALSE;
+              Scene.IsReadyToFinish = TRUE;
+              if (!Scene.IsToBeStop)
+                SendMessage(hWnd, WM_TIMER, 30, 0);
+              else
+              {
+                if (Seq.IsOpen())
+                  Seq.Close();
+                SaveTimeline();
+              }
+            });
+          Th.detach();
         }
       }
       InvalidateRect(hWnd, NULL, FALSE);
@@ -386,6 +788,7 @@ namespace gort
      */
     BOOL OnCreate( CREATESTRUCT *CS ) override
     {
+      timeline::Get().SetThread(0, "ui");
       SetTimer(hWnd, 0, 100, nullptr);
       Resize(200 * 16, 200 * 9);
       ImgZoomW = 400;
@@ -405,6 +808,11 @@ namespace gort
      */
     VOID OnMouseWheel( INT X, INT Y, INT Z, UINT Keys ) override
     {
+      if (Preview.IsActive)
+      {
+        Preview.Navigate(vec3(0, 0, NavSpeed * Z / 120), 0, 0);
+        return;
+      }
       INT
         OldZoomW = ImgZoomW,
         OldZoomH = ImgZoomH;
@@ -445,25 +853,18 @@ namespace gort
       MouseX = X;
       MouseY = Y;
  
+      if ((Keys & MK_LBUTTON) && (Keys & MK_CONTROL) && !Scene.IsRenderActive)
+      {
+        WinToFrame(&X, &Y);
+        IsRoiSelect = TRUE;
+        RoiX0 = RoiX1 = X;
+        RoiY0 = RoiY1 = Y;
+      }
       if (Keys & MK_MBUTTON)
       {
-        X -= ImgX;
-        Y -= ImgY;
-        if (ImgZoom < 0)
-        {
-          X *= -ImgZoom;
-          Y *= -ImgZoom;
-        }
-        else
-        {
-          X /= ImgZoom;
-          Y /= ImgZoom;
-        }
-        printf("c: %08X x:%5d y:%5d\n", Frm.GetPixel(X, Y), X, Y);
-        ray r = Cam.FrameRay(X + 0.5, Y + 0.5);
-        vec3 c = Scene.Trace(r, Scene.Air, 1, 0);
- 
-        printf("Render (%d,%d):RGB(%.3f,%.3f,%.3f)\n", X, Y, c[0], c[1], c[2]);
+        WinToFrame(&X, &Y);
+        // Re-render single pixel (its color is printed after render)
+        RenderRoi(X, Y, X + 1, Y + 1);
       }
     } /* End of 'OnButtonDown' function */
  
@@ -478,6 +879,12 @@ namespace gort
     VOID OnButtonUp( INT X, INT Y, UINT Keys ) override
     {
       ReleaseCapture();
+      if (IsRoiSelect)
+      {
+        IsRoiSelect = FALSE;
+        RenderRoi(min(RoiX0, RoiX1), min(RoiY0, RoiY1), max(RoiX0, RoiX1) + 1, max(RoiY0, RoiY1) + 1);
+        InvalidateRect(hWnd, NULL, FALSE);
+      }
     } /* End of 'OnButtonUp' function */
  
     /* WM_MOUSEMOVE window message handle function.
@@ -490,6 +897,21 @@ namespace gort
      */
     VOID OnMouseMove( INT X, INT Y, UINT Keys ) override
     {
+      if (IsRoiSelect)
+      {
+        WinToFrame(&X, &Y);
+        RoiX1 = X;
+        RoiY1 = Y;
+        InvalidateRect(hWnd, NULL, FALSE);
+        return;
+      }
+      if ((Keys & MK_LBUTTON) && Preview.IsActive)
+      {
+        Preview.Navigate(vec3(0), (X - MouseX) * 0.3, (Y - MouseY) * 0.3);
+        MouseX = X;
+        MouseY = Y;
+        return;
+      }
       if (Keys & MK_LBUTTON)
       {
         ImgX += X - MouseX;
@@ -501,18 +923,7 @@ namespace gort
       }
       if (Keys & MK_RBUTTON)
       {
-        X -= ImgX;
-        Y -= ImgY;
-        if (ImgZoom < 0)
-        {
-          X *= -ImgZoom;
-          Y *= -ImgZoom;
-        }
-        else
-        {
-          X /= ImgZoom;
-          Y /= ImgZoom;
-        }
+        WinToFrame(&X, &Y);
         printf("c: %08X x:%5d y:%5d\n", Frm.GetPixel(X, Y), X, Y);
       }
     } /* End of 'OnMouseMove' function */
@@ -602,6 +1013,24 @@ namespace gort
     switch(Msg)
     {
       case WM_KEYDOWN:
+        if (Preview.IsActive)
+        {
+          static const std::pair<WPARAM, vec3> Moves[] =
+          {
+            {VK_UP, vec3(0, 0, 1)}, {VK_DOWN, vec3(0, 0, -1)},
+            {VK_RIGHT, vec3(1, 0, 0)}, {VK_LEFT, vec3(-1, 0, 0)},
+            {VK_PRIOR, vec3(0, 1, 0)}, {VK_NEXT, vec3(0, -1, 0)},
+          };
+
+          for (auto &m : Moves)
+            if (wParam == m.first)
+              Preview.Navigate(m.second * NavSpeed, 0, 0);
+          if (wParam == 'I' || wParam == VK_ESCAPE)
+            FlipInteractive();
+          return 0;
+        }
+        if (wParam == 'I')
+          FlipInteractive();
         if (wParam == 'C')
         {
           Frm.Fill(0x00302908);
@@ -619,8 +1048,13 @@ namespace gort
             Th = std::thread(
               [&]( VOID )
               {
+                timeline::Get().SetThread(1, "render");
+                timeline_scope ts("frame");
                 LONG tt = clock();
-                Render();
+                if (IsAnti)
+                  RenderAnti();
+                else
+                  Render();
                 tt = clock() - tt;
                 INT Seconds = (INT)((DBL)tt / CLOCKS_PER_SEC);
 
@@ -633,8 +1067,14 @@ namespace gort
                   ":" << std::setfill('0') << std::setw(2) <<
                                                  Seconds % 60 << "\r";
                 
-                Frm.AutoSaveTGA("CGSG forever!!!",
-                  {Seconds / 60 / 60, Seconds / 60 % 60, Seconds % 60});
+                std::string Name = frame::AutoSaveName();
+                {
+                  timeline_scope tga("tga write");
+                  Frm.SaveTGA(Name + ".tga", "CGSG forever!!!",
+                    {Seconds / 60 / 60, Seconds / 60 % 60, Seconds % 60});
+                }
+                if (IsCostMode)
+                  CostMap.Save(Name);
                 std::cout << "Scene rendered. Time: " << Seconds / 60 / 60 << ", " << Seconds / 60 % 60 << ", " << Seconds % 60 << std::endl;
                 InvalidateRect(hWnd, NULL, FALSE);
                 UpdateWindow(hWnd);
@@ -645,6 +1085,146 @@ namespace gort
             Th.detach();
           }
         }
+        else if (wParam == 'H')
+        {
+          if (!Scene.IsRenderActive)
+          {
+            static const CHAR *Names[] = {"ns", "tests", "rays"};
+
+            // Off, then heatmap of each metric
+            if (!IsCostMode)
+              IsCostMode = TRUE, CostMap.Metric = heatmap::Time;
+            else if (CostMap.Metric == heatmap::Rays)
+              IsCostMode = FALSE;
+            else
+              CostMap.Metric = (heatmap::METRIC)(CostMap.Metric + 1);
+            if (IsCostMode)
+              std::cout << "Cost heatmap mode on: " << Names[CostMap.Metric] << " per pixel" << std::endl;
+            else
+              std::cout << "Cost heatmap mode off" << std::endl;
+          }
+        }
+        else if (wParam == 'N')
+        {
+          if (!Scene.IsRenderActive)
+          {
+            IsAnti = !IsAnti;
+            std::cout << "Anti-aliased render (" << AntiSamples << " samples per pixel) " << (IsAnti ? "on" : "off") << std::endl;
+          }
+        }
+        else if (wParam == 'D')
+        {
+          if (!Scene.IsRenderActive)
+          {
+            IsDenoise = !IsDenoise;
+            std::cout << "Denoise mode " << (IsDenoise ? "on" : "off") << std::endl;
+          }
+        }
+        else if (wParam == 'V')
+        {
+          if (!Scene.IsRenderActive)
+          {
+            Scene.IsRaster = !Scene.IsRaster;
+            std::cout << "Rasterized primary visibility " << (Scene.IsRaster ? "on" : "off") << std::endl;
+          }
+        }
+        else if (wParam == 'P')
+        {
+          if (!Scene.IsRenderActive)
+          {
+            Scene.IsPath = !Scene.IsPath;
+            std::cout << "Path tracing " << (Scene.IsPath ? "on" : "off") << std::endl;
+          }
+        }
+        else if (wParam == 'K')
+        {
+          if (!Scene.IsRenderActive)
+          {
+            Scene.IsCaustics = !Scene.IsCaustics;
+            std::cout << "Caustics photon map " << (Scene.IsCaustics ? "on" : "off") << std::endl;
+          }
+        }
+        else if (wParam == 'G')
+        {
+          if (!Scene.IsRenderActive)
+          {
+            // Off, on, on with records kept between frames
+            Scene.IsIrrCacheKeep = Scene.IsIrrCache && !Scene.IsIrrCacheKeep;
+            Scene.IsIrrCache = !Scene.IsIrrCache || Scene.IsIrrCacheKeep;
+            if (!Scene.IsIrrCacheKeep)
+              Scene.Irr.Clear();
+            std::cout << "Irradiance cache " << (Scene.IsIrrCacheKeep ? "on (kept between frames)" : Scene.IsIrrCache ? "on" : "off") << std::endl;
+          }
+        }
+        else if (wParam == 'O')
+        {
+          if (!Scene.IsRenderActive)
+          {
+            IsAnimGeom = !IsAnimGeom;
+            std::cout << "Movable shapes (meshes, sphere clouds) animation " << (IsAnimGeom ? "on" : "off") << std::endl;
+          }
+        }
+        else if (wParam == 'Q')
+        {
+          if (!Scene.IsRenderActive)
+          {
+            IsSeqMode = !IsSeqMode;
+            std::cout << "Animation output " << (IsSeqMode ? "to sequence file" : "to TGA files") << std::endl;
+          }
+        }
+        else if (wParam == 'T')
+        {
+          if (!Scene.IsRenderActive)
+          {
+            if (timeline::Get().IsEnabled)
+              SaveTimeline();
+            else
+            {
+              timeline::Get().Clear();
+              timeline::Get().IsEnabled = TRUE;
+              std::cout << "Timeline tracing on" << std::endl;
+            }
+          }
+        }
+        else if (wParam == 'F')
+        {
+          if (!Scene.IsRenderActive)
+          {
+            INT moved = Scene.Flatten();
+            std::cout << moved << " shapes moved to typed arrays, " <<
+              Scene.Shapes.size() << " custom shapes left" << std::endl;
+          }
+        }
+        else if (wParam == 'S')
+        {
+          if (!Scene.IsRenderActive)
+            SaveSnapshot();
+        }
+        else if (wParam == 'M')
+        {
+          if (!Scene.IsRenderActive)
+            PrintMemory();
+        }
+        else if (wParam == 'L')
+        {
+          if (!Scene.IsRenderActive)
+          {
+            IsCacheMode = !IsCacheMode;
+            std::cout << "Render cache " << (IsCacheMode ? "on" : "off") << std::endl;
+            if (!IsCacheMode)
+              Cache.Print(std::cout);
+          }
+        }
+        else if (wParam == VK_ADD || wParam == VK_OEM_PLUS)
+        {
+          RoiSamples = min(RoiSamples * 2, 1024);
+          std::cout << "Region samples per pixel: " << RoiSamples << std::endl;
+        }
+        else if (wParam == VK_SUBTRACT || wParam == VK_OEM_MINUS)
+        {
+          RoiSamples = max(RoiSamples / 2, 1);
+          std::cout << "Region samples per pixel: " << RoiSamples << std::endl;
+        }
         else if (wParam == 'A')
         {
           SendMessage(hWnd, WM_TIMER, 30, lParam);
@@ -670,8 +1250,12 @@ namespace gort
    */
   VOID OnDestroy( VOID ) override
   {
+    if (Preview.IsActive)
+      FlipInteractive();
     if (!Scene.IsRenderActive)
     {
+      if (Cache.Hits + Cache.Misses + Cache.Unhashed > 0)
+        Cache.Print(std::cout);
       DeleteObject(hBrBack);
       KillTimer(hWnd,30);
       PostQuitMessage(30);
@@ -0,0 +1,143 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : sampler.h
+ * PURPOSE     : Raytracing project.
+ *               Low discrepancy path sampler module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : Dimension pairs are first two Sobol dimensions with
+ *               nested uniform (Owen) scrambling. Sample index is
+ *               shuffled by the same scrambling per pixel and pair,
+ *               so pairs are not correlated with each other, and
+ *               each pair is stratified for power of 2 prefixes.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#ifndef __sampler_h_
+#define __sampler_h_
+
+#include "def.h"
+
+/* Project namespace */
+namespace gort
+{
+  /* Path samples sequence class */
+  class path_sampler
+  {
+    UINT Seed;  // Pixel seed
+    UINT Index; // Sample number in pixel
+    UINT Dim;   // Next dimension pair number
+
+    /* Integer hash function.
+     * ARGUMENTS:
+     *   - value:
+     *       UINT X;
+     * RETURNS:
+     *   (UINT) hashed value.
+     */
+    static UINT Hash( UINT X )
+    {
+      X ^= X >> 16;
+      X *= 0x7FEB352Du;
+      X ^= X >> 15;
+      X *= 0x846CA68Bu;
+      X ^= X >> 16;
+      return X;
+    } /* End of 'Hash' function */
+
+    /* Reverse bits order function.
+     * ARGUMENTS:
+     *   - value:
+     *       UINT X;
+     * RETURNS:
+     *   (UINT) reversed value.
+     */
+    static UINT Reverse( UINT X )
+    {
+      X = (X << 16) | (X >> 16);
+      X = ((X & 0x00FF00FFu) << 8) | ((X & 0xFF00FF00u) >> 8);
+      X = ((X & 0x0F0F0F0Fu) << 4) | ((X & 0xF0F0F0F0u) >> 4);
+      X = ((X & 0x33333333u) << 2) | ((X & 0xCCCCCCCCu) >> 2);
+      X = ((X & 0x55555555u) << 1) | ((X & 0xAAAAAAAAu) >> 1);
+      return X;
+    } /* End of 'Reverse' function */
+
+    /* Nested uniform scrambling function.
+     * Laine-Karras permutation of reversed bits.
+     * ARGUMENTS:
+     *   - value:
+     *       UINT X;
+     *   - scrambling seed:
+     *       UINT S;
+     * RETURNS:
+     *   (UINT) scrambled value.
+     */
+    static UINT Scramble( UINT X, UINT S )
+    {
+      X = Reverse(X);
+      X += S;
+      X ^= X * 0x6C50B47Cu;
+      X ^= X * 0xB82F1E52u;
+      X ^= X * 0xC7AFE638u;
+      X ^= X * 0x8D22F6E6u;
+      return Reverse(X);
+    } /* End of 'Scramble' function */
+
+  public:
+    /* Class constructor.
+     * ARGUMENTS:
+     *   - pixel number:
+     *       UINT PixelNo;
+     *   - sample number in pixel:
+     *       UINT SampleNo;
+     */
+    path_sampler( UINT PixelNo, UINT SampleNo ) : Seed(Hash(PixelNo + 0x9E3779B9u)), Index(SampleNo), Dim(0)
+    {
+    } /* End of 'path_sampler' function */
+
+    /* Obtain next dimensions pair sample function.
+     * ARGUMENTS:
+     *   - result sample in [0, 1) square:
+     *       DBL *U, *V;
+     * RETURNS: None.
+     */
+    VOID Get2D( DBL *U, DBL *V )
+    {
+      UINT
+        s = Hash(Seed ^ Hash(Dim++)),
+        i = Scramble(Index, s),
+        x = Reverse(i),
+        y = 0;
+
+      // Second Sobol dimension
+      for (UINT v = 1u << 31; i != 0; i >>= 1, v ^= v >> 1)
+        if (i & 1)
+          y ^= v;
+      *U = Scramble(x, Hash(s + 1)) * (1.0 / 4294967296.0);
+      *V = Scramble(y, Hash(s + 2)) * (1.0 / 4294967296.0);
+    } /* End of 'Get2D' function */
+
+    /* Obtain next dimension sample function (uses dimensions pair).
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (DBL) sample in [0, 1).
+     */
+    DBL Get1D( VOID )
+    {
+      DBL u, v;
+
+      Get2D(&u, &v);
+      return u;
+    } /* End of 'Get1D' function */
+  }; /* End of 'path_sampler' class */
+} /* end of 'gort' namespace */
+
+#endif /* __sampler_h_ */
+
+/* END OF 'sampler.h' FILE */
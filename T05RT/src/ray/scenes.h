@@ -0,0 +1,145 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : scenes.h
+ * PURPOSE     : Raytracing project.
+ *               Predefined scenes module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : None.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#ifndef __scenes_h_
+#define __scenes_h_
+
+#include "rt_scene.h"
+#include "shp/shapes.h"
+#include "lgh/lights.h"
+
+/* Project namespace */
+namespace gort
+{
+  /* Predefined scenes namespace */
+  namespace scn
+  {
+    /* Material library entry */
+    struct mtl_lib
+    {
+      CHAR Name[100];
+      vec3 Ka, Kd, Ks;
+      DBL Ph;
+    }; /* End of 'mtl_lib' structure */
+
+    /* Material library */
+    inline const mtl_lib MtlLib[] =
+    {
+      {"Black Plastic",   {0.0, 0.0, 0.0},             {0.01, 0.01, 0.01},           {0.5, 0.5, 0.5},               32},
+      {"Brass",           {0.329412,0.223529,0.027451}, {0.780392,0.568627,0.113725}, {0.992157,0.941176,0.807843}, 27.8974},
+      {"Bronze",          {0.2125,0.1275,0.054},       {0.714,0.4284,0.18144},       {0.393548,0.271906,0.166721},  25.6},
+      {"Chrome",          {0.25, 0.25, 0.25},          {0.4, 0.4, 0.4},              {0.774597, 0.774597, 0.774597}, 76.8},
+      {"Copper",          {0.19125,0.0735,0.0225},     {0.7038,0.27048,0.0828},      {0.256777,0.137622,0.086014},  12.8},
+      {"Gold",            {0.24725,0.1995,0.0745},     {0.75164,0.60648,0.22648},    {0.628281,0.555802,0.366065},  51.2},
+      {"Peweter",         {0.10588,0.058824,0.113725}, {0.427451,0.470588,0.541176}, {0.3333,0.3333,0.521569},      9.84615},
+      {"Silver",          {0.19225,0.19225,0.19225},   {0.50754,0.50754,0.50754},    {0.508273,0.508273,0.508273},  51.2},
+      {"Polished Silver", {0.23125,0.23125,0.23125}, {0.2775,0.2775,0.2775},       {0.773911,0.773911,0.773911},  89.6},
+      {"Turquoise",       {0.1, 0.18725, 0.1745},      {0.396, 0.74151, 0.69102},    {0.297254, 0.30829, 0.306678}, 12.8},
+      {"Ruby",            {0.1745, 0.01175, 0.01175},  {0.61424, 0.04136, 0.04136},  {0.727811, 0.626959, 0.626959}, 76.8},
+      {"Polished Gold",   {0.24725, 0.2245, 0.0645},   {0.34615, 0.3143, 0.0903},    {0.797357, 0.723991, 0.208006}, 83.2},
+      {"Polished Bronze", {0.25, 0.148, 0.06475},    {0.4, 0.2368, 0.1036},        {0.774597, 0.458561, 0.200621}, 76.8},
+      {"Polished Copper", {0.2295, 0.08825, 0.0275}, {0.5508, 0.2118, 0.066},      {0.580594, 0.223257, 0.0695701}, 51.2},
+      {"Jade",            {0.135, 0.2225, 0.1575},     {0.135, 0.2225, 0.1575},      {0.316228, 0.316228, 0.316228}, 12.8},
+      {"Obsidian",        {0.05375, 0.05, 0.06625},    {0.18275, 0.17, 0.22525},     {0.332741, 0.328634, 0.346435}, 38.4},
+      {"Pearl",           {0.25, 0.20725, 0.20725},    {1.0, 0.829, 0.829},          {0.296648, 0.296648, 0.296648}, 11.264},
+      {"Emerald",         {0.0215, 0.1745, 0.0215},    {0.07568, 0.61424, 0.07568},  {0.633, 0.727811, 0.633},       76.8},
+      {"Black Plastic",   {0.0, 0.0, 0.0},             {0.01, 0.01, 0.01},           {0.5, 0.5, 0.5},                32.0},
+      {"Black Rubber",    {0.02, 0.02, 0.02},          {0.01, 0.01, 0.01},           {0.4, 0.4, 0.4},                10.0},
+    };
+    inline const INT MtlSize = sizeof(MtlLib) / sizeof(mtl_lib);
+
+    /* Set surface from material library function.
+     * ARGUMENTS:
+     *   - surface to fill:
+     *       surface &Mtl;
+     *   - library material number (any, wraps around):
+     *       INT No;
+     * RETURNS: None.
+     */
+    inline VOID SetMtl( surface &Mtl, INT No )
+    {
+      const mtl_lib &m = MtlLib[No % MtlSize];
+
+      Mtl.Ka = m.Ka;
+      Mtl.Kd = m.Kd;
+      Mtl.Ks = m.Ks;
+      Mtl.Ph = m.Ph;
+    } /* End of 'SetMtl' function */
+
+    /* Build default box/plane scene function.
+     * ARGUMENTS:
+     *   - scene to fill:
+     *       rt::scene &Scene;
+     *   - camera to setup:
+     *       camera &Cam;
+     * RETURNS: None.
+     */
+    inline VOID Default( rt::scene &Scene, camera &Cam )
+    {
+      surface mtl;
+
+      Scene.AmbientColor = vec3(0.1);
+
+      mtl.Ka = vec3(0.19225, 0.19225, 0.19225);
+      mtl.Kd = vec3(0.50754, 0.50754, 0.50754);
+      mtl.Ks = vec3(0.508273, 0.508273, 0.508273);
+      mtl.Ph = 51.2;
+      mtl.Kr = coef(0.1);
+      mtl.Kt = coef(0);
+
+      Scene << new plane(vec3(-1.5), vec3(0, 1, 0), Scene.Mtls.Add(mtl));
+
+      SetMtl(mtl, 2);
+      mtl.Kr = coef(0.10);
+      mtl.Kt = coef(0.90);
+
+      DWORD glass = Scene.Mtls.Add(mtl);
+
+      Scene << new plane(vec3(-35.5), vec3(0, 0, -1), glass);
+      Scene << new plane(vec3(40.5), vec3(0, -1, 0), glass);
+      Scene << new plane(vec3(35.5), vec3(0, 1, 1), glass);
+
+      for (INT i = 0; i < 50; i++)
+      {
+        SetMtl(mtl, 50 + i);
+        mtl.Kr = coef(rand() % 100 / 100.0);
+        mtl.Kt = coef(rand() % 100 / 100.0);
+        vec3 P = (vec3::Rnd1() * vec3(20, 15, 20)) + vec3(0, 15, 0);
+        shape *B = new sphere(P, rand() % 10 / 5.0);
+        B->Mtl = Scene.Mtls.Add(mtl, envi {1 + rand() % 100 / 200.0, 0});
+        Scene << B;
+        P = (vec3::Rnd1() * vec3(20, 15, 20)) + vec3(0, 15, 0);
+        B = new box(P + rand() % 10 / 5.0, P - rand() % 10 / 5.0);
+        B->Mtl = Scene.Mtls.Add(mtl, envi {1 + rand() % 100 / 200.0, 0});
+        Scene << B;
+      }
+
+      Cam.SetLocAtUp(vec3(4, 15, 26), vec3(0, 5, 0), vec3(0, 1, 0));
+      Cam.SetProj(0.1, 0.1, 500);
+
+      Scene << new lght::point(vec3(3, 0, 0),   5, vec3(1, 0, 0));
+      Scene << new lght::point(vec3(15, 8, -15),  63, vec3(0, 1, 0));
+      Scene << new lght::point(vec3(-15, 3, 15),  107, vec3(0, 0, 1));
+      Scene << new lght::point(vec3(0, 10, 5),     120, vec3(1, 1, 1));
+      Scene << new lght::direction(vec3(0, -10, -4), vec3(1, 1, 1));
+    } /* End of 'Default' function */
+  } /* End of 'scn' namespace */
+} /* end of 'gort' namespace */
+
+#endif /* __scenes_h_ */
+
+/* END OF 'scenes.h' FILE */
@@ -0,0 +1,655 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : sequence.h
+ * PURPOSE     : Raytracing project.
+ *               Compressed frames sequence file module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : File layout: 'seq_header', frame records (record
+ *               header, then data), frames index ('seq_index' per
+ *               frame) at 'IndexOffset'. Frame pixels are XOR-ed with
+ *               previous record frame (key frames with nothing), split
+ *               to four byte planes and each plane is PackBits RLE
+ *               coded, so unchanged areas and alpha cost about 1/64
+ *               byte per pixel. Key frame is stored every 'KeyInterval'
+ *               records, so seek decodes at most 'KeyInterval' frames.
+ *               Records keep animation frame number and are found by
+ *               it, so records order may differ from frames order (job
+ *               workers write own parts, 'Merge' joins them). Index is
+ *               written by 'Close', file without index (interrupted
+ *               render) is indexed by records scan on open.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#ifndef __sequence_h_
+#define __sequence_h_
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "frame.h"
+#include "timeline.h"
+
+/* Project namespace */
+namespace gort
+{
+  /* Sequence file header */
+  struct seq_header
+  {
+    DWORD Sign;         // "GSEQ"
+    DWORD Version;      // Format version
+    INT W, H;           // Frame size
+    INT FrameCount;     // Frames count (0 if file has no index)
+    INT KeyInterval;    // Key frames interval
+    UINT64 IndexOffset; // Frames index file offset (0 if file has no index)
+  }; /* End of 'seq_header' structure */
+
+  /* Sequence frame index record (also frame record header) */
+  struct seq_index
+  {
+    UINT64 Offset; // Frame data file offset
+    DWORD Size;    // Frame data size in bytes
+    DWORD IsKey;   // Key frame (not delta) flag
+    INT FrameNo;   // Animation frame number
+    DWORD Pad;     // Padding
+  }; /* End of 'seq_index' structure */
+
+  /* Sequence frame codec class */
+  class seq_codec
+  {
+  public:
+    // Current format version
+    static const DWORD Version = 2;
+
+    /* Encode frame function.
+     * ARGUMENTS:
+     *   - frame pixels:
+     *       const DWORD *Pixels;
+     *   - previous frame pixels (nullptr for key frame):
+     *       const DWORD *Prev;
+     *   - pixels count:
+     *       INT Count;
+     *   - result data (replaced):
+     *       std::vector<BYTE> &Out;
+     * RETURNS: None.
+     */
+    static VOID Encode( const DWORD *Pixels, const DWORD *Prev, INT Count, std::vector<BYTE> &Out )
+    {
+      std::vector<BYTE> plane(Count);
+
+      Out.clear();
+      for (INT p = 0; p < 4; p++)
+      {
+        for (INT i = 0; i < Count; i++)
+          plane[i] = (BYTE)((Pixels[i] ^ (Prev != nullptr ? Prev[i] : 0)) >> (p * 8));
+        PackBits(plane.data(), Count, Out);
+      }
+    } /* End of 'Encode' function */
+
+    /* Decode frame function.
+     * ARGUMENTS:
+     *   - frame data:
+     *       const BYTE *Data;
+     *       size_t Size;
+     *   - pixels (previous frame for delta frame, zeros for key frame), changed to frame:
+     *       DWORD *Pixels;
+     *   - pixels count:
+     *       INT Count;
+     * RETURNS:
+     *   (BOOL) TRUE if data is valid, FALSE otherwise.
+     */
+    static BOOL Decode( const BYTE *Data, size_t Size, DWORD *Pixels, INT Count )
+    {
+      size_t pos = 0;
+
+      for (INT p = 0; p < 4; p++)
+        for (INT i = 0; i < Count;)
+        {
+          if (pos >= Size)
+            return FALSE;
+
+          BYTE c = Data[pos++];
+
+          if (c < 128)
+          {
+            // Literal bytes
+            if (i + c + 1 > Count || pos + c + 1 > Size)
+              return FALSE;
+            for (INT k = 0; k <= c; k++)
+              Pixels[i++] ^= (DWORD)Data[pos++] << (p * 8);
+          }
+          else if (c > 128)
+          {
+            // Repeated byte
+            INT n = 257 - c;
+
+            if (i + n > Count || pos >= Size)
+              return FALSE;
+            for (DWORD v = (DWORD)Data[pos++] << (p * 8); n > 0; n--)
+              Pixels[i++] ^= v;
+          }
+        }
+      return pos == Size;
+    } /* End of 'Decode' function */
+
+  private:
+    /* PackBits RLE encode function.
+     * ARGUMENTS:
+     *   - source bytes:
+     *       const BYTE *Src;
+     *       INT Count;
+     *   - result data to append to:
+     *       std::vector<BYTE> &Out;
+     * RETURNS: None.
+     */
+    static VOID PackBits( const BYTE *Src, INT Count, std::vector<BYTE> &Out )
+    {
+      for (INT i = 0; i < Count;)
+      {
+        INT run = 1;
+
+        while (i + run < Count && run < 128 && Src[i + run] == Src[i])
+          run++;
+        if (run >= 2)
+        {
+          Out.push_back((BYTE)(257 - run));
+          Out.push_back(Src[i]);
+          i += run;
+          continue;
+        }
+
+        // Literal lasts till run of 3 bytes
+        INT lit = 1;
+
+        while (i + lit < Count && lit < 128 &&
+               !(i + lit + 2 < Count && Src[i + lit] == Src[i + lit + 1] && Src[i + lit] == Src[i + lit + 2]))
+          lit++;
+        Out.push_back((BYTE)(lit - 1));
+        Out.insert(Out.end(), Src + i, Src + i + lit);
+        i += lit;
+      }
+    } /* End of 'PackBits' function */
+  }; /* End of 'seq_codec' class */
+
+  /* Sequence file background writer class */
+  class seq_writer
+  {
+    std::fstream F;                        // Sequence file
+    seq_header Head {};                    // File header
+    std::vector<seq_index> Index;          // Written frames
+    std::vector<DWORD> Prev;               // Previous frame pixels (writer thread only)
+    std::deque<std::pair<INT, std::vector<DWORD>>> Queue; // Frames to write (frame number, pixels)
+    std::mutex Mutex;                      // Queue and index access mutex
+    std::condition_variable Cond;          // Queue change condition
+    std::thread Writer;                    // Writer thread
+    BOOL IsExit = FALSE;                   // Writer stop flag
+    UINT64 Bytes = 0;                      // Written frames data size
+    INT Pushed = 0;                        // Pushed frames count
+    INT Pending = 0;                       // Pushed and not written frames count
+
+    /* Writer thread function.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID Write( VOID )
+    {
+      std::vector<BYTE> data;
+
+      // Render workers use ids from 2, so writer takes last one
+      timeline::Get().SetThread(timeline::MaxNamedThreads - 1, "sequence");
+      while (TRUE)
+      {
+        std::vector<DWORD> pixels;
+        INT no;
+        {
+          std::unique_lock<std::mutex> lock(Mutex);
+
+          Cond.wait(lock, [this]( VOID ) { return IsExit || !Queue.empty(); });
+          if (Queue.empty())
+            return;
+          no = Queue.front().first;
+          pixels = std::move(Queue.front().second);
+          Queue.pop_front();
+        }
+        Cond.notify_all();
+
+        timeline_scope ts("sequence write", no);
+        BOOL is_key = Index.size() % Head.KeyInterval == 0;
+        seq_index rec {};
+
+        seq_codec::Encode(pixels.data(), is_key ? nullptr : Prev.data(), Head.W * Head.H, data);
+        rec.Offset = (UINT64)F.tellp() + sizeof(seq_index);
+        rec.Size = (DWORD)data.size();
+        rec.IsKey = is_key;
+        rec.FrameNo = no;
+        F.write((CHAR *)&rec, sizeof(rec));
+        F.write((CHAR *)data.data(), data.size());
+        F.flush();
+        Prev.swap(pixels);
+
+        {
+          std::lock_guard<std::mutex> lock(Mutex);
+
+          Index.push_back(rec);
+          Bytes += sizeof(rec) + data.size();
+          Pending--;
+        }
+        Cond.notify_all();
+      }
+    } /* End of 'Write' function */
+
+  public:
+    INT KeyInterval = 30; // Key frames interval (used by 'Open')
+    INT MaxQueue = 4;     // Maximal queued frames count ('Push' waits then)
+
+    /* Class destructor */
+    ~seq_writer( VOID )
+    {
+      Close();
+    } /* End of '~seq_writer' function */
+
+    /* Create sequence file function.
+     * ARGUMENTS:
+     *   - file name:
+     *       const std::string &FileName;
+     *   - frame size:
+     *       INT W, H;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise.
+     */
+    BOOL Open( const std::string &FileName, INT W, INT H )
+    {
+      Close();
+      F.open(FileName, std::fstream::out | std::fstream::binary | std::fstream::trunc);
+      if (!F.is_open())
+        return FALSE;
+      Head = {};
+      Head.Sign = *(DWORD *)"GSEQ";
+      Head.Version = seq_codec::Version;
+      Head.W = W;
+      Head.H = H;
+      Head.KeyInterval = max(KeyInterval, 1);
+      F.write((CHAR *)&Head, sizeof(Head));
+      Index.clear();
+      Prev.clear();
+      Bytes = 0;
+      Pushed = Pending = 0;
+      IsExit = FALSE;
+      Writer = std::thread(&seq_writer::Write, this);
+      return TRUE;
+    } /* End of 'Open' function */
+
+    /* Check file is opened function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (BOOL) TRUE if file is opened, FALSE otherwise.
+     */
+    BOOL IsOpen( VOID ) const
+    {
+      return Writer.joinable();
+    } /* End of 'IsOpen' function */
+
+    /* Queue frame pixels to write function.
+     * ARGUMENTS:
+     *   - frame pixels (of sequence size, moved):
+     *       std::vector<DWORD> &&Pixels;
+     *   - animation frame number (-1 for pushed frames count):
+     *       INT FrameNo;
+     * RETURNS:
+     *   (BOOL) TRUE if frame is queued, FALSE otherwise.
+     */
+    BOOL Push( std::vector<DWORD> &&Pixels, INT FrameNo = -1 )
+    {
+      if (!IsOpen() || Pixels.size() != (size_t)Head.W * Head.H)
+        return FALSE;
+
+      std::unique_lock<std::mutex> lock(Mutex);
+      Cond.wait(lock, [this]( VOID ) { return (INT)Queue.size() < MaxQueue; });
+      Queue.emplace_back(FrameNo < 0 ? Pushed : FrameNo, std::move(Pixels));
+      Pushed++;
+      Pending++;
+      Cond.notify_all();
+      return TRUE;
+    } /* End of 'Push' function */
+
+    /* Queue frame to write function.
+     * Frame is copied, so it can be changed after call.
+     * ARGUMENTS:
+     *   - frame (of sequence size):
+     *       frame &Frm;
+     *   - animation frame number (-1 for pushed frames count):
+     *       INT FrameNo;
+     * RETURNS:
+     *   (BOOL) TRUE if frame is queued, FALSE otherwise.
+     */
+    BOOL Push( frame &Frm, INT FrameNo = -1 )
+    {
+      if (!IsOpen() || Frm.W != Head.W || Frm.H != Head.H)
+        return FALSE;
+
+      std::vector<DWORD> pixels(Head.W * Head.H);
+
+      Frm.GetPixels(pixels.data());
+      return Push(std::move(pixels), FrameNo);
+    } /* End of 'Push' function */
+
+    /* Wait for queued frames are written function.
+     * Written frame survives process crash, so job frame should be
+     * marked finished after this call.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID Flush( VOID )
+    {
+      std::unique_lock<std::mutex> lock(Mutex);
+
+      Cond.wait(lock, [this]( VOID ) { return Pending == 0; });
+    } /* End of 'Flush' function */
+
+    /* Obtain written frames count function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (INT) frames count.
+     */
+    INT Count( VOID )
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+
+      return (INT)Index.size();
+    } /* End of 'Count' function */
+
+    /* Obtain written frames data size function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (UINT64) size in bytes.
+     */
+    UINT64 Size( VOID )
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+
+      return Bytes;
+    } /* End of 'Size' function */
+
+    /* Finish queued frames and close file function.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID Close( VOID )
+    {
+      if (!IsOpen())
+        return;
+      {
+        std::lock_guard<std::mutex> lock(Mutex);
+
+        IsExit = TRUE;
+      }
+      Cond.notify_all();
+      Writer.join();
+
+      // Index at end, header is rewritten with its offset
+      Head.IndexOffset = (UINT64)F.tellp();
+      Head.FrameCount = (INT)Index.size();
+      F.write((CHAR *)Index.data(), Index.size() * sizeof(seq_index));
+      F.seekp(0);
+      F.write((CHAR *)&Head, sizeof(Head));
+      F.close();
+      Prev.clear();
+    } /* End of 'Close' function */
+
+    INT Merge( const std::vector<std::string> &Sources, const std::string &FileName );
+  }; /* End of 'seq_writer' class */
+
+  /* Sequence file reader class */
+  class seq_reader
+  {
+    std::ifstream F;               // Sequence file
+    seq_header Head {};            // File header
+    std::vector<seq_index> Index;  // Records index (file order)
+    std::map<INT, INT> ByNo;       // Record by frame number (last record of frame)
+    std::vector<DWORD> Cur;        // Last decoded record pixels
+    std::vector<BYTE> Data;        // Record data buffer
+    INT CurRec = -1;               // Last decoded record (-1 if none)
+
+    /* Decode record function.
+     * Records are decoded from nearest key record or from last
+     * decoded record if it is on the way (sequential playback).
+     * ARGUMENTS:
+     *   - record number in file order:
+     *       INT Rec;
+     * RETURNS:
+     *   (const DWORD *) frame pixels (valid till next call) or nullptr if error.
+     */
+    const DWORD * Decode( INT Rec )
+    {
+      INT key = Rec;
+
+      while (key > 0 && !Index[key].IsKey)
+        key--;
+      if (CurRec < key || CurRec > Rec)
+      {
+        std::fill(Cur.begin(), Cur.end(), 0);
+        CurRec = key - 1;
+      }
+      while (CurRec < Rec)
+      {
+        const seq_index &rec = Index[CurRec + 1];
+
+        Data.resize(rec.Size);
+        F.seekg(rec.Offset);
+        if (!F.read((CHAR *)Data.data(), rec.Size) ||
+            !seq_codec::Decode(Data.data(), rec.Size, Cur.data(), (INT)Cur.size()))
+        {
+          F.clear();
+          CurRec = -1;
+          return nullptr;
+        }
+        CurRec++;
+      }
+      return Cur.data();
+    } /* End of 'Decode' function */
+
+  public:
+    /* Open sequence file function.
+     * ARGUMENTS:
+     *   - file name:
+     *       const std::string &FileName;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise.
+     */
+    BOOL Open( const std::string &FileName )
+    {
+      Close();
+      F.open(FileName, std::ifstream::binary);
+      if (!F.is_open())
+        return FALSE;
+      if (!F.read((CHAR *)&Head, sizeof(Head)) || Head.Sign != *(DWORD *)"GSEQ" ||
+          Head.Version != seq_codec::Version || Head.W <= 0 || Head.H <= 0)
+      {
+        Close();
+        return FALSE;
+      }
+      if (Head.IndexOffset != 0)
+      {
+        Index.resize(Head.FrameCount);
+        F.seekg(Head.IndexOffset);
+        F.read((CHAR *)Index.data(), Index.size() * sizeof(seq_index));
+      }
+      else
+      {
+        // Not closed file: records are scanned, partly written last record is dropped
+        seq_index rec;
+        UINT64 pos = sizeof(Head), size;
+
+        F.seekg(0, std::ifstream::end);
+        size = (UINT64)F.tellg();
+        while (pos + sizeof(rec) <= size)
+        {
+          F.seekg(pos);
+          if (!F.read((CHAR *)&rec, sizeof(rec)) || rec.Offset != pos + sizeof(rec) || rec.Offset + rec.Size > size)
+            break;
+          Index.push_back(rec);
+          pos = rec.Offset + rec.Size;
+        }
+        F.clear();
+      }
+      for (INT i = 0; i < (INT)Index.size(); i++)
+        ByNo[Index[i].FrameNo] = i;
+      Cur.assign(Head.W * Head.H, 0);
+      return F.good();
+    } /* End of 'Open' function */
+
+    /* Close file function.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID Close( VOID )
+    {
+      F.close();
+      F.clear();
+      Head = {};
+      Index.clear();
+      ByNo.clear();
+      Cur.clear();
+      CurRec = -1;
+    } /* End of 'Close' function */
+
+    /* Obtain file header function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (const seq_header &) header.
+     */
+    const seq_header & Header( VOID ) const
+    {
+      return Head;
+    } /* End of 'Header' function */
+
+    /* Obtain frames count function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (INT) different frames count.
+     */
+    INT Count( VOID ) const
+    {
+      return (INT)ByNo.size();
+    } /* End of 'Count' function */
+
+    /* Obtain stored frames numbers function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (std::vector<INT>) frame numbers in increasing order.
+     */
+    std::vector<INT> Frames( VOID ) const
+    {
+      std::vector<INT> nos;
+
+      nos.reserve(ByNo.size());
+      for (auto &[no, rec] : ByNo)
+        nos.push_back(no);
+      return nos;
+    } /* End of 'Frames' function */
+
+    /* Decode frame function.
+     * ARGUMENTS:
+     *   - animation frame number:
+     *       INT FrameNo;
+     * RETURNS:
+     *   (const DWORD *) frame pixels (valid till next call) or nullptr if frame is absent or error.
+     */
+    const DWORD * Read( INT FrameNo )
+    {
+      auto it = ByNo.find(FrameNo);
+
+      return it == ByNo.end() ? nullptr : Decode(it->second);
+    } /* End of 'Read' function */
+
+    /* Decode frame to frame buffer function.
+     * ARGUMENTS:
+     *   - animation frame number:
+     *       INT FrameNo;
+     *   - frame buffer (resized to sequence size if needed):
+     *       frame &Frm;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise.
+     */
+    BOOL Read( INT FrameNo, frame &Frm )
+    {
+      const DWORD *pixels = Read(FrameNo);
+
+      if (pixels == nullptr)
+        return FALSE;
+      if (Frm.W != Head.W || Frm.H != Head.H)
+        Frm.Resize(Head.W, Head.H);
+      for (INT y = 0; y < Head.H; y++)
+        Frm.PutRow(y, pixels + y * Head.W);
+      return TRUE;
+    } /* End of 'Read' function */
+  }; /* End of 'seq_reader' class */
+
+  /* Merge sequence files function.
+   * Frames of all sources are written by this writer in frame numbers
+   * order, frame found in several sources is taken from first of them.
+   * Result is written under temporary name first, so existing file is
+   * replaced only by complete one.
+   * ARGUMENTS:
+   *   - source file names (of same frame size):
+   *       const std::vector<std::string> &Sources;
+   *   - result file name (can be one of sources):
+   *       const std::string &FileName;
+   * RETURNS:
+   *   (INT) merged frames count or -1 if error.
+   */
+  inline INT seq_writer::Merge( const std::vector<std::string> &Sources, const std::string &FileName )
+  {
+    std::vector<seq_reader> src(Sources.size());
+    std::map<INT, INT> from; // Source by frame number
+    std::string tmp = FileName + ".tmp";
+    std::error_code ec;
+    INT w = 0, h = 0;
+
+    for (INT i = (INT)Sources.size() - 1; i >= 0; i--)
+    {
+      if (!src[i].Open(Sources[i]) ||
+          (w != 0 && (src[i].Header().W != w || src[i].Header().H != h)))
+        return -1;
+      w = src[i].Header().W, h = src[i].Header().H;
+      for (INT no : src[i].Frames())
+        from[no] = i;
+    }
+    if (from.empty() || !Open(tmp, w, h))
+      return -1;
+    for (auto &[no, i] : from)
+    {
+      const DWORD *pixels = src[i].Read(no);
+
+      if (pixels == nullptr)
+      {
+        Close();
+        std::filesystem::remove(tmp, ec);
+        return -1;
+      }
+      Push(std::vector<DWORD>(pixels, pixels + (size_t)w * h), no);
+    }
+    Close();
+    for (auto &r : src)
+      r.Close();
+    std::filesystem::rename(tmp, FileName, ec);
+    return ec ? -1 : (INT)from.size();
+  } /* End of 'gort::seq_writer::Merge' function */
+} /* end of 'gort' namespace */
+
+#endif /* __sequence_h_ */
+
+/* END OF 'sequence.h' FILE */
@@ -26,16 +26,18 @@ namespace gort
   {
     vec3 B1, B2;
   public:
+    friend class snapshot;
+    friend class flat_shapes;
     box( const vec3 &NB1, const vec3 &NB2 )
     {
       B1 = NB1;
       B2 = NB2;
     }
-    box( const vec3 &NB1, const vec3 &NB2, surface Mtl )
+    box( const vec3 &NB1, const vec3 &NB2, DWORD MtlNo )
     {
       B1 = NB1;
       B2 = NB2;
-      Material = Mtl;
+      Mtl = MtlNo;
     }
 
     /* Get normal function.
@@ -69,62 +71,25 @@ namespace gort
       }
     } /* End of 'GetNormal' function */
 
+    /* Find intersection function
+     * ARGUMENTS:
+     *   - tracing ray:
+     *       ray &R;
+     *   - intersection data (distance and face number in 'I[0]'):
+     *       intr *Intr;
+     * RETURNS:
+     *   (BOOL) TRUE if intersected, FALSE otherwise.
+     */
     BOOL Intersect( const ray &R, intr *Intr )
     {
-      INT tnear_no = -1, tfar_no = -1;
-      DBL tnear = -1, tfar = -1, t = -1;
+      DBL tnear, tfar;
+      INT near_no, far_no;
 
-      for (INT i = 0; i < 3; i++)
-      {
-        if (std::fabs(R.Dir[i]) < Threshold)
-        {
-          if (R.Org[i] < B1[i] || R.Org[i] > B2[i])
-            return FALSE;
-        }
-        else
-        {
-          if (R.Dir[i] > Threshold)
-          {
-            if (R.Org[i] > B2[i])
-              return FALSE;
-            if (R.Org[i] < B1[i])
-            {
-              t = (B1[i] - R.Org[i]) / R.Dir[i];
-              if (tnear_no == -1 || tnear < t)
-                tnear_no = i * 2, tnear = t;
-            }
-            t = (B2[i] - R.Org[i]) / R.Dir[i];
-            if (tfar_no == -1 || tfar > t)
-              tfar_no = i * 2 + 1, tfar = t;
-          }
-          else
-          {
-            if (R.Org[i] < B1[i])
-              return FALSE;
-            if (R.Org[i] > B2[i])
-            {
-              t = (B2[i] - R.Org[i]) / R.Dir[i];
-              if (tnear_no == -1 || tnear < t)
-                tnear_no = i * 2, tnear = t;
-              
-            }
-            t = (B1[i] - R.Org[i]) / R.Dir[i];
-            if (tfar_no == -1 || tfar > t)
-              tfar_no = i * 2 + 1, tfar = t;
-            
-          }
-        }
-      }
-      if (tnear_no != -1)
-      {
-        if (tnear > tfar)
-          return FALSE;
-        Intr->T = tnear;
-        Intr->I[0] = tnear_no;
-        return TRUE;
-      }
-      Intr->T = tfar;
-      Intr->I[0] = tfar_no;
+      if (!mth::Slab(R, B1, B2, &tnear, &tfar, &near_no, &far_no))
+        return FALSE;
+      // Ray starts inside box - exit point
+      Intr->T = tnear > 0 ? tnear : tfar;
+      Intr->I[0] = tnear > 0 ? near_no : far_no;
       return TRUE;
     } /* End of 'Intersection' function */
 
@@ -140,64 +105,22 @@ namespace gort
     INT AllIntersect( const ray &R, intr_list &Il )
     {
       intr in;
-      INT tnear_no = -1, tfar_no = -1;
-      DBL tnear = -1, tfar = -1, t = -1;
+      DBL tnear, tfar;
+      INT near_no, far_no;
 
-      for (INT i = 0; i < 3; i++)
-      {
-        if (std::fabs(R.Dir[i]) < Threshold)
-        {
-          if (R.Org[i] < B1[i] || R.Org[i] > B2[i])
-            return 0;
-        }
-        else
-        {
-          if (R.Dir[i] > Threshold)
-          {
-            if (R.Org[i] > B2[i])
-              return 0;
-            if (R.Org[i] < B1[i])
-            {
-              t = (B1[i] - R.Org[i]) / R.Dir[i];
-              if (tnear_no == -1 || tnear - t < Threshold)
-                tnear_no = i * 2, tnear = t;
-            }
-            t = (B2[i] - R.Org[i]) / R.Dir[i];
-            if (tfar_no == -1 || tfar - t > Threshold)
-              tfar_no = i * 2 + 1, tfar = t;
-          }
-          else
-          {
-            if (R.Org[i] < B1[i])
-              return 0;
-            if (R.Org[i] > B2[i])
-            {
-              t = (B2[i] - R.Org[i]) / R.Dir[i];
-              if (tnear_no == -1 || tnear - t < Threshold)
-                tnear_no = i * 2, tnear = t;
-              
-            }
-            t = (B1[i] - R.Org[i]) / R.Dir[i];
-            if (tfar_no == -1 || tfar - t > Threshold)
-              tfar_no = i * 2 + 1, tfar = t;
-            
-          }
-        }
-      }
-      if (tnear_no != -1)
+      if (!mth::Slab(R, B1, B2, &tnear, &tfar, &near_no, &far_no))
+        return 0;
+      in.Shp = (shape *)this;
+      if (tnear > 0)
       {
-        if (tnear - tfar > Threshold)
-          return 0;
         in.T = tnear;
-        in.I[0] = tnear_no;
-        in.Shp = (shape *)this;
+        in.I[0] = near_no;
         Il << in;
       }
       if (tfar > Threshold)
       {
         in.T = tfar;
-        in.I[0] = tfar_no;
-        in.Shp = (shape *)this;
+        in.I[0] = far_no;
         Il << in;
       }
       return Il.size();
@@ -221,6 +144,47 @@ namespace gort
             return TRUE;
       return FALSE;
     } /* End of 'IsInside' function */
+
+    /* Obtain shape bound box function.
+     * ARGUMENTS:
+     *   - result box corners:
+     *       vec3 *Min, *Max;
+     * RETURNS:
+     *   (BOOL) TRUE.
+     */
+    BOOL GetBound( vec3 *Min, vec3 *Max ) const override
+    {
+      for (INT a = 0; a < 3; a++)
+      {
+        (*Min)[a] = min(B1[a], B2[a]);
+        (*Max)[a] = max(B1[a], B2[a]);
+      }
+      return TRUE;
+    } /* End of 'GetBound' function */
+
+    /* Account shape memory function.
+     * ARGUMENTS:
+     *   - report to fill:
+     *       mem_report &Rep;
+     * RETURNS: None.
+     */
+    VOID Account( mem_report &Rep ) const override
+    {
+      Rep.Add("shapes", "box", 1, sizeof(box));
+    } /* End of 'Account' function */
+
+    /* Hash shape geometry and materials function.
+     * ARGUMENTS:
+     *   - hash to add to:
+     *       hasher &H;
+     * RETURNS:
+     *   (BOOL) TRUE.
+     */
+    BOOL Hash( hasher &H ) const override
+    {
+      H << "box" << B1 << B2 << Mtl;
+      return TRUE;
+    } /* End of 'Hash' function */
   }; /* End of 'box' class */
 } /* End of 'gotr' namespace */
 
@@ -0,0 +1,753 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : cloud.h
+ * PURPOSE     : Raytracing project.
+ *               Sphere cloud shape class declaration module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : Spheres are stored as float structure of arrays
+ *               with material number into shared table: 18 bytes
+ *               of sphere data and 8 bytes of order tables, 26 bytes
+ *               per sphere; BVH adds 10..19 bytes (measured 36..45
+ *               bytes per sphere in all for 0.1M..2M spheres, nodes
+ *               capacity growth differs). 'Build' reorders spheres to
+ *               4-wide BVH leaves (4 spheres each), so both box
+ *               and sphere tests are done 4 at once by SSE. Hit
+ *               distance is refined in double precision.
+ *               Moved spheres (see 'SetSphere', 'SetTransform') are
+ *               handled by 'Refit': boxes are recomputed bottom-up by levels
+ *               with same tree, tree is rebuilt if its SAH cost
+ *               grows too much.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+#ifndef __cloud_h_
+#define __cloud_h_
+#include <algorithm>
+#include <numeric>
+#include <atomic>
+#include <immintrin.h>
+#include "def.h"
+#include "../rt_def.h"
+#include "../pool.h"
+
+/* Application namespace. */
+namespace gort
+{
+  /* Sphere cloud shape class. */
+  class sphere_cloud : public shape
+  {
+    /* Four children BVH node */
+    struct alignas(16) node
+    {
+      mth::box4f Box;           // Children boxes: [axis][child]
+      INT Child[4];             // Child node number, '~leaf' (leaf is 4 spheres block number) or 0 for empty slot
+    }; /* End of 'node' structure */
+
+    stock<FLT> X, Y, Z, R; // Spheres centers and radiuses
+    stock<WORD> SphereMtl; // Spheres materials numbers (in 'Mtls')
+    stock<DWORD> Mtls;     // Cloud materials scene table records (see 'rt::scene::Mtls')
+    stock<node> Nodes;     // BVH nodes (root is first)
+    stock<INT> Slot;       // Stored sphere number by added sphere number
+    stock<INT> Orig;       // Added sphere number by stored sphere number (-1 for leaf padding)
+    stock<INT> LevelNodes; // Nodes numbers by tree levels (root level is first)
+    stock<INT> LevelStart; // Level first node in 'LevelNodes' (last is nodes count)
+    stock<FLT> RestX, RestY, RestZ; // Rest pose centers by added sphere number (empty before first 'SetTransform')
+
+  public:
+    FLT Eps = 1e-4f;         // Minimal hit distance (float kernel self intersection guard)
+    DBL RebuildRatio = 1.5;  // Refitted tree SAH cost growth to rebuild tree
+    DBL BuildCost = 0;       // Tree SAH cost after last build
+    DBL SahCost = 0;         // Tree SAH cost after last refit
+
+    /* Add material to table function.
+     * ARGUMENTS:
+     *   - scene material table record number (see 'rt::scene::Mtls'):
+     *       DWORD Rec;
+     * RETURNS:
+     *   (WORD) material number.
+     */
+    WORD AddMtl( DWORD Rec )
+    {
+      Mtls << Rec;
+      return (WORD)(Mtls.size() - 1);
+    } /* End of 'AddMtl' function */
+
+    /* Reserve spheres memory function.
+     * ARGUMENTS:
+     *   - spheres count:
+     *       size_t Count;
+     * RETURNS: None.
+     */
+    VOID Reserve( size_t Count )
+    {
+      X.reserve(Count);
+      Y.reserve(Count);
+      Z.reserve(Count);
+      R.reserve(Count);
+      SphereMtl.reserve(Count);
+      Slot.reserve(Count);
+      Orig.reserve(Count);
+    } /* End of 'Reserve' function */
+
+    /* Add sphere function ('Build' should be called after all spheres are added).
+     * ARGUMENTS:
+     *   - sphere center and radius:
+     *       const vec3 &C;
+     *       DBL Rad;
+     *   - material number (see 'AddMtl'):
+     *       WORD Mtl;
+     * RETURNS: None.
+     */
+    VOID Add( const vec3 &C, DBL Rad, WORD Mtl = 0 )
+    {
+      Slot << (INT)X.size();
+      Orig << (INT)(Slot.size() - 1);
+      X << (FLT)C[0];
+      Y << (FLT)C[1];
+      Z << (FLT)C[2];
+      R << (FLT)Rad;
+      SphereMtl << Mtl;
+    } /* End of 'Add' function */
+
+    /* Obtain spheres count function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (size_t) spheres count (with leaf padding after 'Build').
+     */
+    size_t Size( VOID ) const
+    {
+      return X.size();
+    } /* End of 'Size' function */
+
+    /* Obtain added spheres count function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (INT) spheres count (without leaf padding).
+     */
+    INT Count( VOID ) const
+    {
+      return (INT)Slot.size();
+    } /* End of 'Count' function */
+
+    /* Obtain sphere center function.
+     * ARGUMENTS:
+     *   - sphere number (in adding order):
+     *       INT No;
+     * RETURNS:
+     *   (vec3) sphere center.
+     */
+    vec3 GetCenter( INT No ) const
+    {
+      INT s = Slot[No];
+
+      return vec3(X[s], Y[s], Z[s]);
+    } /* End of 'GetCenter' function */
+
+    /* Obtain sphere radius function.
+     * ARGUMENTS:
+     *   - sphere number (in adding order):
+     *       INT No;
+     * RETURNS:
+     *   (DBL) sphere radius.
+     */
+    DBL GetRadius( INT No ) const
+    {
+      return R[Slot[No]];
+    } /* End of 'GetRadius' function */
+
+    /* Move sphere function ('Refit' should be called after all spheres are moved).
+     * ARGUMENTS:
+     *   - sphere number (in adding order):
+     *       INT No;
+     *   - new sphere center and radius:
+     *       const vec3 &C;
+     *       DBL Rad;
+     * RETURNS: None.
+     */
+    VOID SetSphere( INT No, const vec3 &C, DBL Rad )
+    {
+      INT s = Slot[No];
+
+      X[s] = (FLT)C[0], Y[s] = (FLT)C[1], Z[s] = (FLT)C[2], R[s] = (FLT)Rad;
+    } /* End of 'SetSphere' function */
+
+    /* Get sphere adding order number function.
+     * ARGUMENTS:
+     *   - stored (BVH order) sphere number, as in intersection 'I[0]':
+     *       INT Stored;
+     * RETURNS:
+     *   (INT) sphere number in adding order.
+     */
+    INT SphereNo( INT Stored ) const
+    {
+      return Orig[Stored];
+    } /* End of 'SphereNo' function */
+
+    /* Place cloud by transform of its rest pose function.
+     * Centers are transformed, radiuses are kept ('SetSphere' changes
+     * are lost).
+     * ARGUMENTS:
+     *   - rest pose to world transform (rotation and translation):
+     *       const matr &M;
+     * RETURNS:
+     *   (BOOL) TRUE.
+     */
+    BOOL SetTransform( const matr &M ) override
+    {
+      INT n = Count();
+
+      // Spheres added after previous call are in rest pose
+      for (INT i = (INT)RestX.size(); i < n; i++)
+      {
+        INT s = Slot[i];
+
+        RestX << X[s], RestY << Y[s], RestZ << Z[s];
+      }
+      for (INT i = 0; i < n; i++)
+      {
+        INT s = Slot[i];
+        mth::vec3<FLT> c = M.PointTransform(mth::vec3<FLT>(RestX[i], RestY[i], RestZ[i]));
+
+        X[s] = c[0], Y[s] = c[1], Z[s] = c[2];
+      }
+      return TRUE;
+    } /* End of 'SetTransform' function */
+
+    /* Obtain used memory function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (size_t) spheres, materials and BVH memory in bytes.
+     */
+    size_t Memory( VOID ) const
+    {
+      return X.capacity() * sizeof(FLT) * 4 + SphereMtl.capacity() * sizeof(WORD) +
+        Mtls.capacity() * sizeof(DWORD) + Nodes.capacity() * sizeof(node) +
+        (Slot.capacity() + Orig.capacity() + LevelNodes.capacity() + LevelStart.capacity()) * sizeof(INT) +
+        (RestX.capacity() + RestY.capacity() + RestZ.capacity()) * sizeof(FLT);
+    } /* End of 'Memory' function */
+
+    /* Account shape memory function.
+     * ARGUMENTS:
+     *   - report to fill:
+     *       mem_report &Rep;
+     * RETURNS: None.
+     */
+    VOID Account( mem_report &Rep ) const override
+    {
+      Rep.Add("shapes", "sphere cloud", 1, sizeof(sphere_cloud));
+      Rep.Add("cloud", "spheres", Count(),
+        mem_report::Of(X) * 4 + mem_report::Of(SphereMtl) + mem_report::Of(Mtls) + mem_report::Of(Slot) + mem_report::Of(Orig));
+      Rep.Add("cloud", "bvh", Nodes.size(), mem_report::Of(Nodes) + mem_report::Of(LevelNodes) + mem_report::Of(LevelStart));
+      if (!RestX.empty())
+        Rep.Add("cloud", "rest pose", RestX.size(), mem_report::Of(RestX) * 3);
+    } /* End of 'Account' function */
+
+    /* Hash shape geometry and materials function.
+     * ARGUMENTS:
+     *   - hash to add to:
+     *       hasher &H;
+     * RETURNS:
+     *   (BOOL) TRUE.
+     */
+    BOOL Hash( hasher &H ) const override
+    {
+      // BVH is built from spheres, so it is not hashed
+      H << "sphere cloud" << X << Y << Z << R << SphereMtl << Mtls;
+      return TRUE;
+    } /* End of 'Hash' function */
+
+    /* Build BVH function.
+     * Spheres are reordered and padded to 4 spheres leaves
+     * (previous build padding is dropped, so tree can be rebuilt).
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID Build( VOID )
+    {
+      std::vector<INT> ind;
+      stock<FLT> nx, ny, nz, nr;
+      stock<WORD> nm;
+      stock<INT> no;
+
+      ind.reserve(Slot.size());
+      for (size_t i = 0; i < Orig.size(); i++)
+        if (Orig[i] >= 0)
+          ind.push_back((INT)i);
+
+      size_t n = ind.size();
+
+      if (Mtls.empty())
+        Mtls << Mtl;
+      Nodes.clear();
+      LevelNodes.clear();
+      LevelStart.clear();
+      BuildCost = SahCost = 0;
+      if (n == 0)
+        return;
+      // Leaves are mostly full, so there are about n / 4 leaves and n / 12 nodes
+      Nodes.reserve(n / 12 + 1);
+      nx.reserve(n + n / 8), ny.reserve(n + n / 8), nz.reserve(n + n / 8), nr.reserve(n + n / 8), nm.reserve(n + n / 8);
+      no.reserve(n + n / 8);
+      BuildNode(ind.data(), n, nx, ny, nz, nr, nm, no);
+      X.swap(nx), Y.swap(ny), Z.swap(nz), R.swap(nr), SphereMtl.swap(nm), Orig.swap(no);
+      X.shrink_to_fit(), Y.shrink_to_fit(), Z.shrink_to_fit(), R.shrink_to_fit(), SphereMtl.shrink_to_fit();
+      Orig.shrink_to_fit();
+      Nodes.shrink_to_fit();
+
+      // Nodes by levels for refit (children are at next level)
+      LevelNodes.reserve(Nodes.size());
+      LevelNodes << 0;
+      LevelStart << 0;
+      for (size_t lo = 0, hi = 1; lo < hi; lo = hi, hi = LevelNodes.size())
+      {
+        LevelStart << (INT)hi;
+        for (size_t i = lo; i < hi; i++)
+          for (INT ch : Nodes[LevelNodes[i]].Child)
+            if (ch > 0)
+              LevelNodes << ch;
+      }
+
+      DBL area = 0;
+      for (INT i = 0; i < (INT)Nodes.size(); i++)
+        area += NodeArea(i);
+      BuildCost = SahCost = area / RootArea();
+    } /* End of 'Build' function */
+
+    /* Get normal function.
+     * ARGUMENTS:
+     *   - intersection data (sphere number in 'I[0]'):
+     *       intr *in;
+     * RETURNS: None.
+     */
+    VOID GetNormal( intr *in ) override
+    {
+      INT i = in->I[0];
+
+      in->N = (in->P - vec3(X[i], Y[i], Z[i])) / R[i];
+    } /* End of 'GetNormal' function */
+
+    /* Obtain intersection point material number function.
+     * ARGUMENTS:
+     *   - intersection data (sphere number in 'I[0]'):
+     *       const intr &In;
+     * RETURNS:
+     *   (DWORD) hit sphere scene material table record number.
+     */
+    DWORD MtlNo( const intr &In ) const override
+    {
+      return Mtls[SphereMtl[In.I[0]]];
+    } /* End of 'MtlNo' function */
+
+    /* Find closest intersection function
+     * ARGUMENTS:
+     *   - tracing ray:
+     *       ray &Ray;
+     *   - intersection data (distance and sphere number in 'I[0]'):
+     *       intr *Intr;
+     * RETURNS:
+     *   (BOOL) TRUE if intersected, FALSE otherwise.
+     */
+    BOOL Intersect( const ray &Ray, intr *Intr ) override
+    {
+      if (Nodes.empty())
+        return FALSE;
+
+      mth::ray4f r4(Ray);
+      __m128 d[3];
+      for (INT i = 0; i < 3; i++)
+        d[i] = _mm_set1_ps((FLT)Ray.Dir[i]);
+      const __m128 *o = r4.Org;
+
+      struct
+      {
+        INT No; // Node number or '~leaf'
+        FLT T;  // Node entry distance
+      } stack[64];
+      INT sp = 0, best_no = -1;
+      FLT best = 1e30f;
+      alignas(16) FLT tv[4];
+
+      stack[sp++] = {0, 0};
+      while (sp > 0)
+      {
+        auto [no, t] = stack[--sp];
+
+        if (t >= best)
+          continue;
+        if (no < 0)
+        {
+          // Four spheres: distance to ray line gives half chord, no float cancellation
+          const INT b = ~no * 4;
+          __m128
+            oc[3] = {_mm_sub_ps(_mm_loadu_ps(&X[b]), o[0]),
+                     _mm_sub_ps(_mm_loadu_ps(&Y[b]), o[1]),
+                     _mm_sub_ps(_mm_loadu_ps(&Z[b]), o[2])},
+            r = _mm_loadu_ps(&R[b]),
+            ok = _mm_add_ps(_mm_add_ps(_mm_mul_ps(oc[0], d[0]), _mm_mul_ps(oc[1], d[1])), _mm_mul_ps(oc[2], d[2])),
+            h2 = _mm_mul_ps(r, r),
+            eps = _mm_set1_ps(Eps);
+
+          for (INT i = 0; i < 3; i++)
+          {
+            __m128 p = _mm_sub_ps(oc[i], _mm_mul_ps(d[i], ok));
+
+            h2 = _mm_sub_ps(h2, _mm_mul_ps(p, p));
+          }
+          __m128
+            h = _mm_sqrt_ps(_mm_max_ps(h2, _mm_setzero_ps())),
+            t0 = _mm_sub_ps(ok, h),
+            t1 = _mm_add_ps(ok, h),
+            near_ok = _mm_cmpgt_ps(t0, eps),
+            tt = _mm_or_ps(_mm_and_ps(near_ok, t0), _mm_andnot_ps(near_ok, t1)),
+            hit = _mm_and_ps(_mm_cmpge_ps(h2, _mm_setzero_ps()),
+                             _mm_and_ps(_mm_cmpgt_ps(tt, eps), _mm_cmplt_ps(tt, _mm_set1_ps(best))));
+          INT mask = _mm_movemask_ps(hit);
+
+          if (mask != 0)
+          {
+            _mm_store_ps(tv, tt);
+            for (INT k = 0; k < 4; k++)
+              if ((mask >> k & 1) != 0 && tv[k] < best)
+                best = tv[k], best_no = b + k;
+          }
+          continue;
+        }
+
+        const node &nd = Nodes[no];
+        INT mask = mth::Slab4(r4, nd.Box, best, tv), ch[4], cnt = 0;
+
+        // Push far children first, so near ones are popped first (empty slots have zero child)
+        for (INT k = 0; k < 4; k++)
+          if ((mask >> k & 1) != 0 && nd.Child[k] != 0)
+          {
+            INT j = cnt++;
+
+            for (; j > 0 && tv[ch[j - 1]] < tv[k]; j--)
+              ch[j] = ch[j - 1];
+            ch[j] = k;
+          }
+        for (INT k = 0; k < cnt; k++)
+          stack[sp++] = {nd.Child[ch[k]], tv[ch[k]]};
+      }
+      if (best_no < 0)
+        return FALSE;
+
+      // Double precision distance for hit sphere
+      vec3 oc = vec3(X[best_no], Y[best_no], Z[best_no]) - Ray.Org;
+      DBL
+        ok = oc & Ray.Dir,
+        h = sqrt(max((DBL)R[best_no] * R[best_no] - ((oc - Ray.Dir * ok) & (oc - Ray.Dir * ok)), 0.0));
+
+      Intr->T = ok - h > Eps ? ok - h : ok + h;
+      Intr->I[0] = best_no;
+      return TRUE;
+    } /* End of 'Intersect' function */
+
+    /* Obtain shape bound box function.
+     * ARGUMENTS:
+     *   - result box corners:
+     *       vec3 *Min, *Max;
+     * RETURNS:
+     *   (BOOL) TRUE if BVH is built, FALSE otherwise.
+     */
+    BOOL GetBound( vec3 *Min, vec3 *Max ) const override
+    {
+      if (Nodes.empty())
+        return FALSE;
+      *Min = vec3(1e30), *Max = vec3(-1e30);
+      for (INT c = 0; c < 4; c++)
+        if (Nodes[0].Child[c] != 0)
+          for (INT a = 0; a < 3; a++)
+          {
+            (*Min)[a] = min((*Min)[a], (DBL)Nodes[0].Box.Min[a][c]);
+            (*Max)[a] = max((*Max)[a], (DBL)Nodes[0].Box.Max[a][c]);
+          }
+      return TRUE;
+    } /* End of 'GetBound' function */
+
+    /* Refit BVH to moved spheres function.
+     * Boxes are recomputed from leaves to root by tree levels (level
+     * nodes are split between workers), tree is kept. If tree SAH cost
+     * grows more than 'RebuildRatio' times since build, it is rebuilt.
+     * ARGUMENTS:
+     *   - workers pool and workers count:
+     *       thread_pool &Pool;
+     *       INT ThreadCount;
+     * RETURNS:
+     *   (BOOL) TRUE if tree is rebuilt, FALSE if refitted.
+     */
+    BOOL Refit( thread_pool &Pool, INT ThreadCount ) override
+    {
+      const INT Chunk = 256;
+
+      if (Nodes.empty())
+        return FALSE;
+
+      std::vector<DBL> area(max(Pool.Count(), 1));
+
+      for (INT l = (INT)LevelStart.size() - 2; l >= 0; l--)
+      {
+        INT lo = LevelStart[l], hi = LevelStart[l + 1];
+
+        // Small levels are not worth workers wake up
+        if (hi - lo <= Chunk)
+          for (INT i = lo; i < hi; i++)
+            area[0] += RefitNode(LevelNodes[i]);
+        else
+        {
+          std::atomic_int next = lo;
+
+          Pool.Run(ThreadCount,
+            [&]( INT Worker )
+            {
+              DBL sum = 0;
+
+              for (INT i = next.fetch_add(Chunk); i < hi; i = next.fetch_add(Chunk))
+                for (INT k = i; k < min(i + Chunk, hi); k++)
+                  sum += RefitNode(LevelNodes[k]);
+              area[Worker] += sum;
+            });
+        }
+      }
+
+      DBL sum = 0;
+      for (DBL a : area)
+        sum += a;
+      SahCost = sum / RootArea();
+      if (SahCost <= BuildCost * RebuildRatio)
+        return FALSE;
+      Build();
+      return TRUE;
+    } /* End of 'Refit' function */
+
+  private:
+    /* Box surface area function.
+     * ARGUMENTS:
+     *   - box corners:
+     *       const FLT *Min, *Max;
+     * RETURNS:
+     *   (DBL) surface area.
+     */
+    static DBL BoxArea( const FLT *Min, const FLT *Max )
+    {
+      DBL
+        dx = (DBL)Max[0] - Min[0],
+        dy = (DBL)Max[1] - Min[1],
+        dz = (DBL)Max[2] - Min[2];
+
+      return 2 * (dx * dy + dy * dz + dz * dx);
+    } /* End of 'BoxArea' function */
+
+    /* Node children boxes area function.
+     * ARGUMENTS:
+     *   - node number:
+     *       INT No;
+     * RETURNS:
+     *   (DBL) children boxes surface areas sum.
+     */
+    DBL NodeArea( INT No ) const
+    {
+      DBL area = 0;
+
+      for (INT k = 0; k < 4; k++)
+        if (Nodes[No].Child[k] != 0)
+        {
+          FLT mn[3], mx[3];
+
+          for (INT a = 0; a < 3; a++)
+            mn[a] = Nodes[No].Box.Min[a][k], mx[a] = Nodes[No].Box.Max[a][k];
+          area += BoxArea(mn, mx);
+        }
+      return area;
+    } /* End of 'NodeArea' function */
+
+    /* Tree root box area function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (DBL) root box surface area (not zero).
+     */
+    DBL RootArea( VOID ) const
+    {
+      vec3 mn, mx;
+      FLT bmin[3], bmax[3];
+
+      GetBound(&mn, &mx);
+      for (INT a = 0; a < 3; a++)
+        bmin[a] = (FLT)mn[a], bmax[a] = (FLT)mx[a];
+      return max(BoxArea(bmin, bmax), 1e-30);
+    } /* End of 'RootArea' function */
+
+    /* Recompute node children boxes function.
+     * Child nodes should be refitted before.
+     * ARGUMENTS:
+     *   - node number:
+     *       INT No;
+     * RETURNS:
+     *   (DBL) children boxes surface areas sum.
+     */
+    DBL RefitNode( INT No )
+    {
+      node &nd = Nodes[No];
+
+      for (INT k = 0; k < 4; k++)
+      {
+        FLT mn[3] = {1e30f, 1e30f, 1e30f}, mx[3] = {-1e30f, -1e30f, -1e30f};
+        INT ch = nd.Child[k];
+
+        if (ch == 0)
+          continue;
+        if (ch < 0)
+        {
+          // Leaf padding spheres are skipped
+          for (INT i = ~ch * 4; i < ~ch * 4 + 4; i++)
+            if (Orig[i] >= 0)
+            {
+              mn[0] = min(mn[0], X[i] - R[i]), mx[0] = max(mx[0], X[i] + R[i]);
+              mn[1] = min(mn[1], Y[i] - R[i]), mx[1] = max(mx[1], Y[i] + R[i]);
+              mn[2] = min(mn[2], Z[i] - R[i]), mx[2] = max(mx[2], Z[i] + R[i]);
+            }
+        }
+        else
+          for (INT c = 0; c < 4; c++)
+            if (Nodes[ch].Child[c] != 0)
+              for (INT a = 0; a < 3; a++)
+              {
+                mn[a] = min(mn[a], Nodes[ch].Box.Min[a][c]);
+                mx[a] = max(mx[a], Nodes[ch].Box.Max[a][c]);
+              }
+        for (INT a = 0; a < 3; a++)
+          nd.Box.Min[a][k] = mn[a], nd.Box.Max[a][k] = mx[a];
+      }
+      return NodeArea(No);
+    } /* End of 'RefitNode' function */
+
+    /* Spheres bound box function.
+     * ARGUMENTS:
+     *   - spheres indices:
+     *       const INT *Ind;
+     *       size_t Count;
+     *   - result box:
+     *       FLT *Min, *Max;
+     * RETURNS: None.
+     */
+    VOID Bound( const INT *Ind, size_t Count, FLT *Min, FLT *Max ) const
+    {
+      const stock<FLT> *c[3] = {&X, &Y, &Z};
+
+      for (INT a = 0; a < 3; a++)
+      {
+        Min[a] = 1e30f, Max[a] = -1e30f;
+        for (size_t i = 0; i < Count; i++)
+        {
+          Min[a] = min(Min[a], (*c[a])[Ind[i]] - R[Ind[i]]);
+          Max[a] = max(Max[a], (*c[a])[Ind[i]] + R[Ind[i]]);
+        }
+      }
+    } /* End of 'Bound' function */
+
+    /* Split spheres by centers median function.
+     * Split point is multiple of 4, so first part leaves are full.
+     * ARGUMENTS:
+     *   - spheres indices (reordered):
+     *       INT *Ind;
+     *       size_t Count;
+     * RETURNS:
+     *   (size_t) first part size.
+     */
+    size_t Split( INT *Ind, size_t Count ) const
+    {
+      const stock<FLT> *c[3] = {&X, &Y, &Z};
+      FLT mn[3] = {1e30f, 1e30f, 1e30f}, mx[3] = {-1e30f, -1e30f, -1e30f};
+      size_t m = (Count / 2 + 3) / 4 * 4;
+      INT a = 0;
+
+      for (size_t i = 0; i < Count; i++)
+        for (INT k = 0; k < 3; k++)
+          mn[k] = min(mn[k], (*c[k])[Ind[i]]), mx[k] = max(mx[k], (*c[k])[Ind[i]]);
+      for (INT k = 1; k < 3; k++)
+        if (mx[k] - mn[k] > mx[a] - mn[a])
+          a = k;
+      std::nth_element(Ind, Ind + m, Ind + Count,
+        [&]( INT A, INT B )
+        {
+          return (*c[a])[A] < (*c[a])[B];
+        });
+      return m;
+    } /* End of 'Split' function */
+
+    /* Build BVH node function.
+     * ARGUMENTS:
+     *   - spheres indices:
+     *       INT *Ind;
+     *       size_t Count;
+     *   - reordered spheres arrays to append leaves to:
+     *       stock<FLT> &NX, &NY, &NZ, &NR;
+     *       stock<WORD> &NM;
+     *       stock<INT> &NO;
+     * RETURNS:
+     *   (INT) node number.
+     */
+    INT BuildNode( INT *Ind, size_t Count, stock<FLT> &NX, stock<FLT> &NY, stock<FLT> &NZ,
+                   stock<FLT> &NR, stock<WORD> &NM, stock<INT> &NO )
+    {
+      INT *part[4] = {Ind};
+      size_t size[4] = {Count}, parts = 1;
+
+      // Up to two median splits levels
+      for (INT level = 0; level < 2; level++)
+        for (size_t p = 0, pn = parts; p < pn; p++)
+          if (size[p] > 4)
+          {
+            size_t m = Split(part[p], size[p]);
+
+            part[parts] = part[p] + m, size[parts] = size[p] - m;
+            size[p] = m;
+            parts++;
+          }
+
+      INT no = (INT)Nodes.size();
+      Nodes << node {};
+      for (INT k = 0; k < 4; k++)
+      {
+        FLT mn[3] = {1e30f, 1e30f, 1e30f}, mx[3] = {-1e30f, -1e30f, -1e30f};
+        INT child = 0;
+
+        if (k < (INT)parts)
+        {
+          Bound(part[k], size[k], mn, mx);
+          if (size[k] > 4)
+            child = BuildNode(part[k], size[k], NX, NY, NZ, NR, NM, NO);
+          else
+          {
+            // Leaf: block of 4 spheres, missing ones are put far away with zero radius
+            child = ~(INT)(NX.size() / 4);
+            for (size_t i = 0; i < 4; i++)
+              if (i < size[k])
+              {
+                INT s = part[k][i];
+
+                Slot[Orig[s]] = (INT)NX.size();
+                NX << X[s], NY << Y[s], NZ << Z[s], NR << R[s], NM << SphereMtl[s], NO << Orig[s];
+              }
+              else
+                NX << 1e18f, NY << 1e18f, NZ << 1e18f, NR << 0, NM << 0, NO << -1;
+          }
+        }
+        for (INT a = 0; a < 3; a++)
+          Nodes[no].Box.Min[a][k] = mn[a], Nodes[no].Box.Max[a][k] = mx[a];
+        Nodes[no].Child[k] = child;
+      }
+      return no;
+    } /* End of 'BuildNode' function */
+  }; /* End of 'sphere_cloud' class */
+} /* End of 'gort' namespace */
+
+#endif // __cloud_h_
+
+/* End of 'cloud.h' file */
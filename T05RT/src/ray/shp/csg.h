@@ -132,6 +132,33 @@ namespace gort
       }
       return FALSE;
     } /* End of 'Intersect' function */
+
+    /* Account shape memory function.
+     * ARGUMENTS:
+     *   - report to fill:
+     *       mem_report &Rep;
+     * RETURNS: None.
+     */
+    VOID Account( mem_report &Rep ) const override
+    {
+      // Operands are owned by node
+      Rep.Add("shapes", "csg", 1, sizeof(csg));
+      A->Account(Rep);
+      B->Account(Rep);
+    } /* End of 'Account' function */
+
+    /* Hash shape geometry and materials function.
+     * ARGUMENTS:
+     *   - hash to add to:
+     *       hasher &H;
+     * RETURNS:
+     *   (BOOL) TRUE if both operands are hashed, FALSE otherwise.
+     */
+    BOOL Hash( hasher &H ) const override
+    {
+      H << "csg" << CSGType;
+      return A->Hash(H) && B->Hash(H);
+    } /* End of 'Hash' function */
   }; /* End of 'sphere' class */
 } /* End of 'gort' namespace */
 
@@ -8,8 +8,14 @@
  *               Triabgle shape class declaration module.
  * PROGRAMMER  : CGSG-SummerCamp'2024.
  *               Vladislav A. Golubov (VG6).
- * LAST UPDATE : 24.07.2024.
- * NOTE        : None.
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : Mesh is indexed: float positions and normals are
+ *               stored once per vertex, triangle is 3 vertex numbers.
+ *               Shading normal is interpolated from vertex normals
+ *               at hit time, normals may be quantized to 32 bits.
+ *               Primitive bound boxes are mesh hierarchy: after
+ *               vertices change ('SetTransform' or direct 'Positions'
+ *               edit) 'Refit' recomputes them from triangles.
  *
  * No part of this file may be changed without agreement of
  * Computer Graphics Support Group of 30 Phys-Math Lyceum
@@ -18,165 +24,329 @@
 #define __g3dm_h_
 #include <map>
 #include "../rt_def.h"
+#include "../timeline.h"
 
 /* Application namespace. */
 namespace gort
 {
-   /* prim shape class. */
-  class prim : public shape
+  /* Indexed mesh primitive (triangles range with bound box) */
+  struct prim
+  {
+    INT First, Count;  // First triangle number and triangles count
+    INT MtlNo;         // File material number
+    vec3 MinBB, MaxBB; // Bound box
+  }; /* End of 'prim' structure */
+
+  /* obj shape class. */
+  class g3dm : public shape
   {
   public:
-    stock<triangle> triangles;
-    INT MtlNo;
+    CHAR Path[200];
+    stock<prim> Prims;               // Primitives
+    stock<mth::vec3<FLT>> Positions; // Vertex positions
+    stock<mth::vec3<FLT>> Normals;   // Vertex normals (empty if quantized)
+    stock<DWORD> QNormals;           // Vertex octahedron quantized normals
+    stock<INT> Indices;              // Triangles vertex numbers (3 per triangle)
+    BOOL IsQuantized;                // Quantized normals flag
+    stock<mth::vec3<FLT>> RestPositions, RestNormals; // Rest pose (empty before first 'SetTransform')
+    stock<DWORD> RestQNormals;       // Rest pose quantized normals
 
-    vec3 MinBB, MaxBB;
-    prim()
-    {
-    }
-    /* Add triangle in primitive function
+    /* Class constructor.
      * ARGUMENTS:
-     *   - new element of primitive
-     *       triangle &elem;
-     * RETURNSL None.
+     *   - model file name:
+     *       const CHAR *FileName;
+     *   - mesh material (scene material table record number, see 'rt::scene::Mtls'):
+     *       DWORD MtlNo;
+     *   - store normals quantized to 32 bits:
+     *       BOOL IsQuantizedNormals;
      */
-    VOID operator<<( triangle elem )
+    g3dm( const CHAR *FileName, DWORD MtlNo, BOOL IsQuantizedNormals = FALSE ) :
+      IsQuantized(IsQuantizedNormals)
     {
-      triangles << elem;
-    }
+      strncpy(Path, FileName, 200);
+      Mtl = MtlNo;
+      ParseG3DM();
+    } /* End of 'g3dm' function */
 
-    /* Get normal function.
+    /* Obtain triangles count function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (INT) triangles count.
+     */
+    INT TriangleCount( VOID ) const
+    {
+      return (INT)(Indices.size() / 3);
+    } /* End of 'TriangleCount' function */
+
+    /* Obtain geometry memory function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (size_t) vertex, index and primitives arrays size in bytes.
+     */
+    size_t Memory( VOID ) const
+    {
+      return Positions.capacity() * sizeof(mth::vec3<FLT>) + Normals.capacity() * sizeof(mth::vec3<FLT>) +
+        QNormals.capacity() * sizeof(DWORD) + Indices.capacity() * sizeof(INT) + Prims.capacity() * sizeof(prim) +
+        (RestPositions.capacity() + RestNormals.capacity()) * sizeof(mth::vec3<FLT>) + RestQNormals.capacity() * sizeof(DWORD);
+    } /* End of 'Memory' function */
+
+    /* Account shape memory function.
      * ARGUMENTS:
-     *   - intersection data:
-     *       intr *in;
+     *   - report to fill:
+     *       mem_report &Rep;
      * RETURNS: None.
      */
-    VOID GetNormal( intr *in )
+    VOID Account( mem_report &Rep ) const override
     {
-    } /* End of 'GetNormal' function */
-    BOOL VirtualBoxIntersect( const ray &R, intr *Intr, const vec3 &Max, const vec3 &Min )
+      // Primitives bound boxes are mesh hierarchy
+      Rep.Add("shapes", "mesh", 1, sizeof(g3dm));
+      Rep.Add("mesh", "vertices", Positions.size(),
+        mem_report::Of(Positions) + mem_report::Of(Normals) + mem_report::Of(QNormals));
+      Rep.Add("mesh", "indices", Indices.size(), mem_report::Of(Indices));
+      Rep.Add("mesh", "bvh", Prims.size(), mem_report::Of(Prims));
+      if (!RestPositions.empty())
+        Rep.Add("mesh", "rest pose", RestPositions.size(),
+          mem_report::Of(RestPositions) + mem_report::Of(RestNormals) + mem_report::Of(RestQNormals));
+    } /* End of 'Account' function */
+
+    /* Hash shape geometry and materials function.
+     * ARGUMENTS:
+     *   - hash to add to:
+     *       hasher &H;
+     * RETURNS:
+     *   (BOOL) TRUE.
+     */
+    BOOL Hash( hasher &H ) const override
     {
-      INT tnear_no = -1, tfar_no = -1;
-      DBL tnear = -1, tfar = -1, t = -1;
+      // Primitives are built from same file data
+      H << "mesh" << Positions << Normals << QNormals << Indices << Mtl;
+      return TRUE;
+    } /* End of 'Hash' function */
 
-      for (INT i = 0; i < 3; i++)
+    /* Place mesh by transform of its rest pose function.
+     * Normals are transformed without translation, so transform
+     * should keep angles (rotation, translation, uniform scale).
+     * ARGUMENTS:
+     *   - rest pose to world transform:
+     *       const matr &M;
+     * RETURNS:
+     *   (BOOL) TRUE.
+     */
+    BOOL SetTransform( const matr &M ) override
+    {
+      if (RestPositions.empty())
       {
-        if (std::fabs(R.Dir[i]) < Threshold)
-        {
-          if (R.Org[i] < Min[i] || R.Org[i] > Max[i])
-            return FALSE;
-        }
-        else
-        {
-          if (R.Dir[i] > Threshold)
-          {
-            if (R.Org[i] > Max[i])
-              return FALSE;
-            if (R.Org[i] < Min[i])
-            {
-              t = (Min[i] - R.Org[i]) / R.Dir[i];
-              if (tnear_no == -1 || tnear < t)
-                tnear_no = i * 2, tnear = t;
-            }
-            t = (Max[i] - R.Org[i]) / R.Dir[i];
-            if (tfar_no == -1 || tfar > t)
-              tfar_no = i * 2 + 1, tfar = t;
-          }
-          else
-          {
-            if (R.Org[i] < Min[i])
-              return FALSE;
-            if (R.Org[i] > Max[i])
-            {
-              t = (Max[i] - R.Org[i]) / R.Dir[i];
-              if (tnear_no == -1 || tnear < t)
-                tnear_no = i * 2, tnear = t;
-              
-            }
-            t = (Min[i] - R.Org[i]) / R.Dir[i];
-            if (tfar_no == -1 || tfar > t)
-              tfar_no = i * 2 + 1, tfar = t;
-            
-          }
-        }
+        RestPositions = Positions;
+        RestNormals = Normals;
+        RestQNormals = QNormals;
       }
-      if (tnear_no != -1)
+      for (size_t i = 0; i < Positions.size(); i++)
+        Positions[i] = M.PointTransform(RestPositions[i]);
+      for (size_t i = 0; i < Normals.size(); i++)
+        Normals[i] = M.VectorTransform(RestNormals[i]).Normalizing();
+      for (size_t i = 0; i < QNormals.size(); i++)
       {
-        if (tnear > tfar)
-          return FALSE;
-        Intr->T = tnear;
-        Intr->I[0] = tnear_no;
-        return TRUE;
+        vec3 n = M.VectorTransform(UnpackNormal(RestQNormals[i])).Normalizing();
+
+        QNormals[i] = PackNormal(mth::vec3<FLT>((FLT)n[0], (FLT)n[1], (FLT)n[2]));
       }
-      Intr->T = tfar;
       return TRUE;
-    } /* End of 'Intersection' function */
+    } /* End of 'SetTransform' function */
 
-    BOOL Intersect( const ray &R, intr *Intr )
+    /* Recompute primitives bound boxes after vertices change function.
+     * ARGUMENTS:
+     *   - workers pool and workers count (not used, one pass over triangles):
+     *       thread_pool &Pool;
+     *       INT ThreadCount;
+     * RETURNS:
+     *   (BOOL) FALSE (primitives are kept).
+     */
+    BOOL Refit( thread_pool &Pool, INT ThreadCount ) override
     {
-      intr best_intr, in;
-      BOOL IsNotFind = TRUE;
-      if (VirtualBoxIntersect(R, Intr, MaxBB, MinBB))
-        for (INT i = 0; i < triangles.size(); i++)
+      for (prim &pr : Prims)
+      {
+        pr.MinBB = vec3(1e30), pr.MaxBB = vec3(-1e30);
+        for (INT i = pr.First * 3; i < (pr.First + pr.Count) * 3; i++)
         {
-          triangle &elem = triangles[i];
-          if (elem.Intersect(R, &in))
+          const mth::vec3<FLT> &p = Positions[Indices[i]];
+
+          for (INT a = 0; a < 3; a++)
           {
-            if (IsNotFind || best_intr.T > in.T)
-              best_intr = in, IsNotFind = FALSE, Intr->I[4] = i;
+            pr.MinBB[a] = min(pr.MinBB[a], (DBL)p[a]);
+            pr.MaxBB[a] = max(pr.MaxBB[a], (DBL)p[a]);
           }
         }
-      if (IsNotFind)
-        return FALSE;
-      *Intr = best_intr;
-      return TRUE;
-    }
-  }; /* End of 'prim' class */
+      }
+      return FALSE;
+    } /* End of 'Refit' function */
 
-  /* obj shape class. */
-  class g3dm : public shape
-  {
-  public:
-    CHAR Path[200];
-    stock<prim> *prims;
-    g3dm( const CHAR *FileName, const surface &mtl )
+    /* Quantize normal function.
+     * Octahedron mapping, 16 bits per component.
+     * ARGUMENTS:
+     *   - unit normal:
+     *       const mth::vec3<FLT> &N;
+     * RETURNS:
+     *   (DWORD) quantized normal.
+     */
+    static DWORD PackNormal( const mth::vec3<FLT> &N )
     {
-      strncpy(Path, FileName, 200);
-      prims = new stock<prim>;
-      Material = mtl;
-      ParseG3DM();
-    }
-    ~g3dm()
+      FLT
+        l = fabs(N[0]) + fabs(N[1]) + fabs(N[2]),
+        x = l > 0 ? N[0] / l : 0,
+        y = l > 0 ? N[1] / l : 0;
+
+      if (N[2] < 0)
+      {
+        FLT ox = x;
+
+        x = (1 - fabs(y)) * (x < 0 ? -1 : 1);
+        y = (1 - fabs(ox)) * (y < 0 ? -1 : 1);
+      }
+      return (DWORD)(INT)floor((x * 0.5f + 0.5f) * 65535 + 0.5f) |
+             (DWORD)(INT)floor((y * 0.5f + 0.5f) * 65535 + 0.5f) << 16;
+    } /* End of 'PackNormal' function */
+
+    /* Restore quantized normal function.
+     * ARGUMENTS:
+     *   - quantized normal:
+     *       DWORD Q;
+     * RETURNS:
+     *   (vec3) unit normal.
+     */
+    static vec3 UnpackNormal( DWORD Q )
     {
-      delete prims;
-    }
+      DBL
+        x = (Q & 0xFFFF) / 65535.0 * 2 - 1,
+        y = (Q >> 16) / 65535.0 * 2 - 1,
+        z = 1 - fabs(x) - fabs(y);
+
+      if (z < 0)
+      {
+        DBL ox = x;
+
+        x = (1 - fabs(y)) * (x < 0 ? -1 : 1);
+        y = (1 - fabs(ox)) * (y < 0 ? -1 : 1);
+      }
+      return vec3(x, y, z).Normalizing();
+    } /* End of 'UnpackNormal' function */
 
     /* Get normal function.
+     * Vertex normals are interpolated by hit barycentric coordinates.
      * ARGUMENTS:
-     *   - intersection data:
+     *   - intersection data (triangle number in 'I[0]', barycentrics in 'D[0]', 'D[1]'):
      *       intr *in;
      * RETURNS: None.
      */
     VOID GetNormal( intr *in )
     {
+      const INT *ind = &Indices[in->I[0] * 3];
+      DBL u = in->D[0], v = in->D[1];
+
+      if (IsQuantized)
+        in->N = UnpackNormal(QNormals[ind[0]]) * (1 - u - v) +
+                UnpackNormal(QNormals[ind[1]]) * u + UnpackNormal(QNormals[ind[2]]) * v;
+      else
+      {
+        auto n =
+          [this]( INT No )
+          {
+            return vec3(Normals[No][0], Normals[No][1], Normals[No][2]);
+          };
+        in->N = n(ind[0]) * (1 - u - v) + n(ind[1]) * u + n(ind[2]) * v;
+      }
+      in->N.Normalize();
     } /* End of 'GetNormal' function */
 
+    /* Find closest intersection function
+     * ARGUMENTS:
+     *   - tracing ray:
+     *       ray &R;
+     *   - intersection data (distance, triangle number in 'I[0]', barycentrics in 'D[0]', 'D[1]'):
+     *       intr *Intr;
+     * RETURNS:
+     *   (BOOL) TRUE if intersected, FALSE otherwise.
+     */
     BOOL Intersect( const ray &R, intr *Intr )
     {
-      intr best_intr, in;
-      BOOL IsNotFind = TRUE;
-      for (prim &elem : *prims)
+      DBL best = -1, bu = 0, bv = 0;
+      INT best_no = -1;
+
+      for (const prim &pr : Prims)
       {
-        if (elem.Intersect(R, &in))
+        DBL tnear, tfar;
+
+        if (!mth::Slab(R, pr.MinBB, pr.MaxBB, &tnear, &tfar) || (best_no >= 0 && tnear > best))
+          continue;
+        for (INT i = pr.First; i < pr.First + pr.Count; i++)
         {
-          if (IsNotFind || best_intr.T > in.T)
-            best_intr = in, IsNotFind = FALSE;
+          DBL t, u, v;
+
+          if (TriangleIntersect(R, i, &t, &u, &v) && (best_no < 0 || t < best))
+            best = t, best_no = i, bu = u, bv = v;
         }
       }
-      if (IsNotFind)
+      if (best_no < 0)
         return FALSE;
-      *Intr = best_intr;
+      Intr->T = best;
+      Intr->I[0] = best_no;
+      Intr->D[0] = bu;
+      Intr->D[1] = bv;
       return TRUE;
-    }
+    } /* End of 'Intersect' function */
+
+    /* Obtain triangle vertex position function.
+     * ARGUMENTS:
+     *   - triangle number:
+     *       INT No;
+     *   - triangle vertex number (0..2):
+     *       INT V;
+     * RETURNS:
+     *   (vec3) vertex position.
+     */
+    vec3 Position( INT No, INT V ) const
+    {
+      const mth::vec3<FLT> &p = Positions[Indices[No * 3 + V]];
+
+      return vec3(p[0], p[1], p[2]);
+    } /* End of 'Position' function */
+
+    /* Single triangle ray intersection function.
+     * Moller-Trumbore test, triangle is not stored expanded.
+     * ARGUMENTS:
+     *   - tracing ray:
+     *       ray &R;
+     *   - triangle number:
+     *       INT No;
+     *   - result distance and barycentrics:
+     *       DBL *T, *U, *V;
+     * RETURNS:
+     *   (BOOL) TRUE if intersected, FALSE otherwise.
+     */
+    BOOL TriangleIntersect( const ray &R, INT No, DBL *T, DBL *U, DBL *V ) const
+    {
+      vec3
+        p0 = Position(No, 0),
+        e1 = Position(No, 1) - p0,
+        e2 = Position(No, 2) - p0,
+        pv = R.Dir % e2;
+      DBL det = e1 & pv;
+
+      if (fabs(det) <= Threshold * Threshold)
+        return FALSE;
+      DBL inv = 1 / det;
+      vec3 tv = R.Org - p0;
+
+      *U = (tv & pv) * inv;
+      if (*U < 0 || *U > 1)
+        return FALSE;
+      vec3 qv = tv % e1;
+
+      *V = (R.Dir & qv) * inv;
+      if (*V < 0 || *U + *V > 1)
+        return FALSE;
+      *T = (e2 & qv) * inv;
+      return *T >= Threshold;
+    } /* End of 'TriangleIntersect' function */
 
   private:
 
@@ -197,6 +367,7 @@ namespace gort
       DWORD NumOfPrims;
       DWORD NumOfMaterials;
       DWORD NumOfTextures;
+      timeline_scope ts("g3dm load");
 
       /* Open file */
       if ((F = fopen(Path, "rb")) == NULL)
@@ -218,7 +389,7 @@ namespace gort
       ptr += 4;
       if (Sign != *(DWORD *)"G3DM")
       {
-        free(mem);
+        delete[] mem;
         return FALSE;
       }
       NumOfPrims = *(DWORD *)ptr;
@@ -228,7 +399,7 @@ namespace gort
       NumOfTextures = *(DWORD *)ptr;
       ptr += 4;
 
-      /* Load primitives */
+      /* Load primitives: vertices are stored once, triangles are vertex numbers */
       for (p = 0; p < NumOfPrims; p++)
       {
         DWORD NumOfVertex;
@@ -237,6 +408,7 @@ namespace gort
         Vertex *V;
         INT *Ind;
         prim primitive;
+        INT base = (INT)Positions.size();
 
         NumOfVertex = *(DWORD *)ptr, ptr += 4;
         NumOfFaceIndexes = *(DWORD *)ptr, ptr += 4;
@@ -244,20 +416,22 @@ namespace gort
         V = (Vertex *)ptr, ptr += sizeof(Vertex) * NumOfVertex;
         Ind = (INT *)ptr, ptr += sizeof(INT) * NumOfFaceIndexes;
 
+        if (NumOfVertex == 0)
+          continue;
         primitive.MtlNo = MtlNo;
-        for (int tr = 0; tr < NumOfFaceIndexes; tr += 3)
+        primitive.First = (INT)(Indices.size() / 3);
+        primitive.Count = NumOfFaceIndexes / 3;
+        for (INT i = 0; i < (INT)NumOfVertex; i++)
         {
-          vec3 P0 = vec3(V[Ind[tr + 0]].P[0], V[Ind[tr + 0]].P[1], V[Ind[tr + 0]].P[2]);
-          vec3 P1 = vec3(V[Ind[tr + 1]].P[0], V[Ind[tr + 1]].P[1], V[Ind[tr + 1]].P[2]);
-          vec3 P2 = vec3(V[Ind[tr + 2]].P[0], V[Ind[tr + 2]].P[1], V[Ind[tr + 2]].P[2]);
-          triangle A = triangle(P0, P1, P2,
-                                vec3(V[Ind[tr + 0]].N[0], V[Ind[tr + 0]].N[1], V[Ind[tr + 0]].N[2]),
-                                vec3(V[Ind[tr + 1]].N[0], V[Ind[tr + 1]].N[1], V[Ind[tr + 1]].N[2]),
-                                vec3(V[Ind[tr + 2]].N[0], V[Ind[tr + 2]].N[1], V[Ind[tr + 2]].N[2]));
-          if (NumOfMaterials < 1)
-            A.Material = Material;
-          primitive << A;
+          Positions << V[i].P;
+          if (IsQuantized)
+            QNormals << PackNormal(V[i].N);
+          else
+            Normals << V[i].N;
         }
+        for (INT i = 0; i < primitive.Count * 3; i++)
+          Indices << base + Ind[i];
+
         /* Get min max BB */
         primitive.MaxBB = vec3(V[0].P[0], V[0].P[1],V[0].P[2]);
         primitive.MinBB = primitive.MaxBB;
@@ -277,44 +451,10 @@ namespace gort
           if (V[i].P[2] < primitive.MinBB[2])
             primitive.MinBB[2] = V[i].P[2];
         }
-        *prims << primitive;
+        Prims << primitive;
       }
 
-#if 0
-      /* Load materials */
-      for (INT m = 0; m < NumOfMaterials; m++)
-      {
-        struct mtl
-        {
-          CHAR Name[300]; /* Material name */
-          /* Illumination coefficients */
-          vec3 Ka, Kd, Ks;     /* Ambient, diffuse, specular coefficients */
-          FLT Ph;              /* Phong power coefficient  shininess */
-          FLT Trans;           /* Transparency factor */
-          DWORD Tex[8];        /* Texture references 
-                               * (8 time: texture number in G3DM file, -1 if no texture) */
-          /* Shader information */
-          CHAR ShaderString[300]; /* Additional shader information */
-          DWORD Shader;           /* Shader number (uses after load into memory) */
-        } *fmat;
-
-        for (auto &pr : *prims)
-        {
-          if (pr.MtlNo == m)
-          {
-            fmat = (mtl *)ptr;
-            ptr += sizeof(*fmat);
-            strncpy(pr.Material.Name, fmat->Name, 199);
-            pr.Material.Ka = fmat->Ka;
-            pr.Material.Kd = fmat->Kd;
-            pr.Material.Ks = fmat->Ks;
-            pr.Material.Ph = fmat->Ph;
-            break;
-          }
-        }
-      }
-#endif
-      free(mem);
+      delete[] mem;
       return TRUE;
       }
     }; /* End of 'g3dm' class */
@@ -30,18 +30,20 @@ namespace gort
     vec3 P;
     vec3 N;
   public:
+    friend class snapshot;
+    friend class flat_shapes;
 
-    plane( const vec3 &Pos, const vec3 &Norm, const surface mtl = {} )
+    plane( const vec3 &Pos, const vec3 &Norm, const DWORD MtlNo = 0 )
     {
       P = Pos;
       N = Norm.Normalizing();
-      Material = mtl;
+      Mtl = MtlNo;
     }
-    plane( const vec3 &Pos0, const vec3 &Pos1, const vec3 &Pos2, const surface mtl = {} )
+    plane( const vec3 &Pos0, const vec3 &Pos1, const vec3 &Pos2, const DWORD MtlNo = 0 )
     {
       P = Pos0;
       N = ((Pos2 - Pos0) % (Pos1 - Pos0)).Normalizing();
-      Material = mtl;
+      Mtl = MtlNo;
     }
 
     /* Get normal function.
@@ -98,6 +100,29 @@ namespace gort
         return 1;
       } /* End of 'AllIntersect' function */
 
+    /* Account shape memory function.
+     * ARGUMENTS:
+     *   - report to fill:
+     *       mem_report &Rep;
+     * RETURNS: None.
+     */
+    VOID Account( mem_report &Rep ) const override
+    {
+      Rep.Add("shapes", "plane", 1, sizeof(plane));
+    } /* End of 'Account' function */
+
+    /* Hash shape geometry and materials function.
+     * ARGUMENTS:
+     *   - hash to add to:
+     *       hasher &H;
+     * RETURNS:
+     *   (BOOL) TRUE.
+     */
+    BOOL Hash( hasher &H ) const override
+    {
+      H << "plane" << P << N << Mtl;
+      return TRUE;
+    } /* End of 'Hash' function */
   }; /* End of 'plane' class */
 } /* End of 'gort' namespace */
 
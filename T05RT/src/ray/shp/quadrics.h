@@ -50,6 +50,29 @@ namespace gort
     VOID GetNormal( intr *in )
     {} /* End of 'GetNormal' function */
 
+    /* Account shape memory function.
+     * ARGUMENTS:
+     *   - report to fill:
+     *       mem_report &Rep;
+     * RETURNS: None.
+     */
+    VOID Account( mem_report &Rep ) const override
+    {
+      Rep.Add("shapes", "quadrics", 1, sizeof(quadrics));
+    } /* End of 'Account' function */
+
+    /* Hash shape geometry and materials function.
+     * ARGUMENTS:
+     *   - hash to add to:
+     *       hasher &H;
+     * RETURNS:
+     *   (BOOL) TRUE.
+     */
+    BOOL Hash( hasher &H ) const override
+    {
+      H << "quadrics" << A << B << C << D << E << F << G << this->H << I << J << Mtl;
+      return TRUE;
+    } /* End of 'Hash' function */
   }; /* End of 'quadrics' class */
 } /* End of 'gotr' namespace */
 
@@ -24,6 +24,7 @@
 #include "triangle.h"
 #include "csg.h"
 #include "g3dm.h"
+#include "cloud.h"
 
 #endif // __shapes_h_
 
@@ -29,6 +29,8 @@ namespace gort
     DBL R;
     DBL R2;
   public:
+    friend class snapshot;
+    friend class flat_shapes;
 
     sphere( const vec3 &Center, const DBL Rad )
     {
@@ -36,12 +38,12 @@ namespace gort
       R2 = Rad * Rad;
       C = Center;
     }
-    sphere( const vec3 &Center, const DBL Rad, const surface Mtl )
+    sphere( const vec3 &Center, const DBL Rad, const DWORD MtlNo )
     {
       R = Rad;
       R2 = Rad * Rad;
       C = Center;
-      Material = Mtl;
+      Mtl = MtlNo;
     }
     /* Get normal function.
      * ARGUMENTS:
@@ -137,6 +139,44 @@ namespace gort
       {
         return ((P - C) & (P - C)) - R2 <= Threshold;
       } /* End of 'IsInside' function */
+
+      /* Obtain shape bound box function.
+       * ARGUMENTS:
+       *   - result box corners:
+       *       vec3 *Min, *Max;
+       * RETURNS:
+       *   (BOOL) TRUE.
+       */
+      BOOL GetBound( vec3 *Min, vec3 *Max ) const override
+      {
+        *Min = C - vec3(R);
+        *Max = C + vec3(R);
+        return TRUE;
+      } /* End of 'GetBound' function */
+
+      /* Account shape memory function.
+       * ARGUMENTS:
+       *   - report to fill:
+       *       mem_report &Rep;
+       * RETURNS: None.
+       */
+      VOID Account( mem_report &Rep ) const override
+      {
+        Rep.Add("shapes", "sphere", 1, sizeof(sphere));
+      } /* End of 'Account' function */
+
+      /* Hash shape geometry and materials function.
+       * ARGUMENTS:
+       *   - hash to add to:
+       *       hasher &H;
+       * RETURNS:
+       *   (BOOL) TRUE.
+       */
+      BOOL Hash( hasher &H ) const override
+      {
+        H << "sphere" << C << R << Mtl;
+        return TRUE;
+      } /* End of 'Hash' function */
   }; /* End of 'sphere' class */
 } /* End of 'gort' namespace */
 
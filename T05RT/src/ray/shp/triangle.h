@@ -32,6 +32,9 @@ namespace gort
     DBL u0, v0;
   
   public:
+    friend class snapshot;
+    friend class flat_shapes;
+    friend class visbuf;
     triangle( const vec3 &Pos0, const vec3 &Pos1, const vec3 &Pos2 )
     {
       vec3 S1, S2;
@@ -98,6 +101,30 @@ namespace gort
       }
       return FALSE;
     }
+
+    /* Account shape memory function.
+     * ARGUMENTS:
+     *   - report to fill:
+     *       mem_report &Rep;
+     * RETURNS: None.
+     */
+    VOID Account( mem_report &Rep ) const override
+    {
+      Rep.Add("shapes", "triangle", 1, sizeof(triangle));
+    } /* End of 'Account' function */
+
+    /* Hash shape geometry and materials function.
+     * ARGUMENTS:
+     *   - hash to add to:
+     *       hasher &H;
+     * RETURNS:
+     *   (BOOL) TRUE.
+     */
+    BOOL Hash( hasher &H ) const override
+    {
+      H << "triangle" << P0 << P1 << P2 << N << N1 << N2 << N3 << Mtl;
+      return TRUE;
+    } /* End of 'Hash' function */
   }; /* End of 'triangle' class */
 } /* End of 'gotr' namespace */
 
@@ -0,0 +1,517 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : snapshot.h
+ * PURPOSE     : Raytracing project.
+ *               Binary scene snapshot module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : File layout: 'snap_header', then record tables
+ *               (materials, spheres, boxes, planes, triangles, lights,
+ *               meshes) at 8 byte aligned offsets stored in header.
+ *               Material, sphere, box, plane and triangle tables use
+ *               'rt_flat.h' records. Loaded to empty scene typed arrays
+ *               they are used in place: arrays view mapped tables and
+ *               scene keeps the mapping, so several render processes
+ *               share one copy of scene pages. Otherwise records are
+ *               copied with material numbers patched.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#ifndef __snapshot_h_
+#define __snapshot_h_
+
+#include <fstream>
+#include <string>
+#include <filesystem>
+#include <memory>
+#include "rt_scene.h"
+#include "shp/shapes.h"
+#include "lgh/lights.h"
+
+/* Project namespace */
+namespace gort
+{
+  /* Snapshot light record */
+  struct snap_light
+  {
+    DWORD Type;      // Light type (0 - point, 1 - direction, 2 - rectangle, 3 - sphere)
+    INT Strata;      // Area light maximal strata per side
+    vec3 Pos;        // Point light position, light direction, rectangle corner or sphere center
+    vec3 Color;      // Light color
+    DBL Power;       // Point and area light power
+    vec3 E1, E2;     // Rectangle light edges
+    DBL Radius;      // Sphere light radius
+  }; /* End of 'snap_light' structure */
+
+  /* Snapshot mesh reference record */
+  struct snap_mesh
+  {
+    CHAR Path[200]; // '.g3dm' file path
+    DWORD Mtl, Pad; // Material number
+  }; /* End of 'snap_mesh' structure */
+
+  /* Snapshot file header */
+  struct snap_header
+  {
+    /* Record table numbers */
+    enum TABLE
+    {
+      Materials, Spheres, Boxes, Planes, Triangles, Lights, Meshes,
+      TableCount
+    };
+
+    DWORD Sign;                  // "GSNP"
+    DWORD Version;               // Format version
+    DWORD Count[TableCount + 1]; // Table record counts (last is padding)
+    UINT64 Offset[TableCount];   // Table file offsets
+    vec3 CamLoc, CamAt, CamUp;   // Camera view
+    DBL CamSize, CamProjDist, CamFarClip; // Camera projection
+    vec3 AmbientColor, BkgColor; // Scene colors
+    DBL AirRefraction, AirDecay; // Scene air media
+    INT RecMaxLevel, Pad;        // Scene recursion depth
+  }; /* End of 'snap_header' structure */
+
+  /* Memory mapped scene snapshot class */
+  class snapshot
+  {
+    HANDLE hFile = INVALID_HANDLE_VALUE, hMap = NULL; // Mapped file handles
+    const BYTE *Mem = nullptr;                        // Mapped file view
+    UINT64 Size = 0;                                  // Mapped file size
+
+  public:
+    // Current format version
+    static const DWORD Version = 3;
+
+    /* Class constructor */
+    snapshot( VOID )
+    {
+    } /* End of 'snapshot' function */
+
+    /* Class destructor */
+    ~snapshot( VOID )
+    {
+      Close();
+    } /* End of '~snapshot' function */
+
+    snapshot( const snapshot & ) = delete;
+    snapshot & operator=( const snapshot & ) = delete;
+
+    /* Obtain snapshot header function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (const snap_header *) header pointer (nullptr if not opened).
+     */
+    const snap_header * Header( VOID ) const
+    {
+      return (const snap_header *)Mem;
+    } /* End of 'Header' function */
+
+    /* Obtain record table function.
+     * ARGUMENTS:
+     *   - table number:
+     *       snap_header::TABLE Table;
+     * RETURNS:
+     *   (const Type *) table records pointer, mapped from file.
+     */
+    template<typename Type>
+      const Type * Get( snap_header::TABLE Table ) const
+      {
+        return (const Type *)(Mem + Header()->Offset[Table]);
+      } /* End of 'Get' function */
+
+    /* Obtain record table size function.
+     * ARGUMENTS:
+     *   - table number:
+     *       snap_header::TABLE Table;
+     * RETURNS:
+     *   (DWORD) table records count.
+     */
+    DWORD Count( snap_header::TABLE Table ) const
+    {
+      return Header()->Count[Table];
+    } /* End of 'Count' function */
+
+    /* Close mapped snapshot function.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID Close( VOID )
+    {
+      if (Mem != nullptr)
+        UnmapViewOfFile(Mem);
+      if (hMap != NULL)
+        CloseHandle(hMap);
+      if (hFile != INVALID_HANDLE_VALUE)
+        CloseHandle(hFile);
+      Mem = nullptr;
+      hMap = NULL;
+      hFile = INVALID_HANDLE_VALUE;
+      Size = 0;
+    } /* End of 'Close' function */
+
+    /* Map snapshot file function.
+     * ARGUMENTS:
+     *   - file name:
+     *       const std::string &FileName;
+     * RETURNS:
+     *   (BOOL) TRUE if file is mapped and valid, FALSE otherwise.
+     */
+    BOOL Open( const std::string &FileName )
+    {
+      static const UINT64 RecSize[snap_header::TableCount] =
+      {
+        sizeof(flat_mtl), sizeof(flat_sphere), sizeof(flat_box), sizeof(flat_plane),
+        sizeof(flat_triangle), sizeof(snap_light), sizeof(snap_mesh)
+      };
+      LARGE_INTEGER fs;
+
+      Close();
+      if ((hFile = CreateFile(FileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL)) == INVALID_HANDLE_VALUE)
+        return FALSE;
+      if (!GetFileSizeEx(hFile, &fs) || (Size = fs.QuadPart) < sizeof(snap_header) ||
+          (hMap = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL)) == NULL ||
+          (Mem = (const BYTE *)MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0)) == nullptr)
+      {
+        Close();
+        return FALSE;
+      }
+
+      // Validate header and table bounds
+      const snap_header *h = Header();
+      BOOL IsValid = h->Sign == *(DWORD *)"GSNP" && h->Version == Version;
+      for (INT i = 0; IsValid && i < snap_header::TableCount; i++)
+        IsValid = h->Offset[i] % 8 == 0 && h->Offset[i] <= Size &&
+                  h->Count[i] <= (Size - h->Offset[i]) / RecSize[i];
+      if (!IsValid)
+        Close();
+      return IsValid;
+    } /* End of 'Open' function */
+
+    /* Estimate scene memory growth on build function.
+     * Typed tables used in place are counted too (scene report counts
+     * mapped tables).
+     * ARGUMENTS:
+     *   - store shapes to typed arrays flag:
+     *       BOOL IsFlat;
+     * RETURNS:
+     *   (size_t) memory to be allocated by 'Build' in bytes.
+     */
+    size_t Estimate( BOOL IsFlat ) const
+    {
+      size_t
+        spheres = Count(snap_header::Spheres),
+        boxes = Count(snap_header::Boxes),
+        planes = Count(snap_header::Planes),
+        tris = Count(snap_header::Triangles),
+        sum = Count(snap_header::Materials) * (sizeof(surface) + sizeof(envi) + sizeof(DWORD));
+
+      if (IsFlat)
+        sum += spheres * sizeof(flat_sphere) + boxes * sizeof(flat_box) +
+          planes * sizeof(flat_plane) + tris * sizeof(flat_triangle);
+      else
+        sum += spheres * sizeof(sphere) + boxes * sizeof(box) + planes * sizeof(plane) + tris * sizeof(triangle) +
+          (spheres + boxes + planes + tris) * sizeof(shape *);
+
+      // Mesh geometry is about as large as its file
+      for (const snap_mesh *m = Get<snap_mesh>(snap_header::Meshes),
+           *end = m + Count(snap_header::Meshes); m < end; m++)
+      {
+        CHAR path[sizeof(m->Path) + 1] {};
+        std::error_code ec;
+
+        strncpy(path, m->Path, sizeof(m->Path));
+        if (UINT64 size = std::filesystem::file_size(path, ec); !ec)
+          sum += (size_t)size;
+      }
+      return sum;
+    } /* End of 'Estimate' function */
+
+    /* Check typed tables material numbers function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (BOOL) TRUE if all records refer to stored materials, FALSE otherwise.
+     */
+    BOOL IsMtlValid( VOID ) const
+    {
+      DWORD n = Count(snap_header::Materials);
+      auto check =
+        [&]<typename rec>( const rec *Recs, snap_header::TABLE Table )
+        {
+          for (const rec *r = Recs, *end = r + Count(Table); r < end; r++)
+            if (r->Mtl >= n)
+              return FALSE;
+          return TRUE;
+        };
+
+      return
+        check(Get<flat_sphere>(snap_header::Spheres), snap_header::Spheres) &&
+        check(Get<flat_box>(snap_header::Boxes), snap_header::Boxes) &&
+        check(Get<flat_plane>(snap_header::Planes), snap_header::Planes) &&
+        check(Get<flat_triangle>(snap_header::Triangles), snap_header::Triangles);
+    } /* End of 'IsMtlValid' function */
+
+    /* Add snapshot shapes, lights and camera to scene function.
+     * Materials are added to scene material table. Typed tables are viewed
+     * in place if mapping owner is given, shapes go to empty typed arrays,
+     * all material numbers are valid and stored materials keep their numbers
+     * in scene table (copied otherwise).
+     * ARGUMENTS:
+     *   - scene to fill:
+     *       rt::scene &Scene;
+     *   - camera to setup:
+     *       camera &Cam;
+     *   - store shapes to typed arrays ('rt::scene::Flat') flag:
+     *       BOOL IsFlat;
+     *   - this snapshot owner (kept by scene while tables are viewed, nullptr to copy tables):
+     *       const std::shared_ptr<VOID> &Owner;
+     * RETURNS:
+     *   (BOOL) TRUE if typed tables are used in place, FALSE if copied.
+     */
+    BOOL Build( rt::scene &Scene, camera &Cam, BOOL IsFlat = TRUE, const std::shared_ptr<VOID> &Owner = nullptr ) const
+    {
+      timeline_scope ts("snapshot build");
+      const snap_header *h = Header();
+      const flat_mtl *mtls = Get<flat_mtl>(snap_header::Materials);
+      flat_shapes &f = Scene.Flat;
+      std::vector<DWORD> mtl_nums(h->Count[snap_header::Materials]);
+      BOOL IsSameNums = TRUE;
+
+      // Scene material numbers (out of range numbers refer to default material)
+      for (DWORD i = 0; i < mtl_nums.size(); i++)
+        IsSameNums &= (mtl_nums[i] = flat_shapes::AddMtl(Scene.Mtls, mtls[i])) == i;
+
+      BOOL IsInPlace = Owner != nullptr && IsFlat && f.Size() == 0 && IsSameNums && IsMtlValid();
+
+      if (IsInPlace)
+        f.Attach(Owner,
+          Get<flat_sphere>(snap_header::Spheres), h->Count[snap_header::Spheres],
+          Get<flat_box>(snap_header::Boxes), h->Count[snap_header::Boxes],
+          Get<flat_plane>(snap_header::Planes), h->Count[snap_header::Planes],
+          Get<flat_triangle>(snap_header::Triangles), h->Count[snap_header::Triangles]);
+      auto mtl_no =
+        [&]( DWORD Mtl )
+        {
+          return Mtl < mtl_nums.size() ? mtl_nums[Mtl] : 0;
+        };
+      auto add =
+        [&]( shape *Shp, DWORD Mtl )
+        {
+          Shp->Mtl = mtl_no(Mtl);
+          Scene << Shp;
+        };
+
+      // Typed records are copied as is, only material numbers are patched
+      auto copy =
+        [&]( auto &Arr, snap_header::TABLE Table )
+        {
+          using rec = typename std::decay_t<decltype(Arr)>::value_type;
+
+          Arr.reserve(Arr.size() + h->Count[Table]);
+          for (const rec *r = Get<rec>(Table), *end = r + h->Count[Table]; r < end; r++)
+          {
+            rec x = *r;
+
+            x.Mtl = mtl_no(x.Mtl);
+            Arr << x;
+          }
+        };
+
+      if (IsInPlace)
+        ;
+      else if (IsFlat)
+      {
+        copy(f.Spheres, snap_header::Spheres);
+        copy(f.Boxes, snap_header::Boxes);
+        copy(f.Planes, snap_header::Planes);
+        copy(f.Triangles, snap_header::Triangles);
+      }
+      else
+      {
+        for (const flat_sphere *s = Get<flat_sphere>(snap_header::Spheres),
+             *end = s + h->Count[snap_header::Spheres]; s < end; s++)
+          add(new sphere(s->C, s->R), s->Mtl);
+        for (const flat_box *b = Get<flat_box>(snap_header::Boxes),
+             *end = b + h->Count[snap_header::Boxes]; b < end; b++)
+          add(new box(b->B1, b->B2), b->Mtl);
+        for (const flat_plane *p = Get<flat_plane>(snap_header::Planes),
+             *end = p + h->Count[snap_header::Planes]; p < end; p++)
+          add(new plane(p->P, p->N), p->Mtl);
+        for (const flat_triangle *t = Get<flat_triangle>(snap_header::Triangles),
+             *end = t + h->Count[snap_header::Triangles]; t < end; t++)
+          add(new triangle(t->P[0], t->P[1], t->P[2], t->Ns[0], t->Ns[1], t->Ns[2]), t->Mtl);
+      }
+      for (const snap_mesh *m = Get<snap_mesh>(snap_header::Meshes),
+           *end = m + h->Count[snap_header::Meshes]; m < end; m++)
+      {
+        CHAR path[sizeof(m->Path) + 1] {};
+
+        strncpy(path, m->Path, sizeof(m->Path));
+        add(new g3dm(path, mtl_no(m->Mtl)), m->Mtl);
+      }
+      for (const snap_light *l = Get<snap_light>(snap_header::Lights),
+           *end = l + h->Count[snap_header::Lights]; l < end; l++)
+        if (l->Type == 0)
+          Scene << new lght::point(l->Pos, l->Power, l->Color);
+        else if (l->Type == 1)
+          Scene << new lght::direction(l->Pos, l->Color);
+        else if (l->Type == 2)
+          Scene << new lght::rect(l->Pos, l->E1, l->E2, l->Power, l->Color, l->Strata);
+        else
+          Scene << new lght::sphere(l->Pos, l->Radius, l->Power, l->Color, l->Strata);
+
+      Scene.AmbientColor = h->AmbientColor;
+      Scene.BkgColor = h->BkgColor;
+      Scene.Air = {h->AirRefraction, h->AirDecay};
+      Scene.RecMaxLevel = h->RecMaxLevel;
+      Cam.SetLocAtUp(h->CamLoc, h->CamAt, h->CamUp);
+      Cam.SetProj(h->CamSize, h->CamProjDist, h->CamFarClip);
+      return IsInPlace;
+    } /* End of 'Build' function */
+
+    /* Load scene from snapshot file function.
+     * Typed tables loaded to empty scene are used in place, scene keeps
+     * file mapped till 'rt::scene::Clear'. Load is refused if scene would
+     * exceed its memory budget (see 'rt::scene::MemoryBudget').
+     * ARGUMENTS:
+     *   - scene to fill:
+     *       rt::scene &Scene;
+     *   - camera to setup:
+     *       camera &Cam;
+     *   - file name:
+     *       const std::string &FileName;
+     *   - store shapes to typed arrays flag:
+     *       BOOL IsFlat;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise (file is not valid or over budget).
+     */
+    static BOOL Load( rt::scene &Scene, camera &Cam, const std::string &FileName, BOOL IsFlat = TRUE )
+    {
+      timeline_scope ts("snapshot load");
+      auto Snap = std::make_shared<snapshot>();
+
+      if (!Snap->Open(FileName) || !Scene.IsInBudget(Snap->Estimate(IsFlat)))
+        return FALSE;
+      Snap->Build(Scene, Cam, IsFlat, Snap);
+      return TRUE;
+    } /* End of 'Load' function */
+
+    /* Store scene to snapshot file function.
+     * Custom shapes (csg, quadrics, user classes) are not stored, scene
+     * material table is stored as is (numbers are kept).
+     * ARGUMENTS:
+     *   - scene to store:
+     *       const rt::scene &Scene;
+     *   - scene camera:
+     *       const camera &Cam;
+     *   - file name:
+     *       const std::string &FileName;
+     * RETURNS:
+     *   (INT) skipped shapes count, -1 if file is not written.
+     */
+    static INT Save( const rt::scene &Scene, const camera &Cam, const std::string &FileName )
+    {
+      timeline_scope ts("snapshot save");
+      flat_shapes out;
+      std::vector<flat_mtl> mtls;
+      std::vector<snap_light> lights;
+      std::vector<snap_mesh> meshes;
+      INT skipped = 0;
+
+      // Heap shapes go through typed arrays too
+      for (shape *shp : Scene.Shapes)
+        if (auto *g = dynamic_cast<g3dm *>(shp); g != nullptr)
+        {
+          snap_mesh m {};
+
+          strncpy(m.Path, g->Path, sizeof(m.Path) - 1);
+          m.Mtl = g->Mtl;
+          meshes.push_back(m);
+        }
+        else if (!out.Add(shp))
+          skipped++;
+
+      // Scene typed arrays
+      const flat_shapes &fl = Scene.Flat;
+      for (const flat_sphere &s : fl.Spheres)
+        out.Spheres << s;
+      for (const flat_box &b : fl.Boxes)
+        out.Boxes << b;
+      for (const flat_plane &p : fl.Planes)
+        out.Planes << p;
+      for (const flat_triangle &t : fl.Triangles)
+        out.Triangles << t;
+
+      mtls.reserve(Scene.Mtls.Size());
+      for (size_t i = 0; i < Scene.Mtls.Size(); i++)
+        mtls.push_back(flat_shapes::MakeMtl(Scene.Mtls.Surfs[i], Scene.Mtls.Medias[i]));
+
+      for (light *lgh : Scene.lights)
+        if (auto *p = dynamic_cast<lght::point *>(lgh); p != nullptr)
+          lights.push_back({0, 0, p->LP, p->LColor, p->LPower, vec3(0), vec3(0), 0});
+        else if (auto *d = dynamic_cast<lght::direction *>(lgh); d != nullptr)
+          lights.push_back({1, 0, d->Ld, d->LColor, 0, vec3(0), vec3(0), 0});
+        else if (auto *r = dynamic_cast<lght::rect *>(lgh); r != nullptr)
+          lights.push_back({2, r->Strata, r->LP, r->LColor, r->LPower, r->E1, r->E2, 0});
+        else if (auto *s = dynamic_cast<lght::sphere *>(lgh); s != nullptr)
+          lights.push_back({3, s->Strata, s->LP, s->LColor, s->LPower, vec3(0), vec3(0), s->LR});
+
+      snap_header h {};
+      h.Sign = *(DWORD *)"GSNP";
+      h.Version = Version;
+      h.CamLoc = Cam.Loc;
+      h.CamAt = Cam.At;
+      h.CamUp = Cam.Up;
+      h.CamSize = Cam.Size;
+      h.CamProjDist = Cam.ProjDist;
+      h.CamFarClip = Cam.FarClip;
+      h.AmbientColor = Scene.AmbientColor;
+      h.BkgColor = Scene.BkgColor;
+      h.AirRefraction = Scene.Air.RefractionCoef;
+      h.AirDecay = Scene.Air.Decay;
+      h.RecMaxLevel = Scene.RecMaxLevel;
+
+      // All records are 8 byte multiples, so tables stay aligned
+      const std::pair<const VOID *, size_t> tables[snap_header::TableCount] =
+      {
+        {mtls.data(), mtls.size() * sizeof(flat_mtl)},
+        {out.Spheres.data(), out.Spheres.size() * sizeof(flat_sphere)},
+        {out.Boxes.data(), out.Boxes.size() * sizeof(flat_box)},
+        {out.Planes.data(), out.Planes.size() * sizeof(flat_plane)},
+        {out.Triangles.data(), out.Triangles.size() * sizeof(flat_triangle)},
+        {lights.data(), lights.size() * sizeof(snap_light)},
+        {meshes.data(), meshes.size() * sizeof(snap_mesh)},
+      };
+      const size_t counts[snap_header::TableCount] =
+      {
+        mtls.size(), out.Spheres.size(), out.Boxes.size(), out.Planes.size(),
+        out.Triangles.size(), lights.size(), meshes.size()
+      };
+      UINT64 offset = sizeof(snap_header);
+      for (INT i = 0; i < snap_header::TableCount; i++)
+      {
+        h.Count[i] = (DWORD)counts[i];
+        h.Offset[i] = offset;
+        offset += tables[i].second;
+      }
+
+      std::fstream f(FileName, std::fstream::out | std::fstream::binary);
+      if (!f.is_open())
+        return -1;
+      f.write((CHAR *)&h, sizeof(h));
+      for (auto &t : tables)
+        f.write((const CHAR *)t.first, t.second);
+      return f ? skipped : -1;
+    } /* End of 'Save' function */
+  }; /* End of 'snapshot' class */
+} /* end of 'gort' namespace */
+
+#endif /* __snapshot_h_ */
+
+/* END OF 'snapshot.h' FILE */
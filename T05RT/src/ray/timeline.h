@@ -0,0 +1,326 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : timeline.h
+ * PURPOSE     : Raytracing project.
+ *               Render timeline event tracing module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : Events are stored to per thread ring buffers and
+ *               exported in Chrome trace-event JSON format (open with
+ *               chrome://tracing or ui.perfetto.dev). Buffer is written
+ *               by its owner thread only without locks: event slot is
+ *               published by its sequence number, so export reads
+ *               completed events while owner keeps writing.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#ifndef __timeline_h_
+#define __timeline_h_
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "def.h"
+
+/* Project namespace */
+namespace gort
+{
+  /* Render timeline tracing class */
+  class timeline
+  {
+  public:
+    /* Complete ('X' phase) event */
+    struct event
+    {
+      const CHAR *Name; // Event name (static string)
+      INT64 Start;      // Start time in microseconds
+      INT64 Dur;        // Duration in microseconds
+      INT Arg;          // Event argument (row, frame number, ...), -1 if none
+      DWORD Tid;        // Writer thread id
+    }; /* End of 'event' structure */
+
+    // Events per thread ring buffer
+    static const INT BufferSize = 1 << 15;
+
+    // Maximal named thread id (other threads share one id)
+    static const DWORD MaxNamedThreads = 256;
+
+  private:
+    /* Ring buffer event slot (fields are relaxed atomics, export may read slot being written) */
+    struct slot
+    {
+      std::atomic<const CHAR *> Name;
+      std::atomic<INT64> Start, Dur;
+      std::atomic<INT> Arg;
+      std::atomic<DWORD> Tid;
+      std::atomic<UINT64> Seq {0}; // Stored event number + 1 (0 while slot is written)
+    }; /* End of 'slot' structure */
+
+    /* Per thread events ring buffer */
+    struct buffer
+    {
+      slot Slots[BufferSize];           // Events ring
+      std::atomic<UINT64> Head {0};     // Total written events count (owner thread only writes)
+      std::atomic<UINT64> Tail {0};     // First not cleared event number (see 'Clear')
+      std::atomic_bool IsOwned {FALSE}; // Buffer is owned by live thread
+      buffer *Next = nullptr;           // Next buffer in list
+    }; /* End of 'buffer' structure */
+
+    /* Thread buffer owner (releases buffer on thread exit) */
+    struct owner
+    {
+      buffer *Buf = nullptr;
+
+      /* Class destructor */
+      ~owner( VOID )
+      {
+        if (Buf != nullptr)
+          Buf->IsOwned = FALSE;
+      } /* End of '~owner' function */
+    }; /* End of 'owner' structure */
+
+    std::atomic<buffer *> Buffers {nullptr}; // All buffers list
+    std::chrono::steady_clock::time_point StartTime = std::chrono::steady_clock::now();
+    std::atomic<const CHAR *> ThreadNames[MaxNamedThreads] {}; // Named threads
+
+    /* Obtain current thread buffer function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (buffer *) thread buffer.
+     */
+    buffer * Local( VOID )
+    {
+      static thread_local owner Own;
+
+      if (Own.Buf != nullptr)
+        return Own.Buf;
+
+      // Reuse buffer left by finished thread (render loop and sequence writer threads come and go)
+      for (buffer *b = Buffers; b != nullptr; b = b->Next)
+      {
+        BOOL expected = FALSE;
+        if (b->IsOwned.compare_exchange_strong(expected, TRUE))
+          return Own.Buf = b;
+      }
+
+      // Push new buffer to list
+      buffer *b = new buffer;
+      b->IsOwned = TRUE;
+      b->Next = Buffers;
+      while (!Buffers.compare_exchange_weak(b->Next, b))
+        ;
+      return Own.Buf = b;
+    } /* End of 'Local' function */
+
+  public:
+    // Tracing enable flag
+    std::atomic_bool IsEnabled = FALSE;
+
+    /* Obtain timeline single instance function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (timeline &) timeline reference.
+     */
+    static timeline & Get( VOID )
+    {
+      static timeline Instance;
+
+      return Instance;
+    } /* End of 'Get' function */
+
+    /* Class destructor */
+    ~timeline( VOID )
+    {
+      for (buffer *b = Buffers, *next; b != nullptr; b = next)
+        next = b->Next, delete b;
+    } /* End of '~timeline' function */
+
+    /* Obtain current time in microseconds function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (INT64) microseconds from timeline start.
+     */
+    INT64 Now( VOID ) const
+    {
+      return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - StartTime).count();
+    } /* End of 'Now' function */
+
+    /* Obtain current thread trace id function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (DWORD&) current thread id reference.
+     */
+    static DWORD & ThreadId( VOID )
+    {
+      static thread_local DWORD Tid = MaxNamedThreads;
+
+      return Tid;
+    } /* End of 'ThreadId' function */
+
+    /* Set current thread trace id and name function.
+     * Stable ids keep one timeline row per pool worker and one row for
+     * render loop, which is restarted on each render.
+     * ARGUMENTS:
+     *   - thread id (less than 'MaxNamedThreads'):
+     *       DWORD Tid;
+     *   - thread name (static string):
+     *       const CHAR *Name;
+     * RETURNS: None.
+     */
+    VOID SetThread( DWORD Tid, const CHAR *Name )
+    {
+      if (Tid >= MaxNamedThreads)
+        return;
+      ThreadId() = Tid;
+      ThreadNames[Tid] = Name;
+    } /* End of 'SetThread' function */
+
+    /* Store complete event function.
+     * ARGUMENTS:
+     *   - event name (static string):
+     *       const CHAR *Name;
+     *   - event start time in microseconds:
+     *       INT64 Start;
+     *   - event argument (-1 if none):
+     *       INT Arg;
+     * RETURNS: None.
+     */
+    VOID Add( const CHAR *Name, INT64 Start, INT Arg = -1 )
+    {
+      buffer *b = Local();
+      UINT64 h = b->Head.load(std::memory_order_relaxed);
+      slot &s = b->Slots[h % BufferSize];
+
+      // Slot is marked busy before overwrite, so export drops its copy
+      s.Seq.store(0, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      s.Name.store(Name, std::memory_order_relaxed);
+      s.Start.store(Start, std::memory_order_relaxed);
+      s.Dur.store(Now() - Start, std::memory_order_relaxed);
+      s.Arg.store(Arg, std::memory_order_relaxed);
+      s.Tid.store(ThreadId(), std::memory_order_relaxed);
+      s.Seq.store(h + 1, std::memory_order_release);
+      b->Head.store(h + 1, std::memory_order_release);
+    } /* End of 'Add' function */
+
+    /* Clear all stored events function.
+     * Events are skipped by export, buffers are not changed.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID Clear( VOID )
+    {
+      for (buffer *b = Buffers; b != nullptr; b = b->Next)
+        b->Tail.store(b->Head.load(std::memory_order_acquire), std::memory_order_release);
+    } /* End of 'Clear' function */
+
+    /* Store events to Chrome trace-event JSON file function.
+     * Events are copied without locks, so render threads may still
+     * write (events overwritten while copied and later events are not stored).
+     * ARGUMENTS:
+     *   - file name:
+     *       const std::string &FileName;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise.
+     */
+    BOOL SaveJSON( const std::string &FileName )
+    {
+      std::fstream f(FileName, std::fstream::out);
+      if (!f.is_open())
+        return FALSE;
+
+      std::vector<event> events;
+      for (buffer *b = Buffers; b != nullptr; b = b->Next)
+      {
+        UINT64
+          h = b->Head.load(std::memory_order_acquire),
+          t = b->Tail.load(std::memory_order_acquire),
+          first = h > BufferSize ? h - BufferSize : 0;
+
+        for (UINT64 i = t > first ? t : first; i < h; i++)
+        {
+          const slot &s = b->Slots[i % BufferSize];
+
+          if (s.Seq.load(std::memory_order_acquire) != i + 1)
+            continue;
+          event e =
+          {
+            s.Name.load(std::memory_order_relaxed), s.Start.load(std::memory_order_relaxed),
+            s.Dur.load(std::memory_order_relaxed), s.Arg.load(std::memory_order_relaxed),
+            s.Tid.load(std::memory_order_relaxed)
+          };
+
+          // Copy is kept if slot was not rewritten meanwhile
+          std::atomic_thread_fence(std::memory_order_acquire);
+          if (s.Seq.load(std::memory_order_relaxed) == i + 1)
+            events.push_back(e);
+        }
+      }
+
+      BOOL IsFirst = TRUE;
+      f << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+      for (DWORD i = 0; i < MaxNamedThreads; i++)
+        if (const CHAR *name = ThreadNames[i]; name != nullptr)
+        {
+          f << (IsFirst ? "" : ",\n") <<
+            "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i <<
+            ",\"args\":{\"name\":\"" << name << " " << i << "\"}}";
+          IsFirst = FALSE;
+        }
+      for (const event &e : events)
+      {
+        f << (IsFirst ? "" : ",\n") <<
+          "{\"name\":\"" << e.Name << "\",\"cat\":\"render\",\"ph\":\"X\"" <<
+          ",\"ts\":" << e.Start << ",\"dur\":" << e.Dur <<
+          ",\"pid\":1,\"tid\":" << e.Tid;
+        if (e.Arg >= 0)
+          f << ",\"args\":{\"n\":" << e.Arg << "}";
+        f << "}";
+        IsFirst = FALSE;
+      }
+      f << "\n]}\n";
+      return TRUE;
+    } /* End of 'SaveJSON' function */
+  }; /* End of 'timeline' class */
+
+  /* Timeline scope event class (stores event from construction till destruction) */
+  class timeline_scope
+  {
+    const CHAR *Name; // Event name
+    INT Arg;          // Event argument
+    INT64 Start;      // Event start time, -1 if tracing is disabled
+
+  public:
+    /* Class constructor.
+     * ARGUMENTS:
+     *   - event name (static string):
+     *       const CHAR *NewName;
+     *   - event argument (-1 if none):
+     *       INT NewArg;
+     */
+    timeline_scope( const CHAR *NewName, INT NewArg = -1 ) : Name(NewName), Arg(NewArg),
+      Start(timeline::Get().IsEnabled ? timeline::Get().Now() : -1)
+    {
+    } /* End of 'timeline_scope' function */
+
+    /* Class destructor */
+    ~timeline_scope( VOID )
+    {
+      if (Start >= 0)
+        timeline::Get().Add(Name, Start, Arg);
+    } /* End of '~timeline_scope' function */
+  }; /* End of 'timeline_scope' class */
+} /* end of 'gort' namespace */
+
+#endif /* __timeline_h_ */
+
+/* END OF 'timeline.h' FILE */
@@ -0,0 +1,584 @@
+/*************************************************************
+ * Copyright (C) 2024
+ *    Computer Graphics Support Group of 30 Phys-Math Lyceum
+ *************************************************************/
+
+/* FILE NAME   : visbuf.h
+ * PURPOSE     : Raytracing project.
+ *               Rasterized primary visibility buffer module.
+ * PROGRAMMER  : CGSG-SummerCamp'2024.
+ *               Vladislav A. Golubov (VG6).
+ * LAST UPDATE : 19.10.2026.
+ * NOTE        : Mesh, triangle shape and flat triangles are projected
+ *               by camera and rasterized with depth test, pixel keeps
+ *               nearest triangle source, number and perspective
+ *               correct barycentrics. Pixel is sampled at same point
+ *               as primary ray 'FrameRay(X + 0.5, Y - 0.5)'.
+ *               Other shapes are binned to 32 x 32 tiles by projected
+ *               bound box and intersected by ray. Triangles crossing
+ *               near plane and unbounded shapes are tested for all
+ *               pixels. Triangles are projected by workers into own
+ *               bins, tiles are rasterized in parallel.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Lyceum
+ */
+
+#ifndef __visbuf_h_
+#define __visbuf_h_
+
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <mutex>
+#include "rt_flat.h"
+#include "pool.h"
+
+/* Project namespace */
+namespace gort
+{
+  /* Rasterized primary visibility buffer class */
+  class visbuf
+  {
+  public:
+    static const INT TileSize = 32; // Tile side in pixels
+
+    /* Pixel visibility record */
+    struct pixel
+    {
+      INT Src;  // Triangle source number (-1 if pixel is not covered)
+      INT Prim; // Triangle number in source
+      FLT U, V; // Barycentrics of second and third vertices
+      FLT Z;    // Inverse view depth
+    }; /* End of 'pixel' structure */
+
+  private:
+    /* Triangles source */
+    struct source
+    {
+      shape *Shp;          // Source shape (nullptr for flat triangles)
+      const g3dm *Mesh;    // Source mesh (nullptr if not mesh)
+      const triangle *Tri; // Source triangle shape (nullptr if not triangle)
+      INT Count;           // Triangles count
+    }; /* End of 'source' structure */
+
+    /* Projected triangle */
+    struct screen_tri
+    {
+      FLT X[3], Y[3], Z[3]; // Buffer positions and inverse view depths
+      INT Src, Prim;        // Source and triangle numbers
+    }; /* End of 'screen_tri' structure */
+
+    /* Ray intersected shape */
+    struct analytic
+    {
+      shape *Shp;    // Custom shape (nullptr for flat arrays shape)
+      shape_ref Ref; // Flat arrays shape reference
+    }; /* End of 'analytic' structure */
+
+    // Buffer rectangle and tiles count
+    INT X0 = 0, Y0 = 0, W = 0, H = 0, TilesW = 0, TilesH = 0;
+    // Projection: camera basis and frame scales
+    vec3 Loc, Dir, Right, Up;
+    DBL ProjDist = 0, ScaleX = 0, ScaleY = 0, CenterX = 0, CenterY = 0;
+
+    stock<pixel> Pixels;                       // Pixels records
+    stock<source> Srcs;                        // Triangle sources
+    std::vector<stock<screen_tri>> Tris;       // Projected triangles per worker
+    std::vector<std::vector<stock<INT>>> Bins; // Per worker tiles triangle numbers
+    std::vector<stock<analytic>> TileShapes;   // Per tile ray intersected shapes
+    stock<analytic> Global;                    // Shapes intersected for all pixels
+    stock<std::pair<INT, INT>> NearTris;       // Near plane crossing triangles (source, number)
+    std::mutex NearMutex;                      // 'NearTris' addition mutex
+    const flat_shapes *Flat = nullptr;         // Flat shapes of last build
+
+  public:
+    /* Build buffer function.
+     * ARGUMENTS:
+     *   - scene custom and flat shapes:
+     *       const stock<shape *> &Shapes;
+     *       const flat_shapes &FlatShapes;
+     *   - camera:
+     *       const camera &Cam;
+     *   - frame rectangle (X1, Y1 are excluded):
+     *       INT NewX0, NewY0, NewX1, NewY1;
+     *   - workers pool and workers count:
+     *       thread_pool &Pool;
+     *       INT ThreadCount;
+     * RETURNS: None.
+     */
+    VOID Build( const stock<shape *> &Shapes, const flat_shapes &FlatShapes, const camera &Cam,
+                INT NewX0, INT NewY0, INT NewX1, INT NewY1, thread_pool &Pool, INT ThreadCount )
+    {
+      X0 = NewX0, Y0 = NewY0;
+      W = max(NewX1 - NewX0, 0), H = max(NewY1 - NewY0, 0);
+      TilesW = (W + TileSize - 1) / TileSize;
+      TilesH = (H + TileSize - 1) / TileSize;
+      Flat = &FlatShapes;
+
+      // Same projection as 'camera::FrameRay' (integer frame center)
+      Loc = Cam.Loc, Dir = Cam.Dir, Right = Cam.Right, Up = Cam.Up;
+      ProjDist = Cam.ProjDist;
+      ScaleX = Cam.FrameW / Cam.Wp;
+      ScaleY = Cam.FrameH / Cam.Hp;
+      CenterX = Cam.FrameW / 2;
+      CenterY = Cam.FrameH / 2;
+
+      Pixels.assign((size_t)W * H, pixel {-1, 0, 0, 0, 0});
+      TileShapes.resize((size_t)TilesW * TilesH);
+      for (auto &t : TileShapes)
+        t.clear();
+      Global.clear();
+      NearTris.clear();
+
+      // Sources and ray intersected shapes
+      Srcs.clear();
+      if (!FlatShapes.Triangles.empty())
+        Srcs << source {nullptr, nullptr, nullptr, (INT)FlatShapes.Triangles.size()};
+      for (shape *shp : Shapes)
+        if (auto *m = dynamic_cast<const g3dm *>(shp); m != nullptr)
+          Srcs << source {shp, m, nullptr, m->TriangleCount()};
+        else if (auto *t = dynamic_cast<const triangle *>(shp); t != nullptr)
+          Srcs << source {shp, nullptr, t, 1};
+        else
+        {
+          vec3 mn, mx;
+
+          AddShape(analytic {shp, shape_ref()}, shp->GetBound(&mn, &mx), mn, mx);
+        }
+      for (DWORD i = 0; i < (DWORD)FlatShapes.Spheres.size(); i++)
+      {
+        const flat_sphere &s = FlatShapes.Spheres[i];
+
+        AddShape(analytic {nullptr, shape_ref {shape_ref::Sphere, i}}, TRUE, s.C - vec3(s.R), s.C + vec3(s.R));
+      }
+      for (DWORD i = 0; i < (DWORD)FlatShapes.Boxes.size(); i++)
+      {
+        const flat_box &b = FlatShapes.Boxes[i];
+        vec3 mn, mx;
+
+        for (INT a = 0; a < 3; a++)
+          mn[a] = min(b.B1[a], b.B2[a]), mx[a] = max(b.B1[a], b.B2[a]);
+        AddShape(analytic {nullptr, shape_ref {shape_ref::Box, i}}, TRUE, mn, mx);
+      }
+      for (DWORD i = 0; i < (DWORD)FlatShapes.Planes.size(); i++)
+        AddShape(analytic {nullptr, shape_ref {shape_ref::Plane, i}}, FALSE, vec3(0), vec3(0));
+
+      // Triangles are enumerated by global number, workers take chunks
+      stock<INT> first;
+      INT total = 0;
+
+      for (const source &s : Srcs)
+        first << total, total += s.Count;
+      if (W == 0 || H == 0)
+        return;
+
+      INT n = ThreadCount <= 0 ? Pool.Count() : min(ThreadCount, Pool.Count());
+      const INT Chunk = 4096;
+      std::atomic_int next = 0, tile = 0;
+
+      Tris.resize(n);
+      Bins.resize(n);
+      n = Pool.Run(n,
+        [&]( INT i )
+        {
+          stock<screen_tri> &tris = Tris[i];
+          std::vector<stock<INT>> &bins = Bins[i];
+
+          tris.clear();
+          bins.resize((size_t)TilesW * TilesH);
+          for (auto &b : bins)
+            b.clear();
+          for (INT g = next.fetch_add(Chunk); g < total; g = next.fetch_add(Chunk))
+          {
+            INT s = (INT)(std::upper_bound(first.begin(), first.end(), g) - first.begin()) - 1;
+
+            for (INT k = g; k < min(g + Chunk, total); k++)
+            {
+              while (k - first[s] >= Srcs[s].Count)
+                s++;
+              Project(s, k - first[s], tris, bins);
+            }
+          }
+        });
+
+      // Tiles rasterization
+      Pool.Run(n,
+        [&]( INT )
+        {
+          for (INT t = tile++; t < TilesW * TilesH; t = tile++)
+            for (INT w = 0; w < n; w++)
+              for (INT k : Bins[w][t])
+                Raster(Tris[w][k], t);
+        });
+    } /* End of 'Build' function */
+
+    /* Obtain buffer memory function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (size_t) pixels, tiles and per worker triangles memory in bytes.
+     */
+    size_t Memory( VOID ) const
+    {
+      size_t sum = Pixels.capacity() * sizeof(pixel) + Srcs.capacity() * sizeof(source) +
+        TileShapes.capacity() * sizeof(stock<analytic>) + Global.capacity() * sizeof(analytic) +
+        NearTris.capacity() * sizeof(std::pair<INT, INT>);
+
+      for (auto &t : Tris)
+        sum += t.capacity() * sizeof(screen_tri);
+      for (auto &b : Bins)
+        for (auto &bin : b)
+          sum += bin.capacity() * sizeof(INT);
+      for (auto &t : TileShapes)
+        sum += t.capacity() * sizeof(analytic);
+      return sum;
+    } /* End of 'Memory' function */
+
+    /* Obtain pixel record function.
+     * ARGUMENTS:
+     *   - frame pixel coordinates (inside buffer rectangle):
+     *       INT X, Y;
+     * RETURNS:
+     *   (const pixel &) pixel record.
+     */
+    const pixel & Pixel( INT X, INT Y ) const
+    {
+      return Pixels[(size_t)(Y - Y0) * W + X - X0];
+    } /* End of 'Pixel' function */
+
+    /* Primary ray intersection function.
+     * Rasterized hit is combined with ray intersected shapes of pixel tile.
+     * ARGUMENTS:
+     *   - pixel primary ray ('FrameRay(X + 0.5, Y - 0.5)' of build camera):
+     *       const ray &R;
+     *   - frame pixel coordinates:
+     *       INT X, Y;
+     *   - intersection data:
+     *       intr *In;
+     *   - shape tests counter:
+     *       UINT64 *Tests;
+     * RETURNS:
+     *   (INT) 1 if hit is found, 0 if nothing is hit, -1 if ray should be traced.
+     */
+    INT Intersect( const ray &R, INT X, INT Y, intr *In, UINT64 *Tests ) const
+    {
+      if (X < X0 || Y < Y0 || X >= X0 + W || Y >= Y0 + H)
+        return -1;
+
+      const pixel &p = Pixel(X, Y);
+      intr best;
+      best.T = -1;
+
+      // Rasterized triangle: distance is found by ray and triangle plane
+      if (p.Src >= 0)
+      {
+        vec3 v[3];
+
+        Vertices(p.Src, p.Prim, v);
+        vec3 n = (v[1] - v[0]) % (v[2] - v[0]);
+        DBL nd = n & R.Dir;
+
+        if (fabs(nd) <= Threshold * (!n))
+          return -1;
+        best.T = ((v[0] - R.Org) & n) / nd;
+        if (best.T < Threshold)
+          return -1;
+        Hit(p.Src, p.Prim, p.U, p.V, &best);
+      }
+      ++*Tests;
+
+      auto test =
+        [&]( const analytic &A )
+        {
+          intr cur;
+
+          cur.Shp = A.Shp;
+          if (A.Shp != nullptr ? A.Shp->Intersect(R, &cur) : Flat->Intersect(R, A.Ref, &cur))
+            if (best.T == -1 || cur.T < best.T)
+              best = cur;
+        };
+      const stock<analytic> &tile = TileShapes[(size_t)((Y - Y0) / TileSize) * TilesW + (X - X0) / TileSize];
+      *Tests += Global.size() + tile.size() + NearTris.size();
+      for (const analytic &a : Global)
+        test(a);
+      for (const analytic &a : tile)
+        test(a);
+      for (auto [s, k] : NearTris)
+      {
+        intr cur;
+        DBL t, u, v;
+
+        if (Srcs[s].Mesh != nullptr)
+        {
+          if (!Srcs[s].Mesh->TriangleIntersect(R, k, &t, &u, &v))
+            continue;
+        }
+        else if (Srcs[s].Tri != nullptr)
+        {
+          cur.Shp = Srcs[s].Shp;
+          if (!Srcs[s].Shp->Intersect(R, &cur))
+            continue;
+          t = cur.T, u = cur.D[0], v = cur.D[1];
+        }
+        else if (!Flat->TriangleIntersect(R, Flat->Triangles[k], &t, &u, &v))
+          continue;
+        if (best.T == -1 || t < best.T)
+        {
+          best = intr();
+          best.T = t;
+          Hit(s, k, u, v, &best);
+        }
+      }
+      if (best.T == -1)
+        return 0;
+      *In = best;
+      return 1;
+    } /* End of 'Intersect' function */
+
+  private:
+    /* Clamp projected coordinate to buffer range function.
+     * Keeps float to integer conversion defined for huge values.
+     * ARGUMENTS:
+     *   - finite projected coordinate:
+     *       DBL V;
+     *   - buffer size along coordinate axis:
+     *       INT Size;
+     * RETURNS:
+     *   (DBL) coordinate clamped to [-1, Size].
+     */
+    static DBL ClampCoord( DBL V, INT Size )
+    {
+      return V < -1 ? -1 : V > Size ? Size : V;
+    } /* End of 'ClampCoord' function */
+
+    /* Add ray intersected shape function.
+     * ARGUMENTS:
+     *   - shape:
+     *       const analytic &A;
+     *   - bounded shape flag and bound box:
+     *       BOOL IsBound;
+     *       const vec3 &Min, &Max;
+     * RETURNS: None.
+     */
+    VOID AddShape( const analytic &A, BOOL IsBound, const vec3 &Min, const vec3 &Max )
+    {
+      DBL x0 = 1e30, y0 = 1e30, x1 = -1e30, y1 = -1e30;
+
+      // Box corners projection bound, box crossing near plane covers all tiles
+      for (INT c = 0; c < 8 && IsBound; c++)
+      {
+        DBL x, y, z;
+
+        if (!Project(vec3(c & 1 ? Max[0] : Min[0], c & 2 ? Max[1] : Min[1], c & 4 ? Max[2] : Min[2]), &x, &y, &z))
+          IsBound = FALSE;
+        x0 = min(x0, x), x1 = max(x1, x);
+        y0 = min(y0, y), y1 = max(y1, y);
+      }
+      if (!IsBound || !std::isfinite(x0) || !std::isfinite(y0) || !std::isfinite(x1) || !std::isfinite(y1))
+      {
+        Global << A;
+        return;
+      }
+      if (x1 + 1 < 0 || y1 + 1 < 0 || x0 - 1 >= W || y0 - 1 >= H)
+        return;
+      INT
+        tx0 = max((INT)floor(ClampCoord(x0, W) - 1) / TileSize, 0),
+        ty0 = max((INT)floor(ClampCoord(y0, H) - 1) / TileSize, 0),
+        tx1 = min((INT)(ClampCoord(x1, W) + 1) / TileSize, TilesW - 1),
+        ty1 = min((INT)(ClampCoord(y1, H) + 1) / TileSize, TilesH - 1);
+
+      for (INT ty = ty0; ty <= ty1; ty++)
+        for (INT tx = tx0; tx <= tx1; tx++)
+          TileShapes[(size_t)ty * TilesW + tx] << A;
+    } /* End of 'AddShape' function */
+
+    /* Project point to buffer function.
+     * ARGUMENTS:
+     *   - point:
+     *       const vec3 &P;
+     *   - result buffer position (pixel (X, Y) is sampled at integer point) and inverse depth:
+     *       DBL *X, *Y, *Z;
+     * RETURNS:
+     *   (BOOL) TRUE if point is before near plane, FALSE otherwise.
+     */
+    BOOL Project( const vec3 &P, DBL *X, DBL *Y, DBL *Z ) const
+    {
+      vec3 d = P - Loc;
+      DBL z = d & Dir;
+
+      if (z <= ProjDist)
+        return FALSE;
+      DBL k = ProjDist / z;
+
+      *X = CenterX + (d & Right) * k * ScaleX - 0.5 - X0;
+      *Y = CenterY - (d & Up) * k * ScaleY + 0.5 - Y0;
+      *Z = 1 / z;
+      return TRUE;
+    } /* End of 'Project' function */
+
+    /* Obtain source triangle vertices function.
+     * ARGUMENTS:
+     *   - source and triangle numbers:
+     *       INT Src, Prim;
+     *   - result vertices:
+     *       vec3 *V;
+     * RETURNS: None.
+     */
+    VOID Vertices( INT Src, INT Prim, vec3 *V ) const
+    {
+      const source &s = Srcs[Src];
+
+      if (s.Mesh != nullptr)
+        for (INT i = 0; i < 3; i++)
+          V[i] = s.Mesh->Position(Prim, i);
+      else if (s.Tri != nullptr)
+        V[0] = s.Tri->P0, V[1] = s.Tri->P1, V[2] = s.Tri->P2;
+      else
+        for (INT i = 0; i < 3; i++)
+          V[i] = Flat->Triangles[Prim].P[i];
+    } /* End of 'Vertices' function */
+
+    /* Fill triangle hit intersection data function.
+     * ARGUMENTS:
+     *   - source and triangle numbers:
+     *       INT Src, Prim;
+     *   - barycentrics:
+     *       DBL U, V;
+     *   - intersection data (distance is set):
+     *       intr *In;
+     * RETURNS: None.
+     */
+    VOID Hit( INT Src, INT Prim, DBL U, DBL V, intr *In ) const
+    {
+      const source &s = Srcs[Src];
+
+      In->Shp = s.Shp;
+      In->Ref = s.Shp != nullptr ? shape_ref() : shape_ref {shape_ref::Triangle, (DWORD)Prim};
+      In->I[0] = Prim;
+      In->D[0] = U;
+      In->D[1] = V;
+      In->IsP = In->IsN = In->IsPlane = FALSE;
+    } /* End of 'Hit' function */
+
+    /* Project and bin triangle function.
+     * ARGUMENTS:
+     *   - source and triangle numbers:
+     *       INT Src, Prim;
+     *   - worker triangles and tiles bins:
+     *       stock<screen_tri> &Out;
+     *       std::vector<stock<INT>> &OutBins;
+     * RETURNS: None.
+     */
+    VOID Project( INT Src, INT Prim, stock<screen_tri> &Out, std::vector<stock<INT>> &OutBins )
+    {
+      vec3 v[3];
+      screen_tri t;
+      INT behind = 0;
+      BOOL IsInGuard = TRUE;
+      // Guard band: farther projected vertices lose float precision in edge functions
+      const FLT Guard = 65536;
+
+      Vertices(Src, Prim, v);
+      for (INT i = 0; i < 3; i++)
+      {
+        DBL x, y, z;
+
+        if (!Project(v[i], &x, &y, &z))
+          behind++;
+        else
+        {
+          t.X[i] = (FLT)x, t.Y[i] = (FLT)y, t.Z[i] = (FLT)z;
+          IsInGuard = IsInGuard && fabs(t.X[i]) < Guard && fabs(t.Y[i]) < Guard;
+        }
+      }
+      // Triangle behind near plane is not visible, crossing one or out of guard band (or not finite) is traced
+      if (behind == 3)
+        return;
+      if (behind > 0 || !IsInGuard)
+      {
+        std::lock_guard<std::mutex> lock(NearMutex);
+
+        NearTris << std::pair<INT, INT>(Src, Prim);
+        return;
+      }
+
+      // Covered pixels bound
+      INT
+        x0 = max((INT)ceil(ClampCoord(min(t.X[0], min(t.X[1], t.X[2])) - 1e-3f, W)), 0),
+        y0 = max((INT)ceil(ClampCoord(min(t.Y[0], min(t.Y[1], t.Y[2])) - 1e-3f, H)), 0),
+        x1 = min((INT)floor(ClampCoord(max(t.X[0], max(t.X[1], t.X[2])) + 1e-3f, W)), W - 1),
+        y1 = min((INT)floor(ClampCoord(max(t.Y[0], max(t.Y[1], t.Y[2])) + 1e-3f, H)), H - 1);
+
+      if (x0 > x1 || y0 > y1)
+        return;
+      t.Src = Src;
+      t.Prim = Prim;
+      INT no = (INT)Out.size();
+
+      Out << t;
+      for (INT ty = y0 / TileSize; ty <= y1 / TileSize; ty++)
+        for (INT tx = x0 / TileSize; tx <= x1 / TileSize; tx++)
+          OutBins[(size_t)ty * TilesW + tx] << no;
+    } /* End of 'Project' function */
+
+    /* Rasterize triangle to tile function.
+     * Pixels on shared edges are covered by both triangles (depth
+     * test selects one), so there are no cracks between triangles.
+     * ARGUMENTS:
+     *   - projected triangle:
+     *       const screen_tri &T;
+     *   - tile number:
+     *       INT Tile;
+     * RETURNS: None.
+     */
+    VOID Raster( const screen_tri &T, INT Tile )
+    {
+      auto edge =
+        [&T]( INT A, INT B, DBL X, DBL Y )
+        {
+          return ((DBL)T.X[B] - T.X[A]) * (Y - T.Y[A]) - ((DBL)T.Y[B] - T.Y[A]) * (X - T.X[A]);
+        };
+      DBL area = edge(0, 1, T.X[2], T.Y[2]);
+
+      // Triangle is seen edge on
+      if (fabs(area) < 1e-12)
+        return;
+
+      const DBL Eps = 1e-6;
+      DBL inv = 1 / area;
+      INT
+        tx = Tile % TilesW * TileSize, ty = Tile / TilesW * TileSize,
+        x0 = max((INT)ceil(ClampCoord(min(T.X[0], min(T.X[1], T.X[2])) - 1e-3f, W)), tx),
+        y0 = max((INT)ceil(ClampCoord(min(T.Y[0], min(T.Y[1], T.Y[2])) - 1e-3f, H)), ty),
+        x1 = min((INT)floor(ClampCoord(max(T.X[0], max(T.X[1], T.X[2])) + 1e-3f, W)), min(tx + TileSize, W) - 1),
+        y1 = min((INT)floor(ClampCoord(max(T.Y[0], max(T.Y[1], T.Y[2])) + 1e-3f, H)), min(ty + TileSize, H) - 1);
+
+      for (INT y = y0; y <= y1; y++)
+        for (INT x = x0; x <= x1; x++)
+        {
+          DBL
+            w0 = edge(1, 2, x, y) * inv,
+            w1 = edge(2, 0, x, y) * inv,
+            w2 = edge(0, 1, x, y) * inv;
+
+          if (w0 < -Eps || w1 < -Eps || w2 < -Eps)
+            continue;
+          DBL z = w0 * T.Z[0] + w1 * T.Z[1] + w2 * T.Z[2];
+          pixel &p = Pixels[(size_t)y * W + x];
+
+          if (z <= p.Z)
+            continue;
+          // Barycentrics are interpolated perspective correct
+          p.Src = T.Src;
+          p.Prim = T.Prim;
+          p.U = (FLT)max(w1 * T.Z[1] / z, 0.0);
+          p.V = (FLT)max(w2 * T.Z[2] / z, 0.0);
+          p.Z = (FLT)z;
+        }
+    } /* End of 'Raster' function */
+  }; /* End of 'visbuf' class */
+} /* end of 'gort' namespace */
+
+#endif /* __visbuf_h_ */
+
+/* END OF 'visbuf.h' FILE */